@@ -10,8 +10,8 @@
 #include "../Sequencer/StyleProfiles.hpp"
 #include "StyleMorpher.hpp"
 #include <vector>
-#include <random>
 #include <algorithm>
+#include "../Core/RandomStream.h"
 
 namespace TechnoMachine {
 
@@ -42,18 +42,19 @@ struct CompositeStyle {
 
     void setStyle(Role role, int styleIdx) {
         if (role >= 0 && role < NUM_ROLES) {
-            roleStyles[role] = std::clamp(styleIdx, 0, NUM_STYLES - 1);
+            roleStyles[role] = std::clamp(styleIdx, 0, getNumStyles() - 1);
         }
     }
 
     // 取得主要風格（用於顯示）- 取出現最多次的風格
     int getDominantStyle() const {
-        int counts[NUM_STYLES] = {0};
+        int counts[MAX_STYLES] = {0};
         for (int i = 0; i < NUM_ROLES; i++) {
             counts[roleStyles[i]]++;
         }
         int maxIdx = 0;
-        for (int i = 1; i < NUM_STYLES; i++) {
+        const int numStyles = getNumStyles();
+        for (int i = 1; i < numStyles; i++) {
             if (counts[i] > counts[maxIdx]) maxIdx = i;
         }
         return maxIdx;
@@ -94,11 +95,18 @@ enum class TransitionTrigger {
  */
 class SongManager {
 public:
-    SongManager() : rng_(std::random_device{}()) {
+    SongManager() {
         // 預設產生一個隨機 set
         generateRandomSet(8);
     }
 
+    /**
+     * 設定隨機串流（之後的 generateRandomSet 由 seed 決定）
+     */
+    void setSeed(uint64_t engineSeed) {
+        rng_.reset(engineSeed, RandomStreamId::SongManager);
+    }
+
     /**
      * 產生隨機 Set（使用複合風格）
      * @param numSongs 歌曲數量
@@ -107,12 +115,12 @@ public:
     void generateRandomSet(int numSongs, int fixedBars = 0) {
         songs_.clear();
 
-        std::uniform_int_distribution<int> styleDist(0, NUM_STYLES - 1);
-        std::uniform_real_distribution<float> varDist(0.2f, 0.8f);
-        std::uniform_int_distribution<int> barsDist(32, 128);
-        std::uniform_real_distribution<float> energyDist(0.3f, 0.9f);
-        std::uniform_int_distribution<int> roleDist(0, NUM_ROLES - 1);
-        std::uniform_real_distribution<float> probDist(0.0f, 1.0f);
+        UniformInt styleDist(0, getNumStyles() - 1);
+        UniformReal varDist(0.2f, 0.8f);
+        UniformInt barsDist(32, 128);
+        UniformReal energyDist(0.3f, 0.9f);
+        UniformInt roleDist(0, NUM_ROLES - 1);
+        UniformReal probDist(0.0f, 1.0f);
 
         CompositeStyle prevStyle;
 
@@ -153,8 +161,8 @@ public:
      */
     CompositeStyle generateContinuousStyle(
         const CompositeStyle& prev,
-        std::uniform_int_distribution<int>& styleDist,
-        std::uniform_real_distribution<float>& probDist)
+        UniformInt& styleDist,
+        UniformReal& probDist)
     {
         CompositeStyle newStyle;
         const float MIN_DISSIMILARITY = 0.5f;  // 明顯差異的門檻
@@ -163,13 +171,13 @@ public:
         int keepCount = (probDist(rng_) < 0.5f) ? 1 : 2;
 
         // 隨機選擇要保持的角色
-        std::vector<int> roles = {0, 1, 2, 3};
-        std::shuffle(roles.begin(), roles.end(), rng_);
+        int roles[NUM_ROLES] = {0, 1, 2, 3};
+        rng_.shuffle(roles, NUM_ROLES);
 
         int bigChangeCount = 0;  // 追蹤明顯變化的角色數
 
         for (int i = 0; i < NUM_ROLES; i++) {
-            int role = roles[static_cast<size_t>(i)];
+            int role = roles[i];
             int prevStyleIdx = prev.roleStyles[role];
 
             if (i < keepCount) {
@@ -182,12 +190,12 @@ public:
                 // 如果還沒有達到 2 個明顯變化，強制選擇差異大的風格
                 if (bigChangeCount < 2) {
                     // 找出差異度 >= 0.5 的風格
-                    int dissimilarStyles[NUM_STYLES];
+                    int dissimilarStyles[MAX_STYLES];
                     int dissimilarCount = findDissimilarStyles(prevStyleIdx, MIN_DISSIMILARITY, dissimilarStyles);
 
                     if (dissimilarCount > 0) {
                         // 從差異大的風格中隨機選擇
-                        std::uniform_int_distribution<int> dissimilarDist(0, dissimilarCount - 1);
+                        UniformInt dissimilarDist(0, dissimilarCount - 1);
                         newStyleIdx = dissimilarStyles[dissimilarDist(rng_)];
                         bigChangeCount++;
                     } else {
@@ -229,6 +237,16 @@ public:
         songs_.emplace_back(style, variation, bars, energy);
     }
 
+    /**
+     * 與另一個 SongManager 交換歌曲序列與播放位置
+     * 只交換 vector 指標，不配置也不釋放記憶體（音訊執行緒可呼叫）
+     */
+    void swapSongs(SongManager& other) {
+        songs_.swap(other.songs_);
+        std::swap(currentSongIdx_, other.currentSongIdx_);
+        std::swap(barsInCurrentSong_, other.barsInCurrentSong_);
+    }
+
     /**
      * 清除 Set
      */
@@ -320,6 +338,7 @@ public:
     int getCurrentSongIdx() const { return currentSongIdx_; }
     int getBarsInCurrentSong() const { return barsInCurrentSong_; }
     int getSongCount() const { return static_cast<int>(songs_.size()); }
+    const std::vector<Song>& getSongs() const { return songs_; }
 
     float getProgress() const {
         if (songs_.empty()) return 0.0f;
@@ -336,7 +355,7 @@ private:
     int transitionDurationBars_ = 8;  // 過渡持續小節數
     int phraseLength_ = 8;  // 標準 phrase 長度（8 bars）
 
-    std::mt19937 rng_;
+    RandomStream rng_;
 
     /**
      * 計算 phrase-aligned 過渡開始點
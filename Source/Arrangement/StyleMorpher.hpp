@@ -35,12 +35,12 @@ public:
      * 設定起始和目標風格
      */
     void setStyles(int fromStyleIdx, int toStyleIdx) {
-        if (fromStyleIdx >= 0 && fromStyleIdx < NUM_STYLES) {
-            fromStyle_ = STYLES[fromStyleIdx];
+        if (const StyleProfile* from = getStyleProfile(fromStyleIdx)) {
+            fromStyle_ = from;
             fromStyleIdx_ = fromStyleIdx;
         }
-        if (toStyleIdx >= 0 && toStyleIdx < NUM_STYLES) {
-            toStyle_ = STYLES[toStyleIdx];
+        if (const StyleProfile* to = getStyleProfile(toStyleIdx)) {
+            toStyle_ = to;
             toStyleIdx_ = toStyleIdx;
         }
     }
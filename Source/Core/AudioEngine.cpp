@@ -1,8 +1,26 @@
 #include "AudioEngine.h"
+#include <thread>
 #include "Transport.h"
+#include "StyleBankLoader.h"
 
 AudioEngine::AudioEngine()
 {
+    // 每次啟動使用不同 seed；要重現一段演出時用 setSeed / applySetCode
+    std::random_device rd;
+    uint64_t seed = (static_cast<uint64_t>(rd()) << 32) ^ rd();
+
+    // 音訊尚未啟動，直接設定兩端的串流並換入第一組歌曲
+    seedMessageThreadStreams(seed);
+    applySeed(seed);
+    stageSongs();
+    songHandoff_.store(SONGS_READY, std::memory_order_release);
+    installSongs();
+    transitionDurationBars_ = transitionEngine_.getSongManager().getTransitionDuration();
+
+    juce::File bankFile = TechnoMachine::StyleBankLoader::findDataFile("patterns.tmpb");
+    if (bankFile.existsAsFile()) {
+        loadPatternBank(bankFile);
+    }
 }
 
 AudioEngine::~AudioEngine()
@@ -15,7 +33,9 @@ void AudioEngine::prepare(double sampleRate, int samplesPerBlock)
     samplesPerBlock_ = samplesPerBlock;
 
     drums_.setSampleRate(static_cast<float>(sampleRate));
+    drums_.setFreqSmoothing(5.0f);  // Crossfader 改變音高時避免係數跳變
     sampleEngine_.prepare(sampleRate);
+    sampleLoader_.setSampleRate(sampleRate);
 
     // 套用 Techno 預設音色（4 聲道）
     drums_.applyTechnoPreset();
@@ -31,7 +51,7 @@ void AudioEngine::prepare(double sampleRate, int samplesPerBlock)
     transitionEngine_.initialize();
 
     // 初始化雙 Deck 系統
-    patternEngine_.initializeDecks(16, 0.3f, 0.6f);
+    patternEngine_.initializeDecks(patternLength_, 0.3f, 0.6f);
 
     // 載入第一首歌到 Deck A
     const auto& song = transitionEngine_.getSongManager().getCurrentSong();
@@ -46,17 +66,121 @@ void AudioEngine::prepare(double sampleRate, int samplesPerBlock)
 
     // 套用初始音色
     applySynthModifiers();
+}
+
+// === Seed / Set 代碼 ===
+
+void AudioEngine::setSeed(uint64_t seed)
+{
+    seedMessageThreadStreams(seed);
 
-    lastStep_ = -1;
-    lastBar_ = -1;
+    TechnoMachine::EngineCommand command;
+    command.type = TechnoMachine::EngineCommand::Type::SetSeed;
+    command.seed = seed;
+    postCommand(command);
 }
 
-void AudioEngine::regeneratePatterns(float variation)
+void AudioEngine::seedMessageThreadStreams(uint64_t seed)
 {
-    patternEngine_.regenerate(16, variation);
+    using TechnoMachine::RandomStreamId;
 
-    // 套用 Synth Modifiers（Variation 影響音色）
-    applySynthModifiers();
+    seed_ = seed;
+    stagedSongs_.setSeed(seed);
+    deckLoadRng_.reset(seed, RandomStreamId::DeckLoad);
+    deckBuildRng_.reset(seed, RandomStreamId::DeckBuild);
+}
+
+void AudioEngine::applySeed(uint64_t seed)
+{
+    using TechnoMachine::RandomStream;
+    using TechnoMachine::RandomStreamId;
+
+    patternEngine_.setSeed(seed);
+    densityRng_.reset(seed, RandomStreamId::PlaybackDensity);
+    drums_.setNoiseSeed(static_cast<uint32_t>(RandomStream::deriveKey(seed, RandomStreamId::VoiceNoise)));
+}
+
+TechnoMachine::SetCode AudioEngine::makeSetCode(double tempo, int swingLevel) const
+{
+    TechnoMachine::SetCode code;
+    code.seed = seed_;
+    code.tempo = tempo;
+    code.numSongs = numSongs_;
+    code.barsPerSong = barsPerSong_;
+    code.fillIntensity = patternEngine_.getFillIntensity();
+    for (int i = 0; i < TechnoMachine::NUM_ROLES; i++) {
+        code.playbackDensities[i] = getPlaybackDensity(static_cast<TechnoMachine::Role>(i));
+        code.roleDensities[i] = roleDensities_[i];
+    }
+    code.swingLevel = swingLevel;
+    code.patternLength = patternLength_;
+    return code;
+}
+
+void AudioEngine::applySetCode(const TechnoMachine::SetCode& code)
+{
+    setSeed(code.seed);
+    setFillIntensity(code.fillIntensity);
+    for (int i = 0; i < TechnoMachine::NUM_ROLES; i++) {
+        setPlaybackDensity(static_cast<TechnoMachine::Role>(i), code.playbackDensities[i]);
+        setDensity(static_cast<TechnoMachine::Role>(i), code.roleDensities[i]);
+    }
+    setPatternLength(code.patternLength);
+
+    // 由新 seed 重建歌曲序列（message thread 生成，音訊執行緒換入）
+    numSongs_ = code.numSongs;
+    barsPerSong_ = code.barsPerSong;
+    stageSongs();
+
+    // 前兩首載入 Deck A / B，回到 Deck A
+    const auto& song = stagedSongs_.getCurrentSong();
+    requestDeckBuild(0, song.compositeStyle.roleStyles, song.variation);
+    const auto& nextSong = stagedSongs_.getNextSong();
+    requestDeckBuild(1, nextSong.compositeStyle.roleStyles, nextSong.variation);
+    setCrossfader(0.0f);
+    publishSongs();
+}
+
+void AudioEngine::stageSongs()
+{
+    // 取回尚未換入的上一組；音訊執行緒正在交換時等它結束（只有指標操作）
+    for (;;) {
+        int expected = SONGS_READY;
+        if (songHandoff_.compare_exchange_strong(expected, SONGS_IDLE, std::memory_order_acq_rel,
+                                                 std::memory_order_acquire)) break;
+        if (expected == SONGS_IDLE) break;
+        std::this_thread::yield();
+    }
+    stagedSongs_.generateRandomSet(numSongs_, barsPerSong_);
+    songList_ = stagedSongs_.getSongs();
+}
+
+void AudioEngine::publishSongs()
+{
+    songHandoff_.store(SONGS_READY, std::memory_order_release);
+
+    TechnoMachine::EngineCommand command;
+    command.type = TechnoMachine::EngineCommand::Type::InstallSongs;
+    postCommand(command);
+}
+
+void AudioEngine::installSongs()
+{
+    // 音訊執行緒（或音訊啟動前）：交換只動 vector 指標
+    int expected = SONGS_READY;
+    if (!songHandoff_.compare_exchange_strong(expected, SONGS_SWAPPING, std::memory_order_acquire)) return;
+
+    transitionEngine_.getSongManager().swapSongs(stagedSongs_);
+    transitionEngine_.initialize();
+    songHandoff_.store(SONGS_IDLE, std::memory_order_release);
+    publishTransitionState();
+}
+
+void AudioEngine::publishTransitionState()
+{
+    currentSongIdx_.store(transitionEngine_.getSongManager().getCurrentSongIdx(), std::memory_order_relaxed);
+    transitioning_.store(transitionEngine_.isTransitioning(), std::memory_order_relaxed);
+    transitionProgress_.store(transitionEngine_.getTransitionProgress(), std::memory_order_relaxed);
 }
 
 void AudioEngine::applySynthModifiers()
@@ -64,9 +188,10 @@ void AudioEngine::applySynthModifiers()
     // 使用 crossfader 混合後的音色預設（直接混合風格參數）
     const auto mixed = patternEngine_.getMixedPresets();
 
-    // 直接套用混合後的參數
+    // 直接套用混合後的參數（乘上自動化的音色乘數）
     for (int v = 0; v < TechnoMachine::NUM_VOICES; v++) {
-        drums_.setVoiceParams(v, mixed.mode[v], mixed.freq[v], mixed.decay[v]);
+        drums_.setVoiceParams(v, mixed.mode[v], mixed.freq[v] * voiceFreqScale_[v],
+                              mixed.decay[v] * voiceDecayScale_[v]);
     }
 }
 
@@ -85,9 +210,13 @@ bool AudioEngine::isFillActive() const
     return patternEngine_.isFillActive();
 }
 
-void AudioEngine::setFillIntensity(float intensity)
+void AudioEngine::setFillIntensity(float intensity, Quantize quantize)
 {
-    patternEngine_.setFillIntensity(intensity);
+    TechnoMachine::EngineCommand command;
+    command.type = TechnoMachine::EngineCommand::Type::SetFillIntensity;
+    command.quantize = quantize;
+    command.value = intensity;
+    postCommand(command);
 }
 
 float AudioEngine::getFillIntensity() const
@@ -99,42 +228,77 @@ float AudioEngine::getFillIntensity() const
 
 void AudioEngine::setDensity(TechnoMachine::Role role, float density)
 {
-    patternEngine_.setDensity(role, density);
+    if (role < 0 || role >= TechnoMachine::NUM_ROLES) return;
+
+    // Message thread 的副本供 Deck 建構使用，音訊執行緒的副本由指令更新
+    roleDensities_[role] = std::clamp(density, 0.0f, 0.9f);
+
+    TechnoMachine::EngineCommand command;
+    command.type = TechnoMachine::EngineCommand::Type::SetDensity;
+    command.index = role;
+    command.value = roleDensities_[role];
+    postCommand(command);
 }
 
 float AudioEngine::getDensity(TechnoMachine::Role role) const
 {
-    return patternEngine_.getDensity(role);
+    if (role >= 0 && role < TechnoMachine::NUM_ROLES) {
+        return roleDensities_[role];
+    }
+    return 0.5f;
+}
+
+void AudioEngine::setPatternLength(int length)
+{
+    patternLength_ = TechnoMachine::Pattern::clampLength(length);
 }
 
 // === Playback Density（即時過濾）===
 
 void AudioEngine::setPlaybackDensity(TechnoMachine::Role role, float density)
 {
-    if (role >= 0 && role < TechnoMachine::NUM_ROLES) {
-        playbackDensity_[role] = std::clamp(density, 0.0f, 1.0f);
-    }
+    if (role < 0 || role >= TechnoMachine::NUM_ROLES) return;
+
+    TechnoMachine::EngineCommand command;
+    command.type = TechnoMachine::EngineCommand::Type::SetPlaybackDensity;
+    command.index = role;
+    command.value = std::clamp(density, 0.0f, 1.0f);
+    postCommand(command);
 }
 
 float AudioEngine::getPlaybackDensity(TechnoMachine::Role role) const
 {
+    // 音訊執行緒最後寫入的值（包含自動化；剛送出的指令尚未執行前仍是舊值）
     if (role >= 0 && role < TechnoMachine::NUM_ROLES) {
-        return playbackDensity_[role];
+        return playbackDensity_[role].load(std::memory_order_relaxed);
     }
     return 1.0f;
 }
 
 // === 風格控制 ===
 
-void AudioEngine::setStyle(int styleIdx)
+void AudioEngine::setStyle(int styleIdx, Quantize quantize)
 {
-    patternEngine_.setStyle(styleIdx);
-    regeneratePatterns(transitionEngine_.getCurrentVariation());
+    if (styleIdx < 0 || styleIdx >= TechnoMachine::getNumStyles()) return;
+
+    // 先登記安裝時機，再送出建構（結果不會在登記前被 bar 邊界安裝）
+    const int deck = patternEngine_.getActiveDeck();
+    TechnoMachine::EngineCommand command;
+    command.type = TechnoMachine::EngineCommand::Type::SetStyle;
+    command.quantize = quantize;
+    command.index = deck;
+    if (!postCommand(command)) return;
+
+    int roleStyles[TechnoMachine::NUM_ROLES];
+    for (int i = 0; i < TechnoMachine::NUM_ROLES; i++) {
+        roleStyles[i] = styleIdx;
+    }
+    requestDeckBuild(deck, roleStyles, patternEngine_.getDeckVariation(deck));
 }
 
-void AudioEngine::setStyle(TechnoMachine::StyleType style)
+void AudioEngine::setStyle(TechnoMachine::StyleType style, Quantize quantize)
 {
-    setStyle(static_cast<int>(style));
+    setStyle(static_cast<int>(style), quantize);
 }
 
 int AudioEngine::getStyleIdx() const
@@ -151,53 +315,75 @@ const char* AudioEngine::getStyleName() const
 
 void AudioEngine::generateRandomSet(int numSongs, int barsPerSong)
 {
-    transitionEngine_.getSongManager().generateRandomSet(numSongs, barsPerSong);
-    transitionEngine_.initialize();
+    numSongs_ = numSongs;
+    barsPerSong_ = barsPerSong;
+    stageSongs();
 
-    // 套用第一首歌的複合風格設定
-    const auto& song = transitionEngine_.getSongManager().getCurrentSong();
-    patternEngine_.setCompositeStyle(song.compositeStyle.roleStyles);
-    regeneratePatterns(song.variation);
+    // 第一首歌在背景生成到 Deck A，回到 Deck A
+    const auto& song = stagedSongs_.getCurrentSong();
+    requestDeckBuild(0, song.compositeStyle.roleStyles, song.variation);
+    setCrossfader(0.0f);
+    publishSongs();
 }
 
 void AudioEngine::setSongDuration(int bars)
 {
-    transitionEngine_.getSongManager().setAllSongDuration(bars);
+    // 與 SongManager::setAllSongDuration 相同的下限
+    for (auto& song : songList_) {
+        song.durationBars = std::max(8, bars);
+    }
+
+    TechnoMachine::EngineCommand command;
+    command.type = TechnoMachine::EngineCommand::Type::SetSongDuration;
+    command.index = bars;
+    postCommand(command);
 }
 
 void AudioEngine::setTransitionDuration(int bars)
 {
-    transitionEngine_.getSongManager().setTransitionDuration(bars);
+    transitionDurationBars_ = std::max(1, bars);
+
+    TechnoMachine::EngineCommand command;
+    command.type = TechnoMachine::EngineCommand::Type::SetTransitionDuration;
+    command.index = transitionDurationBars_;
+    postCommand(command);
 }
 
 int AudioEngine::getTransitionDuration() const
 {
-    return transitionEngine_.getSongManager().getTransitionDuration();
+    return transitionDurationBars_;
 }
 
 void AudioEngine::triggerNextSong()
 {
-    transitionEngine_.triggerTransition();
+    TechnoMachine::EngineCommand command;
+    command.type = TechnoMachine::EngineCommand::Type::TriggerTransition;
+    postCommand(command);
 }
 
 void AudioEngine::jumpToSong(int songIdx)
 {
-    transitionEngine_.jumpToSong(songIdx);
+    if (songIdx < 0 || songIdx >= static_cast<int>(songList_.size())) return;
 
-    // 套用新歌的複合風格設定
-    const auto& song = transitionEngine_.getSongManager().getCurrentSong();
-    patternEngine_.setCompositeStyle(song.compositeStyle.roleStyles);
-    regeneratePatterns(song.variation);
+    // 新歌在背景生成到 Deck A，回到 Deck A
+    const auto& song = songList_[static_cast<size_t>(songIdx)];
+    requestDeckBuild(0, song.compositeStyle.roleStyles, song.variation);
+    setCrossfader(0.0f);
+
+    TechnoMachine::EngineCommand command;
+    command.type = TechnoMachine::EngineCommand::Type::JumpToSong;
+    command.index = songIdx;
+    postCommand(command);
 }
 
 bool AudioEngine::isTransitioning() const
 {
-    return transitionEngine_.isTransitioning();
+    return transitioning_.load(std::memory_order_relaxed);
 }
 
 float AudioEngine::getTransitionProgress() const
 {
-    return transitionEngine_.getTransitionProgress();
+    return transitionProgress_.load(std::memory_order_relaxed);
 }
 
 void AudioEngine::applyTransitionParameters()
@@ -213,21 +399,23 @@ void AudioEngine::applyTransitionParameters()
     // float cutoff = transitionEngine_.getFilterCutoff();
 }
 
-void AudioEngine::processStep(int step)
+void AudioEngine::processStep(int64_t step)
 {
-    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-
+    // Pattern / 馬可夫鏈以各自的長度對絕對 step 取餘數（長度不是 16 的 pattern 也對齊）
+    // int 範圍在 132 BPM 下約可連續播放 7 年
     // 使用 Deck A/B 混音決策（根據 crossfader 位置）
-    // 每個 Role 合併 Primary/Secondary 觸發（Primary 優先）
+    // 每個 Role 合併 Primary/Secondary 觸發（Primary 優先），8 個 voice 一次算完
+    TechnoMachine::StepDecisions decisions;
+    patternEngine_.getStepDecisions(static_cast<int>(step), decisions);
+
     for (int role = 0; role < TechnoMachine::NUM_ROLES; role++) {
-        auto decision = patternEngine_.getMergedDecision(
-            static_cast<TechnoMachine::Role>(role), step);
+        const auto& decision = decisions.merged[role];
         if (decision.shouldTrigger) {
             // 套用 playback density 過濾
-            float density = playbackDensity_[role];
+            float density = playbackDensity_[role].load(std::memory_order_relaxed);
 
             // density = 1.0 時全部播放，density = 0.0 時全部靜音
-            if (density >= 1.0f || dist(densityRng_) < density) {
+            if (density >= 1.0f || densityRng_.nextFloat() < density) {
                 // 如果此 role 有 sample 則觸發 sample
                 if (sampleEngine_.hasSample(role)) {
                     sampleEngine_.triggerVoice(role, decision.velocity);
@@ -248,12 +436,101 @@ void AudioEngine::processStep(int step)
 
 // === 手動 Crossfader 控制 ===
 
-void AudioEngine::setCrossfader(float position)
+void AudioEngine::setCrossfader(float position, Quantize quantize)
+{
+    TechnoMachine::EngineCommand command;
+    command.type = TechnoMachine::EngineCommand::Type::SetCrossfader;
+    command.quantize = quantize;
+    command.value = position;
+    postCommand(command);
+}
+
+void AudioEngine::applyCrossfader(float position)
 {
     patternEngine_.setCrossfader(position);
 
     // 即時更新音色參數
     applySynthModifiers();
+    deckStateVersion_.fetch_add(1, std::memory_order_release);
+}
+
+// === 自動化 ===
+
+void AudioEngine::scheduleAutomation(int target, float value, float delaySteps, float lengthSteps, Quantize quantize)
+{
+    TechnoMachine::EngineCommand command;
+    command.type = TechnoMachine::EngineCommand::Type::ScheduleAutomation;
+    command.quantize = quantize;
+    command.index = target;
+    command.value = value;
+    command.delay = std::max(0.0f, delaySteps);
+    command.length = std::max(0.0f, lengthSteps);
+    postCommand(command);
+}
+
+void AudioEngine::cancelAutomation(int target)
+{
+    TechnoMachine::EngineCommand command;
+    command.type = TechnoMachine::EngineCommand::Type::CancelAutomation;
+    command.index = target;
+    postCommand(command);
+}
+
+void AudioEngine::evaluateAutomation()
+{
+    using namespace TechnoMachine;
+
+    if (!automation_.isActive()) return;
+
+    float values[NUM_AUTOMATION_TARGETS];
+    values[AUTOMATION_FILL_INTENSITY] = patternEngine_.getFillIntensity();
+    values[AUTOMATION_CROSSFADER] = patternEngine_.getCrossfader();
+    for (int i = 0; i < NUM_ROLES; i++) {
+        values[AUTOMATION_PLAYBACK_DENSITY + i] = playbackDensity_[i].load(std::memory_order_relaxed);
+    }
+    for (int v = 0; v < NUM_VOICES; v++) {
+        values[AUTOMATION_VOICE_FREQ + v] = voiceFreqScale_[v];
+        values[AUTOMATION_VOICE_DECAY + v] = voiceDecayScale_[v];
+    }
+    values[AUTOMATION_FILL_INTERVAL] = static_cast<float>(patternEngine_.getFillInterval());
+
+    const uint32_t changed = automation_.evaluate(musicalPosition_, values);
+    if (changed == 0) return;
+
+    auto isChanged = [changed](int target) { return (changed & (1u << target)) != 0; };
+
+    // Fill 只在值改變時重新選擇（selectFill 不配置記憶體）
+    if (isChanged(AUTOMATION_FILL_INTENSITY) && values[AUTOMATION_FILL_INTENSITY] != patternEngine_.getFillIntensity()) {
+        patternEngine_.setFillIntensity(values[AUTOMATION_FILL_INTENSITY]);
+    }
+    if (isChanged(AUTOMATION_FILL_INTERVAL)) {
+        patternEngine_.setFillInterval(static_cast<int>(std::lround(values[AUTOMATION_FILL_INTERVAL])));
+    }
+    for (int i = 0; i < NUM_ROLES; i++) {
+        if (isChanged(AUTOMATION_PLAYBACK_DENSITY + i)) {
+            playbackDensity_[i].store(std::clamp(values[AUTOMATION_PLAYBACK_DENSITY + i], 0.0f, 1.0f),
+                                      std::memory_order_relaxed);
+        }
+    }
+
+    bool voicesChanged = false;
+    for (int v = 0; v < NUM_VOICES; v++) {
+        if (isChanged(AUTOMATION_VOICE_FREQ + v)) {
+            voiceFreqScale_[v] = std::clamp(values[AUTOMATION_VOICE_FREQ + v], 0.25f, 4.0f);
+            voicesChanged = true;
+        }
+        if (isChanged(AUTOMATION_VOICE_DECAY + v)) {
+            voiceDecayScale_[v] = std::clamp(values[AUTOMATION_VOICE_DECAY + v], 0.1f, 4.0f);
+            voicesChanged = true;
+        }
+    }
+
+    if (isChanged(AUTOMATION_CROSSFADER) && values[AUTOMATION_CROSSFADER] != patternEngine_.getCrossfader()) {
+        // applyCrossfader 會一併更新音色
+        applyCrossfader(values[AUTOMATION_CROSSFADER]);
+    } else if (voicesChanged) {
+        applySynthModifiers();
+    }
 }
 
 float AudioEngine::getCrossfader() const
@@ -263,14 +540,20 @@ float AudioEngine::getCrossfader() const
 
 void AudioEngine::loadNextSong()
 {
-    // 推進 SongManager 到下一首
-    transitionEngine_.getSongManager().advanceToNextSong();
+    if (songList_.empty()) return;
 
-    // 取得新歌資訊
-    const auto& nextSong = transitionEngine_.getSongManager().getNextSong();
+    // 音訊執行緒的 SongManager 前進到下一首；要載入的是它之後的那首
+    TechnoMachine::EngineCommand command;
+    command.type = TechnoMachine::EngineCommand::Type::AdvanceSong;
+    postCommand(command);
+
+    const size_t numSongs = songList_.size();
+    const size_t current = static_cast<size_t>(currentSongIdx_.load(std::memory_order_relaxed));
+    const auto& nextSong = songList_[(current + 2) % numSongs];
 
-    // 載入到非作用中的 Deck
-    patternEngine_.loadNextSong(nextSong.compositeStyle.roleStyles, nextSong.variation);
+    // 載入到非作用中的 Deck（crossfader 在 A 時載入 B，反之亦然）
+    int targetDeck = (patternEngine_.getCrossfader() < 0.5f) ? 1 : 0;
+    requestDeckBuild(targetDeck, nextSong.compositeStyle.roleStyles, nextSong.variation);
 }
 
 const char* AudioEngine::getDeckAStyleName() const
@@ -291,32 +574,230 @@ const char* AudioEngine::getDeckRoleStyleName(int deck, TechnoMachine::Role role
 void AudioEngine::loadToDeck(int deck)
 {
     // 生成隨機複合風格
-    std::random_device rd;
-    std::mt19937 rng(rd());
-    std::uniform_int_distribution<int> styleDist(0, TechnoMachine::NUM_STYLES - 1);
-    std::uniform_real_distribution<float> varDist(0.2f, 0.7f);
-
+    const int numStyles = TechnoMachine::getNumStyles();
     int roleStyles[TechnoMachine::NUM_ROLES];
     for (int i = 0; i < TechnoMachine::NUM_ROLES; i++) {
-        roleStyles[i] = styleDist(rng);
+        roleStyles[i] = deckLoadRng_.uniformInt(0, numStyles - 1);
+    }
+
+    float variation = deckLoadRng_.uniform(0.2f, 0.7f);
+    requestDeckBuild(deck, roleStyles, variation);
+}
+
+void AudioEngine::requestDeckBuild(int deck, const int* roleStyles, float variation)
+{
+    // 生成參數在此取樣，worker 不讀取 pattern engine
+    TechnoMachine::DeckBuilder::Request request;
+    request.deck = deck;
+    for (int i = 0; i < TechnoMachine::NUM_ROLES; i++) {
+        request.roleStyles[i] = roleStyles[i];
+        request.roleDensities[i] = roleDensities_[i];
+    }
+    request.variation = variation;
+    request.length = patternLength_;
+    request.seed = deckBuildRng_.nextU64();
+
+    // Pattern bank 命中：以同一個 seed 選 variant，解碼後直接發布
+    if (patternBank_.isLoaded()) {
+        auto built = std::make_unique<TechnoMachine::Deck>();
+        if (patternBank_.load(request.roleStyles, request.variation, request.roleDensities, request.length,
+                              request.seed, *built)) {
+            deckBuilder_.submitReady(deck, std::move(built));
+            return;
+        }
     }
 
-    float variation = varDist(rng);
-    patternEngine_.loadToDeck(deck, roleStyles, variation);
+    deckBuilder_.requestBuild(request);
+}
+
+bool AudioEngine::loadPatternBank(const juce::File& file)
+{
+    auto mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+
+    TechnoMachine::PatternBank bank;
+    if (!bank.attach(mapped->getData(), mapped->getSize())) {
+        DBG("AudioEngine: invalid pattern bank " << file.getFullPathName());
+        return false;
+    }
+
+    patternBank_ = bank;
+    patternBankFile_ = std::move(mapped);
+    return true;
+}
+
+void AudioEngine::installReadyDecks(Quantize reached)
+{
+    bool installed = false;
+
+    for (int deck = 0; deck < 2; deck++) {
+        if (reached < deckInstallQuantize_[deck]) continue;
+
+        // 沒有回收位置時留到下一個邊界（不在音訊執行緒釋放）
+        if (!deckBuilder_.hasReady(deck) || !deckBuilder_.canRetire()) continue;
+
+        if (auto* incoming = deckBuilder_.takeReady(deck)) {
+            deckBuilder_.retire(patternEngine_.installDeck(deck, incoming));
+            deckInstallQuantize_[deck] = Quantize::NextBar;
+            installed = true;
+        }
+    }
 
-    // 如果載入的是當前作用中的 Deck，更新音色
-    if ((deck == 0 && patternEngine_.getCrossfader() < 0.5f) ||
-        (deck == 1 && patternEngine_.getCrossfader() >= 0.5f)) {
+    if (installed) {
+        // 混合音色取決於兩個 Deck
         applySynthModifiers();
+        deckStateVersion_.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void AudioEngine::installReadySamples()
+{
+    for (int v = 0; v < TechnoMachine::NUM_VOICES; v++) {
+        // 沒有回收位置時留到下一個 block（不在音訊執行緒釋放）
+        if (!sampleLoader_.hasReady(v) || !sampleLoader_.canRetire()) continue;
+
+        if (auto* incoming = sampleLoader_.takeReady(v)) {
+            installedSampleGenerations_[v].store(incoming->generation, std::memory_order_release);
+            sampleLoader_.retire(sampleEngine_.installSample(v, incoming));
+        }
     }
 }
 
-AudioEngine::StereoOutput AudioEngine::process(const Transport& transport)
+void AudioEngine::processStopped()
+{
+    drainCommands();
+    installReadySamples();
+    evaluateAutomation();
+    installReadyDecks(Quantize::NextBar);
+}
+
+// === UI → 音訊指令 ===
+
+bool AudioEngine::postCommand(const TechnoMachine::EngineCommand& command)
 {
-    // Check for new bar (Fill 觸發 + TransitionEngine 更新)
-    int currentBar = transport.getCurrentBar();
-    if (transport.isBarStart() && currentBar != lastBar_) {
-        patternEngine_.notifyBarStart(currentBar);
+    // 佇列滿時丟棄（UI 會在下次操作時再送出最新值）
+    return commandQueue_.push(command);
+}
+
+void AudioEngine::drainCommands()
+{
+    TechnoMachine::EngineCommand command;
+
+    while (numPendingCommands_ < MAX_PENDING_COMMANDS && commandQueue_.pop(command)) {
+        // SetStyle 的 quantize 是 Deck 的安裝時機，取出時就登記
+        bool deferred = command.quantize != Quantize::Now && command.type != TechnoMachine::EngineCommand::Type::SetStyle;
+        if (deferred) {
+            pendingCommands_[numPendingCommands_++] = command;
+        } else {
+            executeCommand(command);
+        }
+    }
+}
+
+void AudioEngine::executePendingCommands(Quantize reached)
+{
+    // 依送出順序執行已到達邊界的指令，其餘往前壓縮
+    int kept = 0;
+    for (int i = 0; i < numPendingCommands_; i++) {
+        const auto& command = pendingCommands_[i];
+        if (command.quantize > reached) {
+            pendingCommands_[kept++] = command;
+        } else {
+            executeCommand(command);
+        }
+    }
+    numPendingCommands_ = kept;
+}
+
+void AudioEngine::executeCommand(const TechnoMachine::EngineCommand& command)
+{
+    using Type = TechnoMachine::EngineCommand::Type;
+
+    switch (command.type) {
+        case Type::SetCrossfader:
+            applyCrossfader(command.value);
+            break;
+        case Type::SetFillIntensity:
+            patternEngine_.setFillIntensity(command.value);
+            break;
+        case Type::SetStyle:
+            deckInstallQuantize_[(command.index == 0) ? 0 : 1] = command.quantize;
+            break;
+        case Type::SetSeed:
+            applySeed(command.seed);
+            break;
+        case Type::SetDensity:
+            patternEngine_.setDensity(static_cast<TechnoMachine::Role>(command.index), command.value);
+            break;
+        case Type::SetPlaybackDensity:
+            playbackDensity_[command.index].store(command.value, std::memory_order_relaxed);
+            break;
+        case Type::InstallSongs:
+            installSongs();
+            break;
+        case Type::TriggerTransition:
+            transitionEngine_.triggerTransition();
+            publishTransitionState();
+            break;
+        case Type::JumpToSong:
+            // 無效的 index 會讓 TransitionEngine::jumpToSong 無法停止
+            if (command.index >= 0 && command.index < transitionEngine_.getSongManager().getSongCount()) {
+                transitionEngine_.jumpToSong(command.index);
+                publishTransitionState();
+            }
+            break;
+        case Type::AdvanceSong:
+            transitionEngine_.getSongManager().advanceToNextSong();
+            publishTransitionState();
+            break;
+        case Type::SetSongDuration:
+            transitionEngine_.getSongManager().setAllSongDuration(command.index);
+            break;
+        case Type::SetTransitionDuration:
+            transitionEngine_.getSongManager().setTransitionDuration(command.index);
+            break;
+        case Type::ScheduleAutomation: {
+            // 量化的 lane 從到達的邊界（最近的 step）起算，Now 從目前位置起算
+            double start = (command.quantize == Quantize::Now) ? musicalPosition_ : std::round(musicalPosition_);
+            automation_.schedule(command.index, start + command.delay, command.length, command.value);
+            break;
+        }
+        case Type::CancelAutomation: {
+            // CancelAutomation 一律是 Now，只在 drainCommands 中執行（不在 executePendingCommands 的迴圈內）
+            int kept = 0;
+            for (int i = 0; i < numPendingCommands_; i++) {
+                const auto& pending = pendingCommands_[i];
+                bool cancelled = pending.type == Type::ScheduleAutomation
+                              && (command.index < 0 || pending.index == command.index);
+                if (!cancelled) pendingCommands_[kept++] = pending;
+            }
+            numPendingCommands_ = kept;
+            automation_.cancel(command.index);
+            break;
+        }
+    }
+}
+
+void AudioEngine::handleTransportEvent(const TransportEvent& event)
+{
+    musicalPosition_ = event.position;
+
+    // 量化指令在事件處理前執行（bar > beat > step）
+    const Quantize reached = event.barStart  ? Quantize::NextBar
+                           : event.beatStart ? Quantize::NextBeat
+                                             : Quantize::NextStep;
+    if (numPendingCommands_ > 0) {
+        executePendingCommands(reached);
+    }
+
+    // 自動化在 step 之前更新（fill / density 對這一步生效）
+    evaluateAutomation();
+
+    // 背景建好的 Deck 在登記的邊界安裝（預設小節開頭）
+    installReadyDecks(reached);
+
+    // 新小節（Fill 觸發 + TransitionEngine 更新）
+    if (event.barStart) {
+        patternEngine_.notifyBarStart(event.bar);
         transitionEngine_.notifyBarStart();
 
         // 如果過渡中，推進 crossfade 進度
@@ -324,29 +805,49 @@ AudioEngine::StereoOutput AudioEngine::process(const Transport& transport)
             patternEngine_.notifyCrossfadeBarStart();
             applyTransitionParameters();
         }
-
-        lastBar_ = currentBar;
+        publishTransitionState();
     }
 
-    // Check for new step
-    int currentStep = transport.getCurrentSixteenth();
+    // 每個事件都是新的一步
+    processStep(event.step);
+}
 
-    if (transport.isSixteenthStart() && currentStep != lastStep_) {
-        processStep(currentStep);
-        lastStep_ = currentStep;
-    }
+void AudioEngine::renderBlock(float* left, float* right, int numSamples)
+{
+    if (numSamples <= 0) return;
 
-    // Process all drum voices
-    auto synthOutput = drums_.process();
+    // Synth 覆寫輸出，samples 疊加
+    drums_.processBlock(left, right, numSamples);
+    sampleEngine_.processBlock(left, right, numSamples);
+}
 
-    // Process samples
-    auto sampleOutput = sampleEngine_.process();
+void AudioEngine::processBlock(Transport& transport, float* left, float* right, int numSamples)
+{
+    musicalPosition_ = transport.getPositionInSixteenths();
+    drainCommands();
+    installReadyDecks(Quantize::Now);
+    installReadySamples();
+
+    // 每個 block 開頭內插一次，16 分音符邊界再各一次（handleTransportEvent）
+    evaluateAutomation();
+
+    int blockStart = 0;
+    while (blockStart < numSamples) {
+        // Transport 直接跳到每個 16 分音符邊界；事件列表滿時分段推進
+        int advanced = transport.advanceBlock(numSamples - blockStart, transportEvents_);
+
+        // 渲染事件前的 sub-block，再觸發 step（事件 sample 屬於下一段）
+        int segmentStart = blockStart;
+        for (const auto& event : transportEvents_) {
+            int eventStart = blockStart + event.offset;
+            renderBlock(left + segmentStart, right + segmentStart, eventStart - segmentStart);
+            segmentStart = eventStart;
+            handleTransportEvent(event);
+        }
 
-    // Mix synth + samples
-    return {
-        synthOutput.left + sampleOutput.left,
-        synthOutput.right + sampleOutput.right
-    };
+        blockStart += advanced;
+        renderBlock(left + segmentStart, right + segmentStart, blockStart - segmentStart);
+    }
 }
 
 // === CV 輸出支援 ===
@@ -374,25 +875,78 @@ void AudioEngine::clearTriggerFlags()
 
 bool AudioEngine::loadSample(int voiceIdx, const juce::File& file)
 {
-    return sampleEngine_.loadSample(voiceIdx, file);
+    if (voiceIdx < 0 || voiceIdx >= TechnoMachine::NUM_VOICES) return false;
+    if (!file.existsAsFile()) return false;
+
+    requestSample(voiceIdx, file);
+    return true;
 }
 
 void AudioEngine::clearSample(int voiceIdx)
 {
-    sampleEngine_.clearSample(voiceIdx);
+    if (voiceIdx < 0 || voiceIdx >= TechnoMachine::NUM_VOICES) return;
+
+    requestSample(voiceIdx, juce::File());
+}
+
+void AudioEngine::requestSample(int voiceIdx, const juce::File& file)
+{
+    // 名稱與路徑等到音訊執行緒安裝了這個要求的結果才生效（updateSampleStatus）
+    pendingSampleGenerations_[voiceIdx] = sampleLoader_.requestLoad(voiceIdx, file);
+    pendingSampleNames_[voiceIdx] = file.getFileName();
+    pendingSamplePaths_[voiceIdx] = file.getFullPathName();
+    sampleLoadPending_[voiceIdx] = true;
+    sampleLoadFailed_[voiceIdx] = false;
+}
+
+AudioEngine::SampleStatusUpdate AudioEngine::updateSampleStatus()
+{
+    SampleStatusUpdate update;
+    for (int v = 0; v < TechnoMachine::NUM_VOICES; v++) {
+        if (!sampleLoadPending_[v]) continue;
+
+        const uint32_t generation = pendingSampleGenerations_[v];
+        if (installedSampleGenerations_[v].load(std::memory_order_acquire) == generation) {
+            sampleNames_[v] = pendingSampleNames_[v];
+            samplePaths_[v] = pendingSamplePaths_[v];
+            sampleLoadPending_[v] = false;
+            update.installed = true;
+        } else if (sampleLoader_.getFailedGeneration(v) == generation) {
+            // 原本的 sample 繼續使用
+            sampleLoadPending_[v] = false;
+            sampleLoadFailed_[v] = true;
+            update.failed = true;
+        }
+    }
+    return update;
+}
+
+bool AudioEngine::isSampleLoadPending(int voiceIdx) const
+{
+    if (voiceIdx < 0 || voiceIdx >= TechnoMachine::NUM_VOICES) return false;
+    return sampleLoadPending_[voiceIdx];
+}
+
+bool AudioEngine::hasSampleLoadFailed(int voiceIdx) const
+{
+    if (voiceIdx < 0 || voiceIdx >= TechnoMachine::NUM_VOICES) return false;
+    return sampleLoadFailed_[voiceIdx];
 }
 
 bool AudioEngine::hasSample(int voiceIdx) const
 {
-    return sampleEngine_.hasSample(voiceIdx);
+    if (voiceIdx < 0 || voiceIdx >= TechnoMachine::NUM_VOICES) return false;
+    return samplePaths_[voiceIdx].isNotEmpty();
 }
 
 juce::String AudioEngine::getSampleName(int voiceIdx) const
 {
-    return sampleEngine_.getSampleName(voiceIdx);
+    if (voiceIdx < 0 || voiceIdx >= TechnoMachine::NUM_VOICES) return "";
+    return sampleNames_[voiceIdx];
 }
 
 juce::String AudioEngine::getSamplePath(int voiceIdx) const
 {
-    return sampleEngine_.getSamplePath(voiceIdx);
+    if (voiceIdx < 0 || voiceIdx >= TechnoMachine::NUM_VOICES) return "";
+    return samplePaths_[voiceIdx];
 }
@@ -2,51 +2,84 @@
 
 #include <JuceHeader.h>
 #include <random>
+#include <atomic>
+#include <vector>
 #include "../Synthesis/MinimalDrumSynth.h"
 #include "../Synthesis/SampleEngine.h"
+#include "../Synthesis/SampleLoader.h"
 #include "../Sequencer/TechnoPattern.h"
+#include "../Sequencer/DeckBuilder.h"
+#include "../Sequencer/PatternBank.h"
 #include "../Arrangement/TransitionEngine.hpp"
-
-class Transport;
+#include "AutomationEngine.h"
+#include "CommandQueue.h"
+#include "RandomStream.h"
+#include "SetCode.h"
+#include "Transport.h"
 
 class AudioEngine
 {
 public:
-    struct StereoOutput {
-        float left;
-        float right;
-    };
+    using Quantize = TechnoMachine::Quantize;
 
     AudioEngine();
     ~AudioEngine();
 
     void prepare(double sampleRate, int samplesPerBlock);
-    StereoOutput process(const Transport& transport);
 
-    void regeneratePatterns(float variation = 0.1f);
+    // 區塊處理：推進 transport 並渲染 numSamples 個 sample 到 left/right（覆寫）
+    // 在 transport 回報的 16 分音符事件處切分 sub-block，每段以緊密迴圈渲染
+    void processBlock(Transport& transport, float* left, float* right, int numSamples);
+
+    // 音訊執行緒：取出 UI 指令（processBlock 開頭自動呼叫）
+    // Quantize::Now 立即執行，其餘保留到對應的 step / beat / bar 邊界
+    void drainCommands();
+
+    // 音訊執行緒：停止播放時每個 block 呼叫（套用指令，背景建好的 Deck 立即安裝）
+    void processStopped();
+
+    // 每次音訊執行緒套用 crossfader 指令或安裝新 Deck 時遞增（UI 用來同步 swing 顯示）
+    uint32_t getDeckStateVersion() const { return deckStateVersion_.load(std::memory_order_acquire); }
+
+    // === Seed / Set 代碼 ===
+    // 引擎所有隨機性都由單一 64-bit seed 導出（預設在建構時隨機選擇）
+    void setSeed(uint64_t seed);
+    uint64_t getSeed() const { return seed_; }
+
+    // 目前的 seed + 參數（tempo / swing 由 Transport 持有，由呼叫端提供 / 套用）
+    TechnoMachine::SetCode makeSetCode(double tempo, int swingLevel) const;
+    // 設定 seed 與參數，重建歌曲序列並載入前兩首到 Deck A / B
+    // 歌曲序列在 message thread 生成，由音訊執行緒在下一個 block 換入（InstallSongs）
+    void applySetCode(const TechnoMachine::SetCode& code);
 
     // Fill 控制
     void setFillInterval(int bars);
     int getFillInterval() const;
-    void setFillIntensity(float intensity);
+    void setFillIntensity(float intensity, Quantize quantize = Quantize::Now);
     float getFillIntensity() const;
     bool isFillActive() const;
 
-    // Density 控制（生成時使用）
+    // Density 控制（生成時使用，馬可夫補打也會參考）；下一次 Deck 載入生效
     void setDensity(TechnoMachine::Role role, float density);
     float getDensity(TechnoMachine::Role role) const;
 
+    // Pattern 長度（1-64 步）；下一次 Deck 載入生效
+    void setPatternLength(int length);
+    int getPatternLength() const { return patternLength_; }
+
     // Playback Density（即時過濾，不重新生成）
     void setPlaybackDensity(TechnoMachine::Role role, float density);
     float getPlaybackDensity(TechnoMachine::Role role) const;
 
-    // 風格控制
-    void setStyle(int styleIdx);
-    void setStyle(TechnoMachine::StyleType style);
+    // 風格控制：作用中的 Deck 以新風格在背景重新生成（保留 variation），在 quantize 邊界安裝
+    void setStyle(int styleIdx, Quantize quantize = Quantize::Now);
+    void setStyle(TechnoMachine::StyleType style, Quantize quantize = Quantize::Now);
     int getStyleIdx() const;
     const char* getStyleName() const;
 
     // DJ Set 控制
+    // 新的歌曲序列在 message thread 生成，音訊執行緒在下一個 block 換入；第一首在背景載入 Deck A
+    // TransitionEngine / SongManager 屬於音訊執行緒：以下操作只送出指令，查詢讀取音訊執行緒發布的副本
     void generateRandomSet(int numSongs, int barsPerSong = 0);
     void triggerNextSong();
     void jumpToSong(int songIdx);
@@ -59,29 +92,59 @@ public:
     int getTransitionDuration() const;
 
     // === 手動 Crossfader 控制 ===
-    void setCrossfader(float position);  // 0.0 = Deck A, 1.0 = Deck B
+    // UI 端的 set* / load* 只送出指令，由音訊執行緒在指定時機套用
+    void setCrossfader(float position, Quantize quantize = Quantize::Now);  // 0.0 = Deck A, 1.0 = Deck B
     float getCrossfader() const;
+    // Deck 載入在背景執行緒生成，完成後於下一個 bar 邊界安裝（停止播放時立即安裝）
     void loadNextSong();                 // 載入下一首到非作用中的 Deck
     void loadToDeck(int deck);           // 載入隨機歌曲到指定 Deck (0=A, 1=B)
     const char* getDeckAStyleName() const;
     const char* getDeckBStyleName() const;
     const char* getDeckRoleStyleName(int deck, TechnoMachine::Role role) const;
 
+    // 預先生成的 Deck 資料庫（Tools/PatternBankBuilder）：命中時 Deck 載入只需查表，不生成
+    // 建構時自動載入 patterns.tmpb（搜尋路徑同 styles.tmsb）
+    bool loadPatternBank(const juce::File& file);
+    bool hasPatternBank() const { return patternBank_.isLoaded(); }
+
+    // === 自動化（Build-up / macro 動作）===
+    // 在音訊執行緒以音樂時間內插（見 AutomationEngine.h），target = TechnoMachine::AutomationTarget
+    // lane 從 quantize 邊界後 delaySteps 步開始，lengthSteps 步內由當時的值線性移到 value（0 = 直接跳到）
+    void scheduleAutomation(int target, float value, float delaySteps, float lengthSteps,
+                            Quantize quantize = Quantize::NextBar);
+    // 立即取消（target = -1：全部），包含尚未到達邊界的排程；參數停在目前的值
+    void cancelAutomation(int target = -1);
+    // 0-1，結束後保持 1；-1 = 沒有排程
+    float getAutomationProgress(int target) const { return automation_.getProgress(target); }
+
     // Swing: 取得當前混合後的風格 swing 值
     float getStyleSwing() const { return patternEngine_.getMixedSwing(); }
 
     // 子系統存取
     TechnoMachine::MinimalDrumSynth& drums() { return drums_; }
     TechnoMachine::TechnoPatternEngine& patternEngine() { return patternEngine_; }
-    TechnoMachine::TransitionEngine& transitionEngine() { return transitionEngine_; }
+    TechnoMachine::TransitionEngine& transitionEngine() { return transitionEngine_; }   // 音訊執行緒專用
     TechnoMachine::SampleEngine& sampleEngine() { return sampleEngine_; }
 
-    // Sample 控制 (voiceIdx = 0-7)
+    // Sample 控制 (voiceIdx = 0-3)
+    // 解碼與 resample 在 SampleLoader 的背景執行緒完成，音訊執行緒在下一個 block 安裝
+    // （正在播放的舊 sample 會播完這一下）；loadSample 回傳 true = 已送出要求
+    // 查詢函式回傳已安裝的 sample：updateSampleStatus 在安裝完成後才更新名稱與路徑，
+    // 載入失敗時保留原本的 sample 並標記 hasSampleLoadFailed
+    struct SampleStatusUpdate {
+        bool installed = false;     // 有 voice 安裝完成（名稱 / 路徑已更新）
+        bool failed = false;        // 有 voice 載入失敗
+    };
     bool loadSample(int voiceIdx, const juce::File& file);
     void clearSample(int voiceIdx);
+    SampleStatusUpdate updateSampleStatus();
+    bool isSampleLoadPending(int voiceIdx) const;
+    bool hasSampleLoadFailed(int voiceIdx) const;
     bool hasSample(int voiceIdx) const;
     juce::String getSampleName(int voiceIdx) const;
     juce::String getSamplePath(int voiceIdx) const;
+    // 長檔以串流播放（SampleStream）；背景讀取來不及時的 underrun 次數（任何執行緒）
+    uint64_t getSampleStreamUnderruns() const { return sampleEngine_.getStreamUnderruns(); }
 
     // CV 輸出支援：觸發追蹤
     bool wasVoiceTriggered(int voiceIdx) const;
@@ -96,22 +159,113 @@ private:
     TechnoMachine::SampleEngine sampleEngine_;
     TechnoMachine::TechnoPatternEngine patternEngine_;
     TechnoMachine::TransitionEngine transitionEngine_;
+    TechnoMachine::DeckBuilder deckBuilder_;
+    TechnoMachine::SampleLoader sampleLoader_;
 
-    int lastStep_ = -1;
-    int lastBar_ = -1;
+    // Message thread 專用；映射保持到下次載入或解構
+    TechnoMachine::PatternBank patternBank_;
+    std::unique_ptr<juce::MemoryMappedFile> patternBankFile_;
 
     // Playback density per role（1.0 = 全部播放，0.0 = 靜音）
-    float playbackDensity_[TechnoMachine::NUM_ROLES] = {1.0f, 1.0f, 1.0f, 1.0f};
+    // 只由音訊執行緒寫入（SetPlaybackDensity 指令、自動化）；atomic 讓 message thread 可以讀取
+    std::atomic<float> playbackDensity_[TechnoMachine::NUM_ROLES] = {{1.0f}, {1.0f}, {1.0f}, {1.0f}};
+
+    // 自動化的音色乘數（1.0 = 不變，套用在混合後的預設上）
+    float voiceFreqScale_[TechnoMachine::NUM_VOICES] = {1.0f, 1.0f, 1.0f, 1.0f};
+    float voiceDecayScale_[TechnoMachine::NUM_VOICES] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    // 音訊執行緒：自動化 lane 與目前的音樂位置（16 分音符）
+    TechnoMachine::AutomationEngine automation_;
+    double musicalPosition_ = 0.0;
+
+    // 音訊執行緒：Transport 每次推進回報的 16 分音符事件
+    TransportEventList transportEvents_;
 
-    // 用於 density 過濾的隨機數生成器
-    std::mt19937 densityRng_{std::random_device{}()};
+    // 用於 density 過濾的隨機數生成器（音訊執行緒）
+    TechnoMachine::RandomStream densityRng_;
+
+    // Message thread 端的隨機串流與 set 參數
+    uint64_t seed_ = 0;
+    int numSongs_ = 8;
+    int barsPerSong_ = 0;
+    int patternLength_ = 16;
+    // 生成用 density；音訊執行緒的副本（TechnoPatternEngine）經 SetDensity 更新
+    float roleDensities_[TechnoMachine::NUM_ROLES] = {
+        TechnoMachine::DEFAULT_ROLE_DENSITIES[0], TechnoMachine::DEFAULT_ROLE_DENSITIES[1],
+        TechnoMachine::DEFAULT_ROLE_DENSITIES[2], TechnoMachine::DEFAULT_ROLE_DENSITIES[3]};
+    TechnoMachine::RandomStream deckLoadRng_;
+    TechnoMachine::RandomStream deckBuildRng_;
+
+    // 新的歌曲序列：message thread 生成到 stagedSongs_，音訊執行緒以 swapSongs 換入 TransitionEngine
+    // songHandoff_ = SONGS_IDLE 時 stagedSongs_ 屬於 message thread；SONGS_READY 時等待交換；
+    // SONGS_SWAPPING 時音訊執行緒正在交換（只有指標操作，message thread 等它結束）
+    static constexpr int SONGS_IDLE = 0;
+    static constexpr int SONGS_READY = 1;
+    static constexpr int SONGS_SWAPPING = 2;
+    TechnoMachine::SongManager stagedSongs_;
+    std::atomic<int> songHandoff_{SONGS_IDLE};
+
+    // Message thread：最後發布的歌曲序列（選擇要載入的 Deck）與過渡長度
+    std::vector<TechnoMachine::Song> songList_;
+    int transitionDurationBars_ = 0;
+
+    // 音訊執行緒發布的歌曲 / 過渡狀態（任何執行緒讀取）
+    std::atomic<int> currentSongIdx_{0};
+    std::atomic<bool> transitioning_{false};
+    std::atomic<float> transitionProgress_{0.0f};
 
     // CV 輸出支援：觸發追蹤（4 聲道）
     bool voiceTriggered_[TechnoMachine::NUM_VOICES] = {false, false, false, false};
     float lastVelocity_[TechnoMachine::NUM_VOICES] = {0.0f, 0.0f, 0.0f, 0.0f};
 
-    void processStep(int step);
+    // UI → 音訊：指令佇列
+    static constexpr int MAX_PENDING_COMMANDS = 64;
+    TechnoMachine::SpscQueue<TechnoMachine::EngineCommand, 256> commandQueue_;
+
+    // 等待音樂邊界的指令（音訊執行緒專用）
+    TechnoMachine::EngineCommand pendingCommands_[MAX_PENDING_COMMANDS];
+    int numPendingCommands_ = 0;
+
+    std::atomic<uint32_t> deckStateVersion_{0};
+
+    // 各 Deck 背景建好的結果最早在哪種邊界安裝（音訊執行緒；SetStyle 登記，安裝後回到 NextBar）
+    Quantize deckInstallQuantize_[2] = {Quantize::NextBar, Quantize::NextBar};
+
+    // 音訊執行緒最後安裝的 SampleLoader 要求（SampleData::generation）
+    std::atomic<uint32_t> installedSampleGenerations_[TechnoMachine::NUM_VOICES] = {};
+
+    // UI 端 sample 狀態（message thread 專用）：已安裝的名稱 / 路徑與尚未完成的要求
+    juce::String sampleNames_[TechnoMachine::NUM_VOICES];
+    juce::String samplePaths_[TechnoMachine::NUM_VOICES];
+    juce::String pendingSampleNames_[TechnoMachine::NUM_VOICES];
+    juce::String pendingSamplePaths_[TechnoMachine::NUM_VOICES];
+    uint32_t pendingSampleGenerations_[TechnoMachine::NUM_VOICES] = {};
+    bool sampleLoadPending_[TechnoMachine::NUM_VOICES] = {};
+    bool sampleLoadFailed_[TechnoMachine::NUM_VOICES] = {};
+
+    void requestSample(int voiceIdx, const juce::File& file);
+
+    bool postCommand(const TechnoMachine::EngineCommand& command);
+    void executeCommand(const TechnoMachine::EngineCommand& command);
+    void executePendingCommands(Quantize reached);
+
+    void applyCrossfader(float position);
+    void applySeed(uint64_t seed);
+    void seedMessageThreadStreams(uint64_t seed);
+    void stageSongs();
+    void publishSongs();
+    void installSongs();
+    void publishTransitionState();
+
+    void requestDeckBuild(int deck, const int* roleStyles, float variation);
+    void installReadyDecks(Quantize reached);
+    void installReadySamples();
+
+    void processStep(int64_t step);
+    void handleTransportEvent(const TransportEvent& event);
+    void renderBlock(float* left, float* right, int numSamples);
     void applySynthModifiers();
+    void evaluateAutomation();
     void applyTransitionParameters();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioEngine)
@@ -0,0 +1,153 @@
+/**
+ * AutomationEngine.h
+ * Techno Machine - 音訊執行緒上的參數自動化
+ *
+ * Lane 以音樂時間表示（16 分音符），由 transport 位置內插，不依賴 UI timer：
+ * - 到達 start 時取樣參數當時的值，在 length 步內線性移到 endValue，之後保持 endValue
+ * - length = 0：到達 start 時直接跳到 endValue
+ * - 同一參數有多個 lane 時，依排程順序由後排的覆寫；結束的 lane 移除
+ * - Transport 重設（位置倒退）時，尚未結束的 lane 跟著平移，保持相對時間
+ *
+ * schedule / cancel / evaluate 只能在音訊執行緒呼叫（由 EngineCommand 送達）；
+ * getProgress 可在任何執行緒讀取（UI 顯示用）。
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include "../Synthesis/SynthTypes.h"
+
+namespace TechnoMachine {
+
+// 可自動化的參數（PLAYBACK_DENSITY + role、VOICE_FREQ / VOICE_DECAY + voice）
+enum AutomationTarget {
+    AUTOMATION_FILL_INTENSITY = 0,                                   // 0-1
+    AUTOMATION_CROSSFADER,                                           // 0 = Deck A, 1 = Deck B
+    AUTOMATION_PLAYBACK_DENSITY,                                     // 0-1
+    AUTOMATION_VOICE_FREQ = AUTOMATION_PLAYBACK_DENSITY + NUM_ROLES, // 音色頻率乘數（1.0 = 不變）
+    AUTOMATION_VOICE_DECAY = AUTOMATION_VOICE_FREQ + NUM_VOICES,     // 音色 decay 乘數（1.0 = 不變）
+    AUTOMATION_FILL_INTERVAL = AUTOMATION_VOICE_DECAY + NUM_VOICES,  // 小節數（取整數）
+    NUM_AUTOMATION_TARGETS
+};
+
+static_assert(NUM_AUTOMATION_TARGETS <= 32, "changed-target mask is 32 bits");
+
+struct AutomationLane {
+    int target = 0;
+    double start = 0.0;         // 絕對位置（16 分音符）
+    double length = 0.0;        // 步數
+    float startValue = 0.0f;    // 到達 start 時取樣
+    float endValue = 0.0f;
+    bool running = false;
+};
+
+class AutomationEngine {
+public:
+    static constexpr int MAX_LANES = 32;
+
+    AutomationEngine() {
+        for (auto& progress : progress_) {
+            progress.store(-1.0f, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * 加入 lane（已滿時回傳 false）
+     */
+    bool schedule(int target, double start, double length, float endValue) {
+        if (target < 0 || target >= NUM_AUTOMATION_TARGETS || numLanes_ >= MAX_LANES) return false;
+
+        AutomationLane& lane = lanes_[numLanes_++];
+        lane.target = target;
+        lane.start = start;
+        lane.length = std::max(0.0, length);
+        lane.startValue = 0.0f;
+        lane.endValue = endValue;
+        lane.running = false;
+
+        progress_[target].store(0.0f, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * 移除 target 的所有 lane（target < 0 = 全部），參數停在目前的值
+     */
+    void cancel(int target) {
+        int kept = 0;
+        for (int i = 0; i < numLanes_; i++) {
+            if (target >= 0 && lanes_[i].target != target) {
+                lanes_[kept++] = lanes_[i];
+            }
+        }
+        numLanes_ = kept;
+
+        for (int t = 0; t < NUM_AUTOMATION_TARGETS; t++) {
+            if (target < 0 || t == target) {
+                progress_[t].store(-1.0f, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool isActive() const { return numLanes_ > 0; }
+
+    /**
+     * 計算 position 時各參數的值
+     * @param values 輸入目前的參數值，輸出自動化後的值
+     * @return 被 lane 寫入的參數（bit = target）
+     */
+    uint32_t evaluate(double position, float* values) {
+        if (position < lastPosition_) {
+            for (int i = 0; i < numLanes_; i++) {
+                lanes_[i].start += position - lastPosition_;
+            }
+        }
+        lastPosition_ = position;
+
+        uint32_t changed = 0;
+        int kept = 0;
+
+        for (int i = 0; i < numLanes_; i++) {
+            AutomationLane& lane = lanes_[i];
+            if (position < lane.start) {
+                lanes_[kept++] = lane;
+                continue;
+            }
+
+            if (!lane.running) {
+                lane.startValue = values[lane.target];
+                lane.running = true;
+            }
+
+            const double t = (lane.length > 0.0) ? std::min(1.0, (position - lane.start) / lane.length) : 1.0;
+            values[lane.target] = lane.startValue + (lane.endValue - lane.startValue) * static_cast<float>(t);
+            changed |= 1u << lane.target;
+            progress_[lane.target].store(static_cast<float>(t), std::memory_order_relaxed);
+
+            if (t < 1.0) {
+                lanes_[kept++] = lane;
+            }
+        }
+
+        numLanes_ = kept;
+        return changed;
+    }
+
+    /**
+     * 最近一個 lane 的進度（0-1，結束後保持 1；-1 = 沒有排程或已取消）
+     */
+    float getProgress(int target) const {
+        if (target < 0 || target >= NUM_AUTOMATION_TARGETS) return -1.0f;
+        return progress_[target].load(std::memory_order_relaxed);
+    }
+
+private:
+    AutomationLane lanes_[MAX_LANES];
+    int numLanes_ = 0;
+    double lastPosition_ = 0.0;
+
+    std::atomic<float> progress_[NUM_AUTOMATION_TARGETS];
+};
+
+} // namespace TechnoMachine
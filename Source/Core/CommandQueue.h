@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include "../Synthesis/SynthTypes.h"
+
+namespace TechnoMachine {
+
+/**
+ * Wait-free 單一生產者 / 單一消費者 ring buffer
+ * - push() 只能在生產者執行緒呼叫，pop() 只能在消費者執行緒呼叫
+ * - 滿 / 空時立即回傳 false，不阻塞、不配置記憶體
+ * - Capacity 必須是 2 的冪次；head/tail 為自由遞增的計數器，全部 Capacity 格都可用
+ */
+template <typename T, int Capacity>
+class SpscQueue {
+public:
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "SpscQueue items must be trivially copyable");
+
+    bool push(const T& item) {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) >= static_cast<uint32_t>(Capacity)) {
+            return false;
+        }
+        items_[tail & MASK] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items_[head & MASK];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 生產者端：是否還有空間（消費者可能同時取出，結果只會偏保守）
+    bool hasSpace() const {
+        return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire)
+               < static_cast<uint32_t>(Capacity);
+    }
+
+private:
+    static constexpr uint32_t MASK = static_cast<uint32_t>(Capacity - 1);
+
+    alignas(64) std::atomic<uint32_t> head_{0};  // 消費者寫入
+    alignas(64) std::atomic<uint32_t> tail_{0};  // 生產者寫入
+    T items_[Capacity];
+};
+
+/**
+ * 指令執行時機（音訊執行緒上的音樂邊界）
+ */
+enum class Quantize {
+    Now,        // 下一個 audio block 開頭
+    NextStep,   // 下一個 16 分音符
+    NextBeat,   // 下一拍
+    NextBar     // 下一小節
+};
+
+/**
+ * UI → 音訊執行緒指令
+ * 指令不配置記憶體、不做 I/O
+ * Deck 與 sample 載入不走指令佇列，由 DeckBuilder / SampleLoader 在背景完成後交給音訊執行緒安裝
+ * （歌曲序列同理：InstallSongs 只通知音訊執行緒交換已生成好的序列）
+ */
+struct EngineCommand {
+    enum class Type {
+        SetCrossfader,      // value = 位置
+        SetFillIntensity,   // value = intensity
+        SetStyle,           // index = Deck：取出時登記，該 Deck 下一個背景建好的結果在 quantize 邊界安裝
+        SetSeed,            // seed = 引擎 seed（重設音訊執行緒端的隨機串流）
+        ScheduleAutomation, // index = AutomationTarget，value = 終點值，delay / length = 步數（自執行時的 step 起算）
+        CancelAutomation,   // index = AutomationTarget（-1 = 全部），同時取消尚未到達邊界的 ScheduleAutomation
+        SetDensity,         // index = Role，value = 生成 / 馬可夫用 density
+        SetPlaybackDensity, // index = Role，value = playback density（0-1）
+        InstallSongs,       // 把 message thread 生成好的歌曲序列換進 TransitionEngine（見 AudioEngine::publishSongs）
+        TriggerTransition,  // 開始過渡到下一首歌
+        JumpToSong,         // index = 歌曲（立即切換，不經過過渡）
+        AdvanceSong,        // SongManager 前進到下一首（Deck 由 message thread 另外載入）
+        SetSongDuration,    // index = 每首小節數
+        SetTransitionDuration // index = 過渡小節數
+    };
+
+    Type type = Type::SetCrossfader;
+    Quantize quantize = Quantize::Now;
+    int index = 0;
+    float value = 0.0f;
+    uint64_t seed = 0;
+    float delay = 0.0f;
+    float length = 0.0f;
+};
+
+} // namespace TechnoMachine
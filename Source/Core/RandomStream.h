@@ -0,0 +1,161 @@
+/**
+ * RandomStream.h
+ * Techno Machine - 可重現的隨機數串流
+ *
+ * 整個引擎只有一個 64-bit seed，每個子系統 / 聲道由 (seed, stream id) 導出自己的串流：
+ * - Counter-based：第 n 個輸出 = SplitMix64(key + n * φ)，狀態只有 key + counter（16 bytes）
+ * - 不同 stream id 的 key 經過雜湊，串流之間互不相關
+ * - 分佈（UniformReal / UniformInt / shuffle）自行實作，不依賴各平台 <random> 的實作差異，
+ *   同一個 seed 在 macOS / Windows / Linux 產生完全相同的結果
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+namespace TechnoMachine {
+
+/**
+ * 子系統串流編號（新增時只能往後加，否則舊的 set code 會改變）
+ */
+enum class RandomStreamId : uint64_t {
+    SongManager     = 1,    // 歌曲序列
+    DeckLoad        = 2,    // UI 載入隨機 Deck 的風格 / variation
+    DeckBuild       = 3,    // 背景 Deck 生成（每個請求取一個子 seed）
+    PatternEngine   = 4,    // 同步生成（regenerate / fill）
+    MixDecision     = 5,    // Crossfader 機率混合
+    PlaybackDensity = 6,    // Playback density 過濾
+    Markov          = 0x100,  // + voice (0-7)
+    VoiceNoise      = 0x200   // 合成器噪音
+};
+
+namespace RandomDetail {
+    static constexpr uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ull;
+
+    inline uint64_t mix64(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+}
+
+class RandomStream {
+public:
+    using result_type = uint32_t;
+
+    RandomStream() : RandomStream(0, 0) {}
+
+    RandomStream(uint64_t seed, RandomStreamId id, uint64_t index = 0)
+        : RandomStream(seed, static_cast<uint64_t>(id) + index) {}
+
+    RandomStream(uint64_t seed, uint64_t streamId) { reset(seed, streamId); }
+
+    /**
+     * 由 (seed, stream) 導出串流 key（也用於產生子 seed）
+     */
+    static uint64_t deriveKey(uint64_t seed, uint64_t streamId) {
+        return RandomDetail::mix64(seed ^ RandomDetail::mix64(streamId * RandomDetail::GOLDEN_GAMMA + 1));
+    }
+
+    static uint64_t deriveKey(uint64_t seed, RandomStreamId id, uint64_t index = 0) {
+        return deriveKey(seed, static_cast<uint64_t>(id) + index);
+    }
+
+    void reset(uint64_t seed, uint64_t streamId) {
+        key_ = deriveKey(seed, streamId);
+        counter_ = 0;
+    }
+
+    void reset(uint64_t seed, RandomStreamId id, uint64_t index = 0) {
+        reset(seed, static_cast<uint64_t>(id) + index);
+    }
+
+    // 已取出的數量；可存下來之後用 setCounter 重播
+    uint64_t getCounter() const { return counter_; }
+    void setCounter(uint64_t counter) { counter_ = counter; }
+
+    uint64_t nextU64() {
+        return RandomDetail::mix64(key_ + (++counter_) * RandomDetail::GOLDEN_GAMMA);
+    }
+
+    // UniformRandomBitGenerator 介面
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return 0xFFFFFFFFu; }
+    result_type operator()() { return static_cast<result_type>(nextU64() >> 32); }
+
+    /**
+     * [0, 1) 均勻分佈，24-bit 精度
+     */
+    float nextFloat() {
+        return static_cast<float>(nextU64() >> 40) * (1.0f / 16777216.0f);
+    }
+
+    /**
+     * 一次取出 n 個 [0, 1) 值（各自獨立的 counter，迴圈無相依，可向量化）
+     * 結果與連續呼叫 n 次 nextFloat() 相同
+     */
+    void fill(float* out, int n) {
+        const uint64_t base = counter_;
+        for (int i = 0; i < n; i++) {
+            uint64_t x = RandomDetail::mix64(key_ + (base + static_cast<uint64_t>(i) + 1) * RandomDetail::GOLDEN_GAMMA);
+            out[i] = static_cast<float>(x >> 40) * (1.0f / 16777216.0f);
+        }
+        counter_ = base + static_cast<uint64_t>(n > 0 ? n : 0);
+    }
+
+    float uniform(float lo, float hi) {
+        return lo + (hi - lo) * nextFloat();
+    }
+
+    /**
+     * [lo, hi] 整數（含兩端），multiply-shift 映射
+     */
+    int uniformInt(int lo, int hi) {
+        if (hi <= lo) return lo;
+        uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(hi) - lo) + 1;
+        uint64_t r = static_cast<uint32_t>(nextU64() >> 32);
+        return lo + static_cast<int>((r * range) >> 32);
+    }
+
+    /**
+     * Fisher-Yates 洗牌
+     */
+    template <typename T>
+    void shuffle(T* data, int count) {
+        for (int i = count - 1; i > 0; i--) {
+            int j = uniformInt(0, i);
+            std::swap(data[i], data[j]);
+        }
+    }
+
+private:
+    uint64_t key_ = 0;
+    uint64_t counter_ = 0;
+};
+
+/**
+ * 與 std::uniform_real_distribution<float> 相同用法：dist(rng)
+ */
+class UniformReal {
+public:
+    UniformReal(float lo = 0.0f, float hi = 1.0f) : lo_(lo), hi_(hi) {}
+    float operator()(RandomStream& rng) const { return rng.uniform(lo_, hi_); }
+
+private:
+    float lo_, hi_;
+};
+
+/**
+ * 與 std::uniform_int_distribution<int> 相同用法（含兩端）
+ */
+class UniformInt {
+public:
+    UniformInt(int lo = 0, int hi = 1) : lo_(lo), hi_(hi) {}
+    int operator()(RandomStream& rng) const { return rng.uniformInt(lo_, hi_); }
+
+private:
+    int lo_, hi_;
+};
+
+} // namespace TechnoMachine
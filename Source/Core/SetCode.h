@@ -0,0 +1,107 @@
+/**
+ * SetCode.h
+ * Techno Machine - 可分享的 Set 代碼
+ *
+ * 引擎 seed + 影響生成與播放的主要參數，編碼成一行文字：
+ *
+ *   TM2-<seed 16 hex>-<BPM × 10>-<歌曲數>x<每首小節數>-<fill %>-<4 個 playback density %>
+ *      -<4 個生成 density %>-<swing 等級>-<pattern 長度>
+ *   例：TM2-9E3779B97F4A7C15-1320-8x0-50-100.100.100.100-40.20.50.50-1-16
+ *
+ * 每首小節數 0 表示隨機（32-128，由 seed 決定）
+ * 舊的 TM1 代碼（只到 playback density）仍可解析，其餘欄位使用預設值
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include "../Synthesis/SynthTypes.h"
+
+namespace TechnoMachine {
+
+struct SetCode {
+    uint64_t seed = 0;
+    double tempo = 132.0;
+    int numSongs = 8;
+    int barsPerSong = 0;
+    float fillIntensity = 0.5f;
+    float playbackDensities[NUM_ROLES] = {1.0f, 1.0f, 1.0f, 1.0f};
+    float roleDensities[NUM_ROLES] = {0.4f, 0.2f, 0.5f, 0.5f};   // 生成用 density
+    int swingLevel = 1;                                          // Transport swing 等級（0-3）
+    int patternLength = 16;
+
+    std::string toString() const {
+        char text[128];
+        std::snprintf(text, sizeof(text), "TM2-%016" PRIX64 "-%d-%dx%d-%d-%d.%d.%d.%d-%d.%d.%d.%d-%d-%d",
+                      seed,
+                      static_cast<int>(std::lround(tempo * 10.0)),
+                      numSongs, barsPerSong,
+                      toPercent(fillIntensity),
+                      toPercent(playbackDensities[0]), toPercent(playbackDensities[1]),
+                      toPercent(playbackDensities[2]), toPercent(playbackDensities[3]),
+                      toPercent(roleDensities[0]), toPercent(roleDensities[1]),
+                      toPercent(roleDensities[2]), toPercent(roleDensities[3]),
+                      swingLevel, patternLength);
+        return text;
+    }
+
+    /**
+     * 解析代碼，格式錯誤時回傳 false 且不修改 result
+     */
+    static bool parse(const std::string& text, SetCode& result) {
+        SetCode code;
+        uint64_t seed = 0;
+        int tempo10 = 0, songs = 0, bars = 0, fill = 0;
+        int d[NUM_ROLES] = {0, 0, 0, 0};
+        int g[NUM_ROLES] = {0, 0, 0, 0};
+        int swing = code.swingLevel, length = code.patternLength;
+        int consumed = 0;
+
+        int fields = std::sscanf(text.c_str(), " TM2-%16" SCNx64 "-%d-%dx%d-%d-%d.%d.%d.%d-%d.%d.%d.%d-%d-%d %n",
+                                 &seed, &tempo10, &songs, &bars, &fill,
+                                 &d[0], &d[1], &d[2], &d[3],
+                                 &g[0], &g[1], &g[2], &g[3], &swing, &length, &consumed);
+        if (fields == 15 && consumed == static_cast<int>(text.size())) {
+            for (int i = 0; i < NUM_ROLES; i++) {
+                code.roleDensities[i] = fromPercent(g[i]);
+            }
+        } else {
+            consumed = 0;
+            fields = std::sscanf(text.c_str(), " TM1-%16" SCNx64 "-%d-%dx%d-%d-%d.%d.%d.%d %n",
+                                 &seed, &tempo10, &songs, &bars, &fill,
+                                 &d[0], &d[1], &d[2], &d[3], &consumed);
+            if (fields != 9 || consumed != static_cast<int>(text.size())) return false;
+        }
+        if (tempo10 < 200 || tempo10 > 3000 || songs < 1 || songs > 64 || bars < 0 || bars > 1024) return false;
+        if (swing < 0 || swing > 3 || length < 1 || length > 64) return false;
+
+        code.seed = seed;
+        code.tempo = tempo10 / 10.0;
+        code.numSongs = songs;
+        code.barsPerSong = bars;
+        code.fillIntensity = fromPercent(fill);
+        for (int i = 0; i < NUM_ROLES; i++) {
+            code.playbackDensities[i] = fromPercent(d[i]);
+        }
+        code.swingLevel = swing;
+        code.patternLength = length;
+
+        result = code;
+        return true;
+    }
+
+private:
+    static int toPercent(float value) {
+        return static_cast<int>(std::lround(std::clamp(value, 0.0f, 1.0f) * 100.0f));
+    }
+
+    static float fromPercent(int percent) {
+        return static_cast<float>(std::clamp(percent, 0, 100)) / 100.0f;
+    }
+};
+
+} // namespace TechnoMachine
@@ -0,0 +1,80 @@
+/**
+ * StyleBankLoader.h
+ * Techno Machine - 啟動時載入訓練風格庫
+ *
+ * 以 memory map 開啟 styles.tmsb（Tools/StyleTrainer 產生），entry 直接登錄到 StyleRegistry，
+ * 不複製轉移次數；映射保持到程式結束。
+ *
+ * 搜尋順序（findDataFile，PatternBank 等其他離線資料檔也使用）：
+ * 1. <使用者應用程式資料>/MADZINE/TechnoMachine/<檔名>
+ * 2. 執行檔旁
+ *
+ * 必須在建立 AudioEngine 之前呼叫（馬可夫表建立後風格庫即鎖定）。
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+#include "../Sequencer/StyleProfiles.hpp"
+
+namespace TechnoMachine {
+
+class StyleBankLoader {
+public:
+    static constexpr const char* FILE_NAME = "styles.tmsb";
+
+    /**
+     * 載入第一個找到的風格庫，回傳登錄的風格數
+     */
+    static int loadDefault() {
+        juce::File file = findDataFile(FILE_NAME);
+        return file.existsAsFile() ? load(file) : 0;
+    }
+
+    /**
+     * 依搜尋順序找出資料檔，找不到時回傳空的 File
+     */
+    static juce::File findDataFile(const juce::String& fileName) {
+        const juce::File candidates[] = {
+            juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+                .getChildFile("MADZINE").getChildFile("TechnoMachine").getChildFile(fileName),
+            juce::File::getSpecialLocation(juce::File::currentExecutableFile)
+                .getParentDirectory().getChildFile(fileName)
+        };
+
+        for (const auto& file : candidates) {
+            if (file.existsAsFile()) return file;
+        }
+        return {};
+    }
+
+    static int load(const juce::File& file) {
+        auto mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+
+        int numEntries = 0;
+        const StyleBankEntry* entries = StyleBankFormat::entries(mapped->getData(), mapped->getSize(), numEntries);
+        if (entries == nullptr) {
+            DBG("StyleBankLoader: invalid style bank " << file.getFullPathName());
+            return 0;
+        }
+
+        int added = StyleRegistry::instance().addTrained(entries, numEntries);
+        DBG("StyleBankLoader: " << added << " styles from " << file.getFullPathName());
+
+        if (added > 0) {
+            mappings().push_back(std::move(mapped));
+        }
+        return added;
+    }
+
+private:
+    // 登錄的 entry 指向映射的記憶體，映射不釋放
+    static std::vector<std::unique_ptr<juce::MemoryMappedFile>>& mappings() {
+        static std::vector<std::unique_ptr<juce::MemoryMappedFile>> files;
+        return files;
+    }
+};
+
+} // namespace TechnoMachine
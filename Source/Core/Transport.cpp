@@ -2,6 +2,7 @@
 
 Transport::Transport()
 {
+    updateTempo();
 }
 
 Transport::~Transport()
@@ -10,13 +11,28 @@ Transport::~Transport()
 
 void Transport::prepare(double sampleRate)
 {
-    clock_.prepare(sampleRate);
+    sampleRate_ = sampleRate;
     reset();
+
+    // Force beatsPerSample_ to be recomputed for the new rate
+    appliedTempo_ = 0.0;
+    updateTempo();
 }
 
 void Transport::setTempo(double bpm)
 {
-    clock_.setTempo(bpm);
+    requestedTempo_.store(juce::jlimit(20.0, 300.0, bpm), std::memory_order_relaxed);
+}
+
+void Transport::updateTempo()
+{
+    double tempo = requestedTempo_.load(std::memory_order_relaxed);
+    if (tempo == appliedTempo_) return;
+
+    // Everything up to now was played at the old tempo
+    reanchor();
+    appliedTempo_ = tempo;
+    beatsPerSample_ = tempo / (60.0 * sampleRate_);
 }
 
 void Transport::start()
@@ -34,15 +50,40 @@ void Transport::stop()
 
 void Transport::reset()
 {
-    clock_.reset();
     currentBar_ = 0;
     currentBeat_ = 0;
     currentSixteenth_ = 0;
-    samplePosition_ = 0.0;
-    lastBeatPosition_ = 0.0;
-    beatStart_ = false;
-    barStart_ = false;
-    sixteenthStart_ = false;
+    currentStep_ = 0;
+    startPending_ = true;
+    anchor_ = Position();
+    samplesSinceAnchor_ = 0;
+}
+
+int64_t Transport::eighthIndex(const Position& position)
+{
+    return position.beat * 2 + (position.fraction >= 0.5 ? 1 : 0);
+}
+
+double Transport::positionInEighth(const Position& position)
+{
+    return position.fraction >= 0.5 ? position.fraction * 2.0 - 1.0 : position.fraction * 2.0;
+}
+
+Transport::Position Transport::positionAt(int64_t samplesAhead) const
+{
+    double beats = anchor_.fraction + static_cast<double>(samplesSinceAnchor_ + samplesAhead) * beatsPerSample_;
+    double whole = std::floor(beats);
+
+    Position position;
+    position.beat = anchor_.beat + static_cast<int64_t>(whole);
+    position.fraction = beats - whole;
+    return position;
+}
+
+void Transport::reanchor()
+{
+    anchor_ = positionAt(0);
+    samplesSinceAnchor_ = 0;
 }
 
 void Transport::setSwingLevel(int level)
@@ -70,86 +111,126 @@ void Transport::setSwingRatio(float ratio)
     swingLevel_ = bestLevel;
 }
 
-void Transport::advance()
+int Transport::advanceBlock(int numSamples, TransportEventList& events)
 {
-    if (!playing_) return;
+    events.size = 0;
+    if (!playing_) return numSamples;
 
-    double samplesPerBeat = clock_.getSamplesPerBeat();
-    double samplesPerEighth = samplesPerBeat / 2.0;
+    updateTempo();
 
-    double prevPosition = samplePosition_;
-    samplePosition_ += 1.0;
+    // Position 0 is never "crossed", so the downbeat that starts playback is emitted explicitly
+    if (startPending_)
+    {
+        startPending_ = false;
+        TransportEvent& event = events.events[events.size++];
+        event = makeEvent(0, true, positionAt(0));
+        event.offset = 0;
+    }
 
-    // Calculate swing-adjusted 16th note positions
-    // Swing delays the off-beat 16ths (positions 1 and 3 within each beat)
-    // Each 8th note pair has: on-beat at 0%, off-beat at swingAmount%
-    float swingRatio = swingAmounts_[swingLevel_];
+    int pos = 0;
+    while (events.size < TransportEventList::CAPACITY)
+    {
+        // The boundary is crossed on the (until - 1)-th sample from here
+        int until = getSamplesUntilNextSixteenth();
+        if (pos + until > numSamples)
+        {
+            samplesSinceAnchor_ += numSamples - pos;
+            return numSamples;
+        }
 
-    // Position within current 8th note pair (0.0 to 1.0 covers two 16ths)
-    double posInEighth = std::fmod(samplePosition_, samplesPerEighth);
-    double prevPosInEighth = std::fmod(prevPosition, samplesPerEighth);
+        samplesSinceAnchor_ += until;
+        pos += until;
 
-    // Threshold for the off-beat 16th within each 8th note
-    double swingThreshold = samplesPerEighth * swingRatio;
+        // Calculate which 16th we're on: on-beat 16ths are even, swung off-beat 16ths odd
+        Position prevPosition = positionAt(-1);
+        Position position = positionAt(0);
+        bool onBeatCrossed = eighthIndex(position) > eighthIndex(prevPosition);
+        int64_t step = eighthIndex(position) * 2 + (onBeatCrossed ? 0 : 1);
 
-    // Detect 16th note crossings with swing adjustment
-    int eighthIdx = static_cast<int>(samplePosition_ / samplesPerEighth);
-    int prevEighthIdx = static_cast<int>(prevPosition / samplesPerEighth);
+        TransportEvent& event = events.events[events.size++];
+        event = makeEvent(step, onBeatCrossed && (step % sixteenthsPerBeat_) == 0, position);
+        event.offset = pos - 1;
 
-    bool onBeatCrossed = (eighthIdx > prevEighthIdx);
-    bool offBeatCrossed = (posInEighth >= swingThreshold && prevPosInEighth < swingThreshold);
+        // Tempo changes land on 16th boundaries
+        updateTempo();
+    }
+
+    return pos;
+}
+
+TransportEvent Transport::makeEvent(int64_t step, bool beatStart, const Position& position)
+{
+    int64_t beat = step / sixteenthsPerBeat_;
+
+    currentStep_ = step;
+    currentSixteenth_ = static_cast<int>(step % sixteenthsPerBeat_);
 
-    sixteenthStart_ = onBeatCrossed || offBeatCrossed;
+    TransportEvent event;
+    event.beatStart = beatStart;
 
-    if (sixteenthStart_)
+    if (event.beatStart)
     {
-        // Calculate which 16th we're on (0-15 in a bar)
-        int globalSixteenth;
-        if (onBeatCrossed) {
-            // On-beat 16th (even: 0, 2, 4, 6, 8, 10, 12, 14)
-            globalSixteenth = eighthIdx * 2;
-        } else {
-            // Off-beat 16th (odd: 1, 3, 5, 7, 9, 11, 13, 15)
-            globalSixteenth = eighthIdx * 2 + 1;
+        currentBeat_ = static_cast<int>(beat % beatsPerBar_);
+        event.barStart = (currentBeat_ == 0);
+
+        if (event.barStart)
+        {
+            currentBar_ = static_cast<int>(beat / beatsPerBar_);
+
+            // Keep the anchor offset small over long sets
+            reanchor();
         }
+    }
 
-        currentSixteenth_ = globalSixteenth % sixteenthsPerBeat_;
+    event.step = step;
+    event.stepInBar = static_cast<int>(step % stepsPerBar_);
+    event.stepInPhrase = static_cast<int>(step % stepsPerPhrase);
+    event.bar = currentBar_;
+    event.beat = currentBeat_;
+    event.sixteenth = currentSixteenth_;
+    event.position = (static_cast<double>(position.beat) + position.fraction) * sixteenthsPerBeat_;
+    return event;
+}
 
-        int newBeat = globalSixteenth / sixteenthsPerBeat_;
-        int prevBeat = (globalSixteenth - 1) / sixteenthsPerBeat_;
+bool Transport::crossesSixteenth(const Position& prevPosition, const Position& position) const
+{
+    // Same on-beat / swung off-beat test as advance()
+    if (eighthIndex(position) > eighthIndex(prevPosition)) return true;
 
-        beatStart_ = (currentSixteenth_ == 0) && onBeatCrossed;
+    double swingRatio = swingAmounts_[swingLevel_];
+    return positionInEighth(position) >= swingRatio && positionInEighth(prevPosition) < swingRatio;
+}
 
-        if (beatStart_)
-        {
-            currentBeat_ = newBeat % beatsPerBar_;
+int Transport::getSamplesUntilNextSixteenth() const
+{
+    double samplesPerEighth = 0.5 / beatsPerSample_;
+    double swingRatio = swingAmounts_[swingLevel_];
 
-            int newBar = newBeat / beatsPerBar_;
-            int prevBar = (newBeat - 1) / beatsPerBar_;
+    // Analytic estimate of the next boundary (in 8th-note units)
+    double posInEighth = positionInEighth(positionAt(0));
+    double nextBoundary = (posInEighth < swingRatio) ? swingRatio : 1.0;
 
-            barStart_ = (currentBeat_ == 0);
+    int samples = std::max(1, static_cast<int>(std::ceil((nextBoundary - posInEighth) * samplesPerEighth)));
 
-            if (barStart_)
-            {
-                currentBar_ = newBar;
-            }
-        }
-        else
-        {
-            barStart_ = false;
-        }
+    // Correct rounding so the result always matches the per-sample test
+    while (samples > 1 && crossesSixteenth(positionAt(samples - 2), positionAt(samples - 1))) {
+        samples--;
     }
-    else
-    {
-        beatStart_ = false;
-        barStart_ = false;
+    while (!crossesSixteenth(positionAt(samples - 1), positionAt(samples))) {
+        samples++;
     }
 
-    clock_.advance();
+    return samples;
 }
 
 double Transport::getPositionInBar() const
 {
-    double samplesPerBar = clock_.getSamplesPerBeat() * beatsPerBar_;
-    return std::fmod(samplePosition_, samplesPerBar) / samplesPerBar;
+    Position position = positionAt(0);
+    return (static_cast<double>(position.beat % beatsPerBar_) + position.fraction) / beatsPerBar_;
+}
+
+double Transport::getPositionInSixteenths() const
+{
+    Position position = positionAt(0);
+    return (static_cast<double>(position.beat) + position.fraction) * sixteenthsPerBeat_;
 }
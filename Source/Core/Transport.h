@@ -1,7 +1,35 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include "Clock.h"
+#include <atomic>
+#include <cstdint>
+
+// A 16th-note boundary inside a block (off-beat 16ths already include the swing delay)
+struct TransportEvent
+{
+    int offset = 0;             // sample offset within the advanced block
+    int64_t step = 0;           // absolute 16th since reset (monotonic; patterns of any length wrap it)
+    int stepInBar = 0;          // 0-15
+    int stepInPhrase = 0;       // 0 .. Transport::stepsPerPhrase - 1
+    int bar = 0;
+    int beat = 0;               // 0-3
+    int sixteenth = 0;          // 0-3 within the beat
+    double position = 0.0;      // musical position in 16ths at this sample
+    bool beatStart = false;
+    bool barStart = false;
+};
+
+// Fixed-capacity event list filled by Transport::advanceBlock (no allocation)
+struct TransportEventList
+{
+    static constexpr int CAPACITY = 64;
+
+    TransportEvent events[CAPACITY];
+    int size = 0;
+
+    const TransportEvent* begin() const { return events; }
+    const TransportEvent* end() const { return events + size; }
+};
 
 class Transport
 {
@@ -10,25 +38,35 @@ public:
     ~Transport();
 
     void prepare(double sampleRate);
+    // Any thread: request a tempo; advanceBlock applies it at the block start and at each 16th
     void setTempo(double bpm);
-    double getTempo() const { return clock_.getTempo(); }
+    double getTempo() const { return requestedTempo_.load(std::memory_order_relaxed); }
 
     void start();
     void stop();
     void reset();
 
     bool isPlaying() const { return playing_; }
-    void advance();
+
+    // Phrase = 4 bars (64 steps, the longest pattern length)
+    static constexpr int stepsPerPhrase = 64;
+
+    // Audio thread: advance up to numSamples and list the 16th-note boundaries crossed,
+    // jumping from boundary to boundary (cost scales with the number of events).
+    // Returns the number of samples advanced: numSamples, or less if the list filled up.
+    // The first block after reset() starts with the downbeat of bar 0 at offset 0.
+    int advanceBlock(int numSamples, TransportEventList& events);
 
     int getCurrentBar() const { return currentBar_; }
     int getCurrentBeat() const { return currentBeat_; }
-    int getCurrentSixteenth() const { return currentSixteenth_; }
-
-    bool isBeatStart() const { return beatStart_; }
-    bool isBarStart() const { return barStart_; }
-    bool isSixteenthStart() const { return sixteenthStart_; }
+    int getCurrentSixteenth() const { return currentSixteenth_; }   // 0-3 within the beat
+    int64_t getCurrentStep() const { return currentStep_; }
+    int getStepInBar() const { return static_cast<int>(currentStep_ % stepsPerBar_); }
+    int getStepInPhrase() const { return static_cast<int>(currentStep_ % stepsPerPhrase); }
 
     double getPositionInBar() const;
+    // Musical position in (unswung) 16th notes since reset, with sub-step fraction
+    double getPositionInSixteenths() const;
 
     // Swing control (0=off, 1=light, 2=medium, 3=heavy)
     void setSwingLevel(int level);
@@ -40,19 +78,28 @@ public:
     float getSwingRatio() const { return swingAmounts_[swingLevel_]; }
 
 private:
-    Clock clock_;
     bool playing_ = false;
 
     int currentBar_ = 0;
     int currentBeat_ = 0;
     int currentSixteenth_ = 0;
-
-    double samplePosition_ = 0.0;
-    double lastBeatPosition_ = 0.0;
-
-    bool beatStart_ = false;
-    bool barStart_ = false;
-    bool sixteenthStart_ = false;
+    int64_t currentStep_ = 0;
+    bool startPending_ = true;      // bar 0 step 0 is emitted before the first crossing
+
+    // Musical position (PPQ-style): beats at the last anchor + samples since then * beats per sample.
+    // Re-anchored on every tempo change and every bar, so the position is continuous across
+    // tempo changes and rounding never accumulates over long sets.
+    struct Position {
+        int64_t beat = 0;        // whole beats since reset
+        double fraction = 0.0;   // 0 <= fraction < 1
+    };
+
+    Position anchor_;
+    int64_t samplesSinceAnchor_ = 0;
+    double beatsPerSample_ = 0.0;
+    double appliedTempo_ = 0.0;
+    double sampleRate_ = 48000.0;
+    std::atomic<double> requestedTempo_{128.0};
 
     // Swing: delays off-beat 16th notes
     // Level 0: 50% (straight), 1: 54%, 2: 62%, 3: 67% (triplet)
@@ -61,6 +108,17 @@ private:
 
     static constexpr int beatsPerBar_ = 4;
     static constexpr int sixteenthsPerBeat_ = 4;
+    static constexpr int stepsPerBar_ = beatsPerBar_ * sixteenthsPerBeat_;
+
+    Position positionAt(int64_t samplesAhead) const;
+    // Swing works within 8th-note pairs: index of the 8th and position inside it (0-1)
+    static int64_t eighthIndex(const Position& position);
+    static double positionInEighth(const Position& position);
+    void reanchor();
+    void updateTempo();
+    bool crossesSixteenth(const Position& prev, const Position& position) const;
+    int getSamplesUntilNextSixteenth() const;
+    TransportEvent makeEvent(int64_t step, bool beatStart, const Position& position);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Transport)
 };
@@ -1,5 +1,6 @@
 #include <JuceHeader.h>
 #include "MainComponent.h"
+#include "Core/StyleBankLoader.h"
 
 class TechnoMachineApplication : public juce::JUCEApplication
 {
@@ -12,6 +13,8 @@ public:
 
     void initialise(const juce::String&) override
     {
+        // 訓練風格必須在 AudioEngine（馬可夫表）建立前登錄
+        TechnoMachine::StyleBankLoader::loadDefault();
         mainWindow_.reset(new MainWindow(getApplicationName()));
     }
 
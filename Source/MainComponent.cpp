@@ -212,8 +212,8 @@ MainComponent::MainComponent()
 
     // Load A button with flash effect
     loadAButton_.onClick = [this] {
+        setCodeSwingLevel_ = -1;
         audioEngine_.loadToDeck(0);
-        syncSwingFromStyle();
         updateDJInfo();
         // Flash effect
         loadAButton_.setColour(juce::TextButton::buttonColourId, btnFlashColor_);
@@ -226,8 +226,8 @@ MainComponent::MainComponent()
 
     // Load B button with flash effect
     loadBButton_.onClick = [this] {
+        setCodeSwingLevel_ = -1;
         audioEngine_.loadToDeck(1);
-        syncSwingFromStyle();
         updateDJInfo();
         // Flash effect
         loadBButton_.setColour(juce::TextButton::buttonColourId, btnFlashColor_);
@@ -244,8 +244,8 @@ MainComponent::MainComponent()
     crossfaderSlider_.setSliderStyle(juce::Slider::LinearHorizontal);
     crossfaderSlider_.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
     crossfaderSlider_.onValueChange = [this] {
+        setCodeSwingLevel_ = -1;
         audioEngine_.setCrossfader(static_cast<float>(crossfaderSlider_.getValue()));
-        syncSwingFromStyle();
         updateDJInfo();
     };
     styleSlider(crossfaderSlider_);
@@ -416,6 +416,40 @@ MainComponent::MainComponent()
     statusLabel_.setColour(juce::Label::textColourId, textLight);
     addAndMakeVisible(statusLabel_);
 
+    // === Set code ===
+    // Copy shows the current code and puts it on the clipboard; Apply (or Return) recreates a set from a code
+    styleLabel(setCodeLabel_);
+    setCodeLabel_.setJustificationType(juce::Justification::centredRight);
+    addAndMakeVisible(setCodeLabel_);
+
+    setCodeEditor_.setFont(juce::Font(thinTypeface_).withHeight(13.0f));
+    setCodeEditor_.setColour(juce::TextEditor::backgroundColourId, bgMid);
+    setCodeEditor_.setColour(juce::TextEditor::textColourId, textLight);
+    setCodeEditor_.setColour(juce::TextEditor::outlineColourId, juce::Colours::transparentBlack);
+    setCodeEditor_.setColour(juce::TextEditor::focusedOutlineColourId, accentDim);
+    setCodeEditor_.onReturnKey = [this] {
+        applySetCodeFromEditor();
+    };
+    addAndMakeVisible(setCodeEditor_);
+
+    copySetCodeButton_.onClick = [this] {
+        showSetCode();
+        juce::SystemClipboard::copyTextToClipboard(setCodeEditor_.getText());
+        // Flash effect
+        copySetCodeButton_.setColour(juce::TextButton::buttonColourId, btnFlashColor_);
+        juce::Timer::callAfterDelay(150, [this] {
+            copySetCodeButton_.setColour(juce::TextButton::buttonColourId, btnBgColor_);
+        });
+    };
+    styleButton(copySetCodeButton_, textDim);
+    addAndMakeVisible(copySetCodeButton_);
+
+    applySetCodeButton_.onClick = [this] {
+        applySetCodeFromEditor();
+    };
+    styleButton(applySetCodeButton_, textDim);
+    addAndMakeVisible(applySetCodeButton_);
+
     transport_.setTempo(132.0);  // Default 132 BPM
 
     updateDJInfo();
@@ -426,6 +460,8 @@ MainComponent::MainComponent()
     const char* swingLabels[] = {"Swing: Off", "Swing: 1", "Swing: 2", "Swing: 3"};
     swingButton_.setButtonText(swingLabels[swingLevel_]);
 
+    showSetCode();
+
     startTimerHz(30);
     updateUI();
 }
@@ -472,6 +508,8 @@ void MainComponent::audioDeviceAboutToStart(juce::AudioIODevice* device)
 
     audioEngine_.prepare(sampleRate, blockSize);
     transport_.prepare(sampleRate);
+    // Sized here only; the audio callback renders larger blocks in chunks of this size
+    stereoScratch_.setSize(2, std::max(1, blockSize));
     cvRouter_.setSampleRate(sampleRate);
 
     // Update CV routing based on available channels
@@ -498,29 +536,36 @@ void MainComponent::audioDeviceIOCallbackWithContext(
     }
 
     // Process audio
-    if (transport_.isPlaying()) {
-        for (int sample = 0; sample < numSamples; ++sample) {
-            transport_.advance();
-
-            auto output = audioEngine_.process(transport_);
+    if (!transport_.isPlaying()) {
+        // Still apply UI commands and install new decks while stopped
+        audioEngine_.processStopped();
+    } else {
+        audioEngine_.clearTriggerFlags();
 
-            // Stereo output to channels 0-1
-            if (numOutputChannels >= 1) {
-                outputChannelData[0][sample] = output.left;
-            }
-            if (numOutputChannels >= 2) {
-                outputChannelData[1][sample] = output.right;
+        // Stereo output to channels 0-1 (render via scratch when fewer channels)
+        if (numOutputChannels >= 2) {
+            audioEngine_.processBlock(transport_, outputChannelData[0], outputChannelData[1], numSamples);
+        } else {
+            // The scratch buffer is never resized here (no allocation on the audio thread)
+            const int chunkSize = stereoScratch_.getNumSamples();
+            for (int start = 0; start < numSamples; start += chunkSize) {
+                const int count = std::min(chunkSize, numSamples - start);
+                audioEngine_.processBlock(transport_, stereoScratch_.getWritePointer(0),
+                                          stereoScratch_.getWritePointer(1), count);
+                if (numOutputChannels >= 1) {
+                    juce::FloatVectorOperations::copy(outputChannelData[0] + start, stereoScratch_.getReadPointer(0), count);
+                }
             }
+        }
 
-            // Check for triggers and notify CV router
-            // This is done per-sample to maintain timing accuracy
-            for (int voice = 0; voice < TechnoMachine::NUM_VOICES; ++voice) {
-                if (audioEngine_.wasVoiceTriggered(voice)) {
-                    float velocity = audioEngine_.getLastVelocity(voice);
-                    float freq = audioEngine_.drums().getVoiceFrequency(voice);
-                    cvRouter_.noteTrigger(voice, velocity);
-                    cvRouter_.setVoiceFrequency(voice, freq);
-                }
+        // Check for triggers and notify CV router
+        // CV outputs are rendered per block, so once per block is sufficient
+        for (int voice = 0; voice < TechnoMachine::NUM_VOICES; ++voice) {
+            if (audioEngine_.wasVoiceTriggered(voice)) {
+                float velocity = audioEngine_.getLastVelocity(voice);
+                float freq = audioEngine_.drums().getVoiceFrequency(voice);
+                cvRouter_.noteTrigger(voice, velocity);
+                cvRouter_.setVoiceFrequency(voice, freq);
             }
         }
     }
@@ -575,6 +620,12 @@ void MainComponent::resized()
     // Status (below Global/Fill)
     statusLabel_.setBounds(20, 155, 480, 24);
 
+    // Set code (below status)
+    setCodeLabel_.setBounds(20, 186, 35, 24);
+    setCodeEditor_.setBounds(60, 186, 320, 24);
+    copySetCodeButton_.setBounds(385, 186, 55, 24);
+    applySetCodeButton_.setBounds(445, 186, 55, 24);
+
     // === Bottom section: Density faders + DJ controls ===
     int faderWidth = 65;
     int faderSpacing = 8;
@@ -679,6 +730,26 @@ void MainComponent::resized()
 
 void MainComponent::timerCallback()
 {
+    // Crossfader / deck commands are applied on the audio thread; resync swing once they land
+    uint32_t deckVersion = audioEngine_.getDeckStateVersion();
+    if (deckVersion != lastDeckStateVersion_) {
+        lastDeckStateVersion_ = deckVersion;
+        if (setCodeSwingLevel_ >= 0) {
+            setSwing(setCodeSwingLevel_);
+        } else {
+            syncSwingFromStyle();
+        }
+    }
+
+    // Sample loads finish in the background; names / paths change only once installed
+    auto sampleStatus = audioEngine_.updateSampleStatus();
+    if (sampleStatus.installed || sampleStatus.failed) {
+        updateSampleDisplay();
+    }
+    if (sampleStatus.installed) {
+        saveSettings();
+    }
+
     updateUI();
     updateDJInfo();
     updateBuildup();
@@ -740,13 +811,72 @@ void MainComponent::updateDJInfo()
 
 void MainComponent::cycleSwing()
 {
-    swingLevel_ = (swingLevel_ + 1) % 4;
+    setCodeSwingLevel_ = -1;
+    setSwing((swingLevel_ + 1) % 4);
+}
+
+void MainComponent::setSwing(int level)
+{
+    swingLevel_ = std::clamp(level, 0, 3);
     transport_.setSwingLevel(swingLevel_);
 
     const char* labels[] = {"Swing: Off", "Swing: 1", "Swing: 2", "Swing: 3"};
     swingButton_.setButtonText(labels[swingLevel_]);
 }
 
+void MainComponent::showSetCode()
+{
+    auto code = audioEngine_.makeSetCode(transport_.getTempo(), swingLevel_);
+    setCodeEditor_.setText(code.toString(), false);
+}
+
+void MainComponent::applySetCodeFromEditor()
+{
+    TechnoMachine::SetCode code;
+    if (!TechnoMachine::SetCode::parse(setCodeEditor_.getText().trim().toStdString(), code)) {
+        // Invalid code: keep the text selected for retyping
+        setCodeEditor_.selectAll();
+        applySetCodeButton_.setColour(juce::TextButton::buttonColourId, juce::Colour(0xff802030));
+        juce::Timer::callAfterDelay(300, [this] {
+            applySetCodeButton_.setColour(juce::TextButton::buttonColourId, btnBgColor_);
+        });
+        return;
+    }
+
+    // A running build-up would keep automating fill / density over the code's values
+    stopBuildup();
+
+    // Seed, songs, densities, fill and pattern length
+    audioEngine_.applySetCode(code);
+
+    // Tempo and swing live in the Transport
+    transport_.setTempo(code.tempo);
+    tempoSlider_.setValue(code.tempo, juce::dontSendNotification);
+    setCodeSwingLevel_ = code.swingLevel;
+    setSwing(code.swingLevel);
+
+    // Controls follow the code (playback densities become the base densities, no global offset)
+    fillIntensitySlider_.setValue(code.fillIntensity, juce::dontSendNotification);
+    globalDensityOffset_ = 0.0f;
+    globalDensitySlider_.setValue(0.0, juce::dontSendNotification);
+    juce::Slider* densitySliders[] = {&timelineDensitySlider_, &foundationDensitySlider_,
+                                      &grooveDensitySlider_, &leadDensitySlider_};
+    for (int i = 0; i < 4; i++) {
+        baseDensities_[i] = code.playbackDensities[i];
+        densitySliders[i]->setValue(code.playbackDensities[i], juce::dontSendNotification);
+    }
+    crossfaderSlider_.setValue(0.0, juce::dontSendNotification);  // applySetCode returns to Deck A
+
+    setCodeEditor_.setText(code.toString(), false);
+    updateDJInfo();
+
+    // Flash effect
+    applySetCodeButton_.setColour(juce::TextButton::buttonColourId, btnFlashColor_);
+    juce::Timer::callAfterDelay(150, [this] {
+        applySetCodeButton_.setColour(juce::TextButton::buttonColourId, btnBgColor_);
+    });
+}
+
 void MainComponent::applyGlobalDensity()
 {
     using Role = TechnoMachine::Role;
@@ -816,7 +946,9 @@ void MainComponent::saveSettings()
         }
 
         // Save sample paths (4 voices: 1 per role)
+        // A load still in progress keeps the saved path until it is installed (or fails)
         for (int v = 0; v < 4; v++) {
+            if (audioEngine_.isSampleLoadPending(v)) continue;
             juce::String key = "samplePath" + juce::String(v);
             juce::String path = audioEngine_.getSamplePath(v);
             props->setValue(key, path);
@@ -847,8 +979,26 @@ void MainComponent::startBuildup()
     preBuildupGlobalDensity_ = static_cast<float>(globalDensitySlider_.getValue());
     preBuildupFillInterval_ = audioEngine_.getFillInterval();
 
-    // Record start bar
-    buildupStartBar_ = transport_.getCurrentBar();
+    // 從下一個小節開始，由音訊執行緒的自動化 lane 推進（以 16 分音符計）
+    const float length = static_cast<float>(buildupDurationBars_ * 16);
+
+    // Fill Intensity: current → 1.0
+    audioEngine_.scheduleAutomation(TechnoMachine::AUTOMATION_FILL_INTENSITY, 1.0f, 0.0f, length);
+
+    // Global Density: linear rise to maximum (+0.5)
+    for (int i = 0; i < 4; i++) {
+        float target = std::clamp(baseDensities_[i] + 0.5f, 0.0f, 1.0f);
+        audioEngine_.scheduleAutomation(TechnoMachine::AUTOMATION_PLAYBACK_DENSITY + i, target, 0.0f, length);
+    }
+
+    // Fill Interval: shorten as progress increases
+    // 0-30%: original interval
+    // 30-60%: 2 bars
+    // 60-100%: 1 bar
+    audioEngine_.scheduleAutomation(TechnoMachine::AUTOMATION_FILL_INTERVAL,
+                                    static_cast<float>(std::min(preBuildupFillInterval_, 2)), length * 0.3f, 0.0f);
+    audioEngine_.scheduleAutomation(TechnoMachine::AUTOMATION_FILL_INTERVAL, 1.0f, length * 0.6f, 0.0f);
+
     buildupActive_ = true;
 
     // Visual feedback - change button color
@@ -861,15 +1011,24 @@ void MainComponent::stopBuildup()
 
     buildupActive_ = false;
 
+    // 取消尚未完成的 lane，再依序送出還原值（同一個指令佇列，不會被舊 lane 覆寫）
+    audioEngine_.cancelAutomation();
+
     // Restore original values
     fillIntensitySlider_.setValue(preBuildupFillIntensity_, juce::dontSendNotification);
     audioEngine_.setFillIntensity(preBuildupFillIntensity_);
 
     globalDensitySlider_.setValue(preBuildupGlobalDensity_, juce::dontSendNotification);
     globalDensityOffset_ = preBuildupGlobalDensity_;
-    applyGlobalDensity();
+    for (int i = 0; i < 4; i++) {
+        float density = std::clamp(baseDensities_[i] + globalDensityOffset_, 0.0f, 1.0f);
+        audioEngine_.scheduleAutomation(TechnoMachine::AUTOMATION_PLAYBACK_DENSITY + i, density, 0.0f, 0.0f,
+                                        TechnoMachine::Quantize::Now);
+    }
 
-    audioEngine_.setFillInterval(preBuildupFillInterval_);
+    audioEngine_.scheduleAutomation(TechnoMachine::AUTOMATION_FILL_INTERVAL,
+                                    static_cast<float>(preBuildupFillInterval_), 0.0f, 0.0f,
+                                    TechnoMachine::Quantize::Now);
 
     // Reset button color and text
     buildButton_.setColour(juce::TextButton::buttonColourId, btnBgColor_);
@@ -878,42 +1037,17 @@ void MainComponent::stopBuildup()
 
 void MainComponent::updateBuildup()
 {
-    if (!buildupActive_ || !transport_.isPlaying()) return;
-
-    // Calculate progress (0.0 to 1.0) with sub-bar precision
-    int currentBar = transport_.getCurrentBar();
-    // getCurrentBeat() = 0-3, getCurrentSixteenth() = 0-3 within beat
-    int sixteenthInBar = transport_.getCurrentBeat() * 4 + transport_.getCurrentSixteenth();
-    float barFraction = sixteenthInBar / 16.0f;  // 0-1 within bar
-    float elapsedBars = static_cast<float>(currentBar - buildupStartBar_) + barFraction;
-    float progress = elapsedBars / static_cast<float>(buildupDurationBars_);
-    progress = std::clamp(progress, 0.0f, 1.0f);
-
-    // Interpolate Fill Intensity: current → 1.0
-    float targetFill = preBuildupFillIntensity_ + (1.0f - preBuildupFillIntensity_) * progress;
-    fillIntensitySlider_.setValue(targetFill, juce::dontSendNotification);
-    audioEngine_.setFillIntensity(targetFill);
-
-    // Interpolate Global Density: linear rise to maximum (0.5)
+    if (!buildupActive_) return;
+
+    // 參數由音訊執行緒的自動化推進，這裡只同步顯示
+    // 到達下一個小節之前進度為 -1 / 0
+    float progress = std::max(0.0f, audioEngine_.getAutomationProgress(TechnoMachine::AUTOMATION_FILL_INTENSITY));
+
+    fillIntensitySlider_.setValue(audioEngine_.getFillIntensity(), juce::dontSendNotification);
+
     float densityMod = preBuildupGlobalDensity_ + (0.5f - preBuildupGlobalDensity_) * progress;
-    densityMod = std::clamp(densityMod, -0.5f, 0.5f);
     globalDensitySlider_.setValue(densityMod, juce::dontSendNotification);
     globalDensityOffset_ = densityMod;
-    applyGlobalDensity();
-
-    // Adjust Fill Interval: shorten as progress increases
-    // 0-30%: original interval
-    // 30-60%: 2 bars
-    // 60-100%: 1 bar
-    int newInterval;
-    if (progress < 0.3f) {
-        newInterval = preBuildupFillInterval_;
-    } else if (progress < 0.6f) {
-        newInterval = std::min(preBuildupFillInterval_, 2);
-    } else {
-        newInterval = 1;
-    }
-    audioEngine_.setFillInterval(newInterval);
 
     // Update button text to show progress
     int percent = static_cast<int>(progress * 100.0f);
@@ -941,10 +1075,9 @@ void MainComponent::loadSampleForVoice(int voiceIdx)
     sampleFileChooser_->launchAsync(flags, [this, voiceIdx](const juce::FileChooser& chooser) {
         auto file = chooser.getResult();
         if (file.existsAsFile()) {
+            // Saved by timerCallback once the sample is installed
             if (audioEngine_.loadSample(voiceIdx, file)) {
                 updateSampleDisplay();
-                // Save sample paths
-                saveSettings();
             }
         }
     });
@@ -953,7 +1086,11 @@ void MainComponent::loadSampleForVoice(int voiceIdx)
 void MainComponent::updateSampleDisplay()
 {
     for (int v = 0; v < 4; v++) {
-        if (audioEngine_.hasSample(v)) {
+        if (audioEngine_.isSampleLoadPending(v)) {
+            sampleNameLabels_[v].setText("Loading..", juce::dontSendNotification);
+        } else if (audioEngine_.hasSampleLoadFailed(v)) {
+            sampleNameLabels_[v].setText("Load failed", juce::dontSendNotification);
+        } else if (audioEngine_.hasSample(v)) {
             // Truncate filename to fit
             juce::String name = audioEngine_.getSampleName(v);
             if (name.length() > 12) {
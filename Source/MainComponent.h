@@ -71,6 +71,9 @@ private:
     AudioEngine audioEngine_;
     Transport transport_;
 
+    // Stereo render target when the device has fewer than 2 output channels
+    juce::AudioBuffer<float> stereoScratch_;
+
     // Transport controls
     juce::TextButton playButton_{"Play"};
     juce::TextButton stopButton_{"Stop"};
@@ -117,6 +120,12 @@ private:
     // Status
     juce::Label statusLabel_;
 
+    // Set code (seed + parameters; see Core/SetCode.h)
+    juce::Label setCodeLabel_{"", "Set"};
+    juce::TextEditor setCodeEditor_;
+    juce::TextButton copySetCodeButton_{"Copy"};
+    juce::TextButton applySetCodeButton_{"Apply"};
+
     // Inline CV Routing (4 roles × 3 signals = 12 ComboBoxes)
     juce::ComboBox cvRouteBoxes_[12];
     juce::Label cvRoleLabels_[4];  // TIMELINE, FOUNDATION, GROOVE, LEAD
@@ -137,6 +146,9 @@ private:
     void updateUI();
     void updateDJInfo();
     void cycleSwing();
+    void setSwing(int level);
+    void showSetCode();
+    void applySetCodeFromEditor();
     void applyGlobalDensity();
     void initializeAudio();
     void loadSettings();
@@ -146,12 +158,13 @@ private:
     void updateSampleDisplay();
 
     int swingLevel_ = 1;  // default swing level 1
+    uint32_t lastDeckStateVersion_ = 0;  // swing follows deck/crossfader changes applied by the audio thread
+    int setCodeSwingLevel_ = -1;         // swing of an applied set code; held over the style swing until decks / swing change
     float globalDensityOffset_ = 0.0f;
     float baseDensities_[4] = {0.5f, 0.5f, 0.5f, 0.5f};
 
     // Build-up state
     bool buildupActive_ = false;
-    int buildupStartBar_ = 0;
     int buildupDurationBars_ = 8;
     float preBuildupFillIntensity_ = 0.5f;
     float preBuildupGlobalDensity_ = 0.0f;
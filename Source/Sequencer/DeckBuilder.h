@@ -0,0 +1,197 @@
+/**
+ * DeckBuilder.h
+ * Techno Machine - 背景 Deck 生成
+ *
+ * 流程：
+ * - Message thread 呼叫 requestBuild()（每個 Deck 只保留最新的請求）
+ * - Worker thread 以自己的 DeckGenerator 建出完整的新 Deck，放進 ready slot（atomic 指標）
+ * - 音訊執行緒在 bar 邊界 takeReady() → TechnoPatternEngine::installDeck() → retire() 舊 Deck
+ * - 被換下的 Deck 由 worker thread 釋放
+ * - 已在 message thread 準備好的 Deck（例如從 PatternBank 解碼）可用 submitReady() 直接發布，
+ *   取代同一個 Deck 尚未完成的建構
+ *
+ * 音訊執行緒端只有 atomic exchange / compare-exchange，不鎖、不配置、不釋放
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "TechnoPattern.h"
+
+namespace TechnoMachine {
+
+class DeckBuilder {
+public:
+    /**
+     * 建構一個 Deck 所需的全部參數（在送出時取樣，worker 不讀取引擎狀態）
+     */
+    struct Request {
+        int deck = 0;
+        int roleStyles[NUM_ROLES] = {0, 0, 0, 0};
+        float variation = 0.5f;
+        int length = 16;
+        float roleDensities[NUM_ROLES] = {DEFAULT_ROLE_DENSITIES[TIMELINE], DEFAULT_ROLE_DENSITIES[FOUNDATION],
+                                          DEFAULT_ROLE_DENSITIES[GROOVE], DEFAULT_ROLE_DENSITIES[LEAD]};
+        uint64_t seed = 0;  // 生成用 seed（由引擎 seed 導出，結果與 worker 執行時機無關）
+    };
+
+    DeckBuilder() {
+        worker_ = std::thread([this] { run(); });
+    }
+
+    ~DeckBuilder() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wakeUp_.notify_one();
+        worker_.join();
+
+        for (auto& slot : ready_) delete slot.exchange(nullptr);
+        reclaimRetired();
+    }
+
+    /**
+     * 送出建構請求（message thread）
+     * 同一個 Deck 尚未開始的舊請求與尚未安裝的舊結果會被取代
+     */
+    void requestBuild(const Request& request) {
+        int deck = (request.deck == 0) ? 0 : 1;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_[deck] = request;
+            pending_[deck].deck = deck;
+            hasPending_[deck] = true;
+            pendingGeneration_[deck] = ++generation_[deck];
+            delete ready_[deck].exchange(nullptr, std::memory_order_acq_rel);
+        }
+        wakeUp_.notify_one();
+    }
+
+    /**
+     * 直接發布已完成的 Deck（message thread）
+     * 同一個 Deck 尚未開始或進行中的建構結果會被丟棄
+     */
+    void submitReady(int deck, std::unique_ptr<Deck> built) {
+        deck = (deck == 0) ? 0 : 1;
+        std::lock_guard<std::mutex> lock(mutex_);
+        hasPending_[deck] = false;
+        ++generation_[deck];
+        delete ready_[deck].exchange(built.release(), std::memory_order_acq_rel);
+    }
+
+    /**
+     * 取出已建好的 Deck（音訊執行緒），沒有則回傳 nullptr
+     */
+    Deck* takeReady(int deck) {
+        return ready_[(deck == 0) ? 0 : 1].exchange(nullptr, std::memory_order_acquire);
+    }
+
+    bool hasReady(int deck) const {
+        return ready_[(deck == 0) ? 0 : 1].load(std::memory_order_relaxed) != nullptr;
+    }
+
+    /**
+     * 是否有空的回收位置（音訊執行緒；只有音訊執行緒會填入，結果可靠）
+     */
+    bool canRetire() const {
+        for (const auto& slot : retired_) {
+            if (slot.load(std::memory_order_relaxed) == nullptr) return true;
+        }
+        return false;
+    }
+
+    /**
+     * 交出被換下的 Deck（音訊執行緒），由 worker 釋放
+     * @return false = 沒有空位（先呼叫 canRetire() 確認）
+     */
+    bool retire(Deck* deck) {
+        if (deck == nullptr) return true;
+        for (auto& slot : retired_) {
+            Deck* expected = nullptr;
+            if (slot.compare_exchange_strong(expected, deck, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    static constexpr int MAX_RETIRED = 8;
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    bool stopping_ = false;
+    Request pending_[2];
+    bool hasPending_[2] = {false, false};
+
+    // 每次 requestBuild / submitReady 遞增；worker 的結果只有在期間沒有更新的請求時才發布
+    uint32_t generation_[2] = {0, 0};
+    uint32_t pendingGeneration_[2] = {0, 0};
+
+    std::atomic<Deck*> ready_[2] = {};
+    std::atomic<Deck*> retired_[MAX_RETIRED] = {};
+
+    // Worker 專用
+    DeckGenerator generator_;
+
+    void run() {
+        for (;;) {
+            Request requests[2];
+            uint32_t generations[2] = {0, 0};
+            bool has[2] = {false, false};
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                // 音訊執行緒不能 notify，定期醒來回收舊 Deck
+                wakeUp_.wait_for(lock, std::chrono::milliseconds(50), [this] {
+                    return stopping_ || hasPending_[0] || hasPending_[1];
+                });
+                if (stopping_) return;
+
+                for (int d = 0; d < 2; d++) {
+                    has[d] = hasPending_[d];
+                    if (has[d]) {
+                        requests[d] = pending_[d];
+                        generations[d] = pendingGeneration_[d];
+                    }
+                    hasPending_[d] = false;
+                }
+            }
+
+            reclaimRetired();
+
+            for (int d = 0; d < 2; d++) {
+                if (has[d]) build(requests[d], generations[d]);
+            }
+        }
+    }
+
+    void build(const Request& request, uint32_t generation) {
+        auto deck = std::make_unique<Deck>();
+        for (int i = 0; i < NUM_ROLES; i++) {
+            deck->styleIndices[i] = request.roleStyles[i];
+        }
+        generator_.seed(request.seed);
+        generator_.generate(*deck, request.length, request.variation, request.roleDensities);
+
+        // 發布；尚未被安裝的舊結果直接丟棄，期間有更新的請求時丟棄這次的結果
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation_[request.deck] != generation) return;
+        delete ready_[request.deck].exchange(deck.release(), std::memory_order_acq_rel);
+    }
+
+    void reclaimRetired() {
+        for (auto& slot : retired_) {
+            delete slot.exchange(nullptr, std::memory_order_acquire);
+        }
+    }
+};
+
+} // namespace TechnoMachine
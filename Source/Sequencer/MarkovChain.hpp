@@ -2,15 +2,23 @@
  * MarkovChain.hpp
  * Techno Machine - 馬可夫鏈節奏生成
  *
- * 使用轉移矩陣動態決定每步是否觸發
- * 溫度參數由 Density 控制
+ * 查表式 order-N 馬可夫引擎（8 個 voice，SoA 儲存）：
+ * - Context = 最近 N 步（1-4）的打擊歷史 + 小節內位置（16 步）
+ * - 每個風格、每個 voice 一張轉移表，由 StyleProfile 的位置權重與各 voice 的基礎轉移機率推導
+ * - 訓練風格（StyleRegistry）改用風格庫中的實際轉移次數，樣本不足的 context 退回推導值
+ * - 表格在第一次使用時建立（全部風格 × 全部 order），之後每步只是一次查表 + 少量算術
+ * - Density / 溫度 / Fill 在執行時套用（它們是連續參數，不放進表格）
  */
 
 #pragma once
 
-#include <random>
-#include <cmath>
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include "StyleProfiles.hpp"
+#include "OnsetMask.h"
+#include "../Core/RandomStream.h"
 
 namespace TechnoMachine {
 
@@ -23,203 +31,262 @@ enum class MarkovState {
 };
 
 /**
- * 單一 Voice 的馬可夫鏈
+ * 預先計算的轉移表
+ * entry = P(HIT | style, voice, order, 位置, 歷史) × 255
  */
-class MarkovChain {
+class MarkovTables {
 public:
-    MarkovChain() : state_(MarkovState::REST), rng_(std::random_device{}()) {
-        // 預設轉移機率（平衡）
-        setTransitionMatrix(0.3f, 0.5f);
-    }
+    static constexpr int NUM_CHAIN_VOICES = 8;
+    static constexpr int MAX_ORDER = 4;
+    static constexpr int POSITIONS = 16;
+    static constexpr int HISTORIES = 1 << MAX_ORDER;
 
-    /**
-     * 設定轉移矩陣
-     * @param restToHit 從休止到打擊的基礎機率
-     * @param hitToHit 從打擊到打擊的基礎機率（連續打擊）
-     */
-    void setTransitionMatrix(float restToHit, float hitToHit) {
-        baseRestToHit_ = std::clamp(restToHit, 0.0f, 1.0f);
-        baseHitToHit_ = std::clamp(hitToHit, 0.0f, 1.0f);
-    }
+    using Table = uint8_t[POSITIONS][HISTORIES];
 
-    /**
-     * 根據風格權重設定轉移機率
-     * @param weight 當前步驟的風格權重 (0-1)
-     * @param density 密度參數 (0-1)，影響整體觸發傾向
-     */
-    void setStepWeight(float weight, float density) {
-        currentWeight_ = std::clamp(weight, 0.0f, 1.0f);
-        density_ = std::clamp(density, 0.0f, 1.0f);
-    }
+    static_assert(MAX_ORDER == StyleBankFormat::HISTORY_BITS, "風格庫的歷史長度需與 MAX_ORDER 相同");
 
     /**
-     * 設定溫度（由 Density 衍生）
-     * 低溫 = 穩定、規律
-     * 高溫 = 更多隨機性
+     * 共用實例（第一次呼叫時建立，每個風格 8 KB；MarkovEngine 建構時會先呼叫，避免在音訊執行緒建立）
+     * 建立後 StyleRegistry 即鎖定，之後不能再登錄風格
      */
-    void setTemperature(float temp) {
-        temperature_ = std::clamp(temp, 0.1f, 2.0f);
+    static const MarkovTables& get() {
+        static const MarkovTables tables;
+        return tables;
     }
 
-    /**
-     * 執行一步轉移，返回是否應該觸發
-     * @param fillActive Fill 是否啟用（提高溫度和觸發傾向）
-     * @param fillIntensity Fill 強度 (0-1)
-     * @return true = 觸發, false = 休止
-     */
-    bool step(bool fillActive = false, float fillIntensity = 0.0f) {
-        // 計算有效轉移機率
-        float restToHit = calculateTransitionProb(baseRestToHit_, true, fillActive, fillIntensity);
-        float hitToHit = calculateTransitionProb(baseHitToHit_, false, fillActive, fillIntensity);
-
-        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-        float roll = dist(rng_);
-
-        // 根據當前狀態決定轉移
-        if (state_ == MarkovState::REST) {
-            if (roll < restToHit) {
-                state_ = MarkovState::HIT;
-            }
-        } else {
-            if (roll < hitToHit) {
-                state_ = MarkovState::HIT;  // 維持打擊
-            } else {
-                state_ = MarkovState::REST;
-            }
-        }
-
-        return state_ == MarkovState::HIT;
+    const Table& table(int styleIdx, int voice, int order) const {
+        return tables_[((order - 1) * numStyles_ + styleIdx) * NUM_CHAIN_VOICES + voice];
     }
 
-    /**
-     * 取得當前狀態
-     */
-    MarkovState getState() const { return state_; }
+    int numStyles() const { return numStyles_; }
 
     /**
-     * 重設狀態
+     * 各 voice 的基礎轉移機率 {REST→HIT, HIT→HIT}
      */
-    void reset() { state_ = MarkovState::REST; }
-
-    /**
-     * 強制設定狀態（用於同步）
-     */
-    void setState(MarkovState s) { state_ = s; }
+    static float baseRestToHit(int voice) { return BASE[voice][0]; }
+    static float baseHitToHit(int voice) { return BASE[voice][1]; }
 
 private:
-    MarkovState state_;
-    std::mt19937 rng_;
-
-    // 基礎轉移機率
-    float baseRestToHit_ = 0.3f;
-    float baseHitToHit_ = 0.5f;
+    static constexpr float BASE[NUM_CHAIN_VOICES][2] = {
+        {0.6f, 0.7f}, {0.4f, 0.5f},     // Timeline (Hi-Hat): 高觸發率、高連續性
+        {0.25f, 0.1f}, {0.15f, 0.1f},   // Foundation (Kick): 低觸發率、低連續性（四拍穩定）
+        {0.3f, 0.2f}, {0.2f, 0.15f},    // Groove (Clap): 中等觸發、低連續性
+        {0.35f, 0.4f}, {0.25f, 0.3f}    // Lead (Perc): 中等觸發、中等連續
+    };
+
+    // 訓練次數的先驗強度：context 的樣本數遠小於此值時以推導值為主
+    static constexpr float PRIOR_STRENGTH = 8.0f;
+
+    int numStyles_ = 0;
+    std::unique_ptr<Table[]> tables_;
+
+    MarkovTables() {
+        StyleRegistry& registry = StyleRegistry::instance();
+        registry.freeze();
+        numStyles_ = registry.count();
+        tables_.reset(new Table[static_cast<size_t>(MAX_ORDER * numStyles_ * NUM_CHAIN_VOICES)]);
+
+        for (int order = 1; order <= MAX_ORDER; order++) {
+            for (int s = 0; s < numStyles_; s++) {
+                const StyleProfile& style = *registry.get(s);
+                const StyleBankEntry* trained = registry.getTrainedEntry(s);
+                for (int v = 0; v < NUM_CHAIN_VOICES; v++) {
+                    Table& t = tables_[((order - 1) * numStyles_ + s) * NUM_CHAIN_VOICES + v];
+                    build(t, roleWeights(style, v / 2), v, order);
+                    if (trained != nullptr) {
+                        applyCounts(t, *trained, v, order);
+                    }
+                }
+            }
+        }
+    }
 
-    // 動態參數
-    float currentWeight_ = 0.5f;
-    float density_ = 0.5f;
-    float temperature_ = 1.0f;
+    static const float* roleWeights(const StyleProfile& style, int role) {
+        switch (role) {
+            case FOUNDATION: return style.foundation;
+            case GROOVE: return style.groove;
+            case LEAD: return style.lead;
+            default: return style.timeline;
+        }
+    }
 
     /**
-     * 計算實際轉移機率
+     * 推導單一 voice 的轉移表
+     * - 一階：前一步狀態選擇基礎機率，乘上此位置的風格權重（order = 1 與舊版 2 狀態鏈相同）
+     * - 更早的歷史與風格的吻合度決定權重的銳利度：
+     *   吻合 → 指數 > 1，更貼近風格；偏離 → 指數 < 1，較平均
+     * - 連續打擊超過 2 次時逐步降低機率，避免長串滾奏
      */
-    float calculateTransitionProb(float baseProb, bool isRestToHit,
-                                   bool fillActive, float fillIntensity) {
-        float prob = baseProb;
-
-        // 1. 套用風格權重
-        prob *= currentWeight_;
-
-        // 2. 套用 Density（影響整體觸發傾向）
-        if (isRestToHit) {
-            // REST → HIT: Density 越高越容易觸發
-            prob *= (0.5f + density_);
-        } else {
-            // HIT → HIT: Density 影響連續打擊的可能性
-            prob *= (0.7f + density_ * 0.6f);
+    static void build(Table& table, const float* weights, int voice, int order) {
+        const int mask = (1 << order) - 1;
+
+        for (int pos = 0; pos < POSITIONS; pos++) {
+            const float w = std::clamp(weights[pos], 0.0f, 1.0f);
+
+            for (int h = 0; h < HISTORIES; h++) {
+                const int history = h & mask;
+                float prob = (history & 1) ? BASE[voice][1] : BASE[voice][0];
+
+                // bit k = k + 1 步之前（bit 0 = 前一步）
+                float conformity = 0.5f;
+                if (order > 1) {
+                    float sum = 0.0f;
+                    for (int k = 1; k < order; k++) {
+                        float expected = std::clamp(weights[(pos - 1 - k + 2 * POSITIONS) % POSITIONS], 0.0f, 1.0f);
+                        sum += ((history >> k) & 1) ? expected : 1.0f - expected;
+                    }
+                    conformity = sum / static_cast<float>(order - 1);
+                }
+                prob *= std::pow(w, 0.5f + conformity);
+
+                int hits = OnsetMask::popcount(static_cast<uint64_t>(history));
+                if (hits > 2) {
+                    prob /= 1.0f + 0.25f * static_cast<float>(hits - 2);
+                }
+
+                table[pos][h] = static_cast<uint8_t>(std::lround(std::clamp(prob, 0.0f, 1.0f) * 255.0f));
+            }
         }
+    }
 
-        // 3. 套用溫度（來自 Density）
-        // 高溫 = 機率趨向 0.5（更隨機）
-        // 低溫 = 機率保持原樣（更穩定）
-        float tempFactor = 1.0f / temperature_;
-        prob = 0.5f + (prob - 0.5f) * tempFactor;
-
-        // 4. Fill 模式：提高觸發傾向
-        if (fillActive) {
-            float fillBoost = fillIntensity * 0.4f;
-            prob += fillBoost;
+    /**
+     * 以訓練次數修正推導出的表格
+     * - 較短的 order 合併所有低位歷史相同的 context
+     * - 次要 voice 沒有獨立的訓練資料，以基礎觸發率的比例縮小主要 voice 的機率
+     */
+    static void applyCounts(Table& table, const StyleBankEntry& entry, int voice, int order) {
+        const int role = voice / 2;
+        const int mask = (1 << order) - 1;
+        const float scale = (voice & 1) ? BASE[voice][0] / BASE[voice - 1][0] : 1.0f;
+
+        for (int pos = 0; pos < POSITIONS; pos++) {
+            for (int h = 0; h < HISTORIES; h++) {
+                const int history = h & mask;
+                float rests = 0.0f, hits = 0.0f;
+                for (int full = history; full < HISTORIES; full += mask + 1) {
+                    rests += static_cast<float>(entry.transitions[role][pos][full][0]);
+                    hits += static_cast<float>(entry.transitions[role][pos][full][1]);
+                }
+
+                const float prior = table[pos][h] * (1.0f / 255.0f);
+                const float prob = (hits * scale + PRIOR_STRENGTH * prior) / (rests + hits + PRIOR_STRENGTH);
+                table[pos][h] = static_cast<uint8_t>(std::lround(std::clamp(prob, 0.0f, 1.0f) * 255.0f));
+            }
         }
-
-        return std::clamp(prob, 0.0f, 1.0f);
     }
 };
 
 /**
- * 8 Voice 馬可夫鏈管理器
+ * 8 Voice 馬可夫引擎
  */
 class MarkovEngine {
 public:
-    MarkovEngine() {
-        // 為每個 Voice 設定不同的基礎轉移機率
-        // Timeline (Hi-Hat): 高觸發率、高連續性
-        chains_[0].setTransitionMatrix(0.6f, 0.7f);
-        chains_[1].setTransitionMatrix(0.4f, 0.5f);
-
-        // Foundation (Kick): 低觸發率、低連續性（四拍穩定）
-        chains_[2].setTransitionMatrix(0.25f, 0.1f);
-        chains_[3].setTransitionMatrix(0.15f, 0.1f);
-
-        // Groove (Clap): 中等觸發、低連續性
-        chains_[4].setTransitionMatrix(0.3f, 0.2f);
-        chains_[5].setTransitionMatrix(0.2f, 0.15f);
-
-        // Lead (Perc): 中等觸發、中等連續
-        chains_[6].setTransitionMatrix(0.35f, 0.4f);
-        chains_[7].setTransitionMatrix(0.25f, 0.3f);
+    static constexpr int NUM_CHAIN_VOICES = MarkovTables::NUM_CHAIN_VOICES;
+    static constexpr int DEFAULT_ORDER = 3;
+
+    MarkovEngine() : tables_(MarkovTables::get()) {}
+
+    /**
+     * 由引擎 seed 設定 8 條鏈的隨機串流（逐一呼叫 stepVoice 時使用）
+     */
+    void seed(uint64_t engineSeed) {
+        for (int v = 0; v < NUM_CHAIN_VOICES; v++) {
+            rng_[v].reset(engineSeed, RandomStreamId::Markov, static_cast<uint64_t>(v));
+        }
     }
 
     /**
-     * 更新所有鏈的步驟權重
-     * @param step 當前步驟 (0-15)
-     * @param weights 8 個 voice 的權重陣列
-     * @param densities 4 個 role 的 density
+     * Context 長度（1-4 步），即時生效
      */
-    void updateStepWeights(int step, const float* weights, const float* densities) {
-        for (int v = 0; v < 8; v++) {
-            int role = v / 2;
-            chains_[v].setStepWeight(weights[v], densities[role]);
-            // 溫度 = 0.5 + density（density 越高越隨機）
-            chains_[v].setTemperature(0.5f + densities[role]);
+    void setOrder(int order) {
+        order_ = std::clamp(order, 1, MarkovTables::MAX_ORDER);
+        historyMask_ = static_cast<uint8_t>((1 << order_) - 1);
+        for (int v = 0; v < NUM_CHAIN_VOICES; v++) {
+            history_[v] &= historyMask_;
         }
     }
 
+    int getOrder() const { return order_; }
+
     /**
-     * 執行一步，返回 8 個 voice 的觸發結果
+     * 一次推進 8 條鏈
+     * @param step 當前步數（取小節內位置）
+     * @param roleStyles 4 個角色的風格 index
+     * @param roleDensities 4 個角色的 density
+     * @param rolls 8 個 [0, 1) 亂數
+     * @param hits 輸出 8 個觸發結果
      */
-    void step(bool* triggers, bool fillActive = false, float fillIntensity = 0.0f) {
-        for (int v = 0; v < 8; v++) {
-            triggers[v] = chains_[v].step(fillActive, fillIntensity);
+    void step(int step, const int* roleStyles, const float* roleDensities,
+              bool fillActive, float fillIntensity, const float* rolls, bool* hits) {
+        const int pos = position(step);
+        const float fillBoost = fillActive ? fillIntensity * 0.4f : 0.0f;
+
+        for (int v = 0; v < NUM_CHAIN_VOICES; v++) {
+            const int role = v / 2;
+            hits[v] = advance(v, pos, roleStyles[role], roleDensities[role], fillBoost, rolls[v]);
         }
     }
 
     /**
-     * 取得單一 voice 的馬可夫鏈
+     * 推進單一條鏈（使用該鏈自己的亂數串流）
      */
-    MarkovChain& getChain(int voice) {
-        return chains_[voice % 8];
+    bool stepVoice(int voice, int step, int styleIdx, float density,
+                   bool fillActive = false, float fillIntensity = 0.0f) {
+        voice = std::clamp(voice, 0, NUM_CHAIN_VOICES - 1);
+        const float fillBoost = fillActive ? fillIntensity * 0.4f : 0.0f;
+        return advance(voice, position(step), styleIdx, density, fillBoost, rng_[voice].nextFloat());
+    }
+
+    MarkovState getState(int voice) const {
+        return (history_[voice % NUM_CHAIN_VOICES] & 1) ? MarkovState::HIT : MarkovState::REST;
     }
 
     /**
-     * 重設所有鏈
+     * 重設所有鏈（清除歷史）
      */
     void reset() {
-        for (int v = 0; v < 8; v++) {
-            chains_[v].reset();
+        for (int v = 0; v < NUM_CHAIN_VOICES; v++) {
+            history_[v] = 0;
         }
     }
 
 private:
-    MarkovChain chains_[8];
+    const MarkovTables& tables_;
+    int order_ = DEFAULT_ORDER;
+    uint8_t historyMask_ = (1 << DEFAULT_ORDER) - 1;
+
+    // SoA：每條鏈的歷史（bit 0 = 前一步是否打擊）與亂數串流
+    uint8_t history_[NUM_CHAIN_VOICES] = {};
+    RandomStream rng_[NUM_CHAIN_VOICES];
+
+    static int position(int step) {
+        return ((step % MarkovTables::POSITIONS) + MarkovTables::POSITIONS) % MarkovTables::POSITIONS;
+    }
+
+    /**
+     * 查表 + 套用 Density / 溫度 / Fill
+     */
+    bool advance(int v, int pos, int styleIdx, float density, float fillBoost, float roll) {
+        styleIdx = (styleIdx >= 0 && styleIdx < tables_.numStyles()) ? styleIdx : 0;
+        density = std::clamp(density, 0.0f, 1.0f);
+
+        const uint8_t history = history_[v];
+        float prob = tables_.table(styleIdx, v, order_)[pos][history] * (1.0f / 255.0f);
+
+        // Density 影響整體觸發傾向：REST → HIT 越容易觸發，HIT → HIT 影響連續打擊
+        prob *= (history & 1) ? (0.7f + density * 0.6f) : (0.5f + density);
+
+        // 溫度 = 0.5 + density：高溫機率趨向 0.5（更隨機），低溫保持原樣（更穩定）
+        const float temperature = std::clamp(0.5f + density, 0.1f, 2.0f);
+        prob = 0.5f + (prob - 0.5f) / temperature;
+
+        // Fill 模式：提高觸發傾向
+        prob = std::clamp(prob + fillBoost, 0.0f, 1.0f);
+
+        const bool hit = roll < prob;
+        history_[v] = static_cast<uint8_t>(((history << 1) | (hit ? 1 : 0)) & historyMask_);
+        return hit;
+    }
 };
 
 } // namespace TechnoMachine
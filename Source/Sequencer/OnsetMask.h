@@ -0,0 +1,87 @@
+/**
+ * OnsetMask.h
+ * Techno Machine - Pattern onset 位元遮罩工具
+ *
+ * 每個 Pattern 以一個 64-bit word 記錄哪些步有 onset（bit i = step i）
+ * - popcount / count-trailing-zeros 使用編譯器內建指令
+ * - 旋轉以 pattern 長度為週期（length < 64 時不能直接用 64-bit rotate）
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace TechnoMachine {
+namespace OnsetMask {
+
+/**
+ * 前 length 步全部為 1 的遮罩
+ */
+inline uint64_t steps(int length) {
+    return (length >= 64) ? ~uint64_t(0) : ((uint64_t(1) << length) - 1);
+}
+
+inline int popcount(uint64_t mask) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    return static_cast<int>(__popcnt64(mask));
+#elif defined(_MSC_VER)
+    mask = mask - ((mask >> 1) & 0x5555555555555555ull);
+    mask = (mask & 0x3333333333333333ull) + ((mask >> 2) & 0x3333333333333333ull);
+    mask = (mask + (mask >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<int>((mask * 0x0101010101010101ull) >> 56);
+#else
+    return __builtin_popcountll(mask);
+#endif
+}
+
+/**
+ * 最低位 1 的位置（mask 必須非 0）
+ */
+inline int lowestBit(uint64_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+/**
+ * 以 length 為週期左旋 n 步：step i → step (i + n) % length
+ */
+inline uint64_t rotate(uint64_t mask, int n, int length) {
+    if (length <= 0) return 0;
+    n %= length;
+    if (n < 0) n += length;
+    if (n == 0) return mask;
+    const uint64_t all = steps(length);
+    return ((mask << n) | (mask >> (length - n))) & all;
+}
+
+/**
+ * 相鄰步遮罩：step i 的前一步或後一步有 onset（循環）
+ */
+inline uint64_t neighbours(uint64_t mask, int length) {
+    return rotate(mask, 1, length) | rotate(mask, -1, length);
+}
+
+/**
+ * from 之後（不含）下一個 onset 的位置，循環搜尋；沒有 onset 時回傳 -1
+ */
+inline int next(uint64_t mask, int from, int length) {
+    if (mask == 0 || length <= 0) return -1;
+    int start = (from + 1) % length;
+    if (start < 0) start += length;
+
+    uint64_t ahead = mask & ~steps(start);
+    if (ahead != 0) return lowestBit(ahead);
+    return lowestBit(mask);
+}
+
+} // namespace OnsetMask
+} // namespace TechnoMachine
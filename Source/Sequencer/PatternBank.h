@@ -0,0 +1,318 @@
+/**
+ * PatternBank.h
+ * Techno Machine - 預先生成的 Deck 資料庫
+ *
+ * 由 Tools/PatternBankBuilder 離線生成，引擎以 memory map 讀取：
+ *
+ *   [PatternBankHeader][float × NUM_ROLES × numDensityProfiles][PatternBankGroup × numGroups][record × numRecords]
+ *
+ * - Group = (4 個角色的風格, variation 分桶, density profile)，index 由分桶直接算出
+ * - Density profile = 生成時使用的 4 個角色 density（預設只有 DEFAULT_ROLE_DENSITIES 一組）
+ * - 每個 group 有 count 個 variant（連續存放），載入時以 seed 選一個：查表 + 解碼，不執行生成
+ * - Record 固定大小：8 個 pattern + 每個 fill 等級 8 個 fill pattern 的 velocity（uint8，0 = 無觸發）
+ *   + 4 聲道的 synth modifiers（uint8 量化）
+ * - 所有欄位為 little-endian；不依賴 JUCE，builder 與引擎共用
+ *
+ * 只有條件與 bank 相符時才命中（否則照常生成）：
+ * pattern 長度與 fill 等級數相同、每個角色的 density 與某個 profile 的同一角色落在同一個分桶
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "TechnoPattern.h"
+
+namespace TechnoMachine {
+
+namespace PatternBankFormat {
+    static constexpr char MAGIC[4] = {'T', 'M', 'P', 'B'};
+    static constexpr uint32_t VERSION = 3;          // 2：每個 Deck 存全部 fill 等級；3：per-role density profile
+    static constexpr float MAX_DENSITY = 0.9f;      // TechnoPatternEngine::setDensity 的上限
+    static constexpr int MAX_DENSITY_PROFILES = 16;
+}
+
+struct PatternBankHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t numStyles;         // 建立時的風格數（前 numStyles 個風格的名稱需相同）
+    uint32_t styleChecksum;
+    uint32_t length;            // 每個 pattern 的步數
+    uint32_t variationBuckets;
+    uint32_t densityBuckets;    // profile 比對的分桶數
+    uint32_t recordSize;
+    uint32_t fillLevels;        // Deck::FILL_LEVELS
+    uint32_t numDensityProfiles;
+    uint64_t numGroups;
+    uint64_t numRecords;
+    uint64_t recordsOffset;
+};
+
+struct PatternBankGroup {
+    uint32_t firstRecord;
+    uint32_t count;
+};
+
+static_assert(sizeof(PatternBankHeader) == 64, "PatternBankHeader layout");
+static_assert(sizeof(PatternBankGroup) == 8, "PatternBankGroup layout");
+
+/**
+ * 分桶與 record 編碼（builder 與 reader 共用）
+ */
+struct PatternBankLayout {
+    int numStyles = NUM_STYLES;
+    int length = 16;
+    int variationBuckets = 4;
+    int densityBuckets = 4;
+    int numDensityProfiles = 1;
+    float densityProfiles[PatternBankFormat::MAX_DENSITY_PROFILES][NUM_ROLES] = {
+        {DEFAULT_ROLE_DENSITIES[TIMELINE], DEFAULT_ROLE_DENSITIES[FOUNDATION],
+         DEFAULT_ROLE_DENSITIES[GROOVE], DEFAULT_ROLE_DENSITIES[LEAD]}};
+
+    static constexpr int PATTERN_ROWS = NUM_PATTERN_VOICES * (1 + Deck::FILL_LEVELS);
+
+    size_t recordSize() const {
+        return static_cast<size_t>(PATTERN_ROWS * length + 2 * NUM_VOICES);
+    }
+
+    uint64_t numStyleTuples() const {
+        uint64_t s = static_cast<uint64_t>(numStyles);
+        return s * s * s * s;
+    }
+
+    uint64_t numGroups() const {
+        return numStyleTuples() * static_cast<uint64_t>(variationBuckets) * static_cast<uint64_t>(numDensityProfiles);
+    }
+
+    size_t densityProfilesSize() const {
+        return static_cast<size_t>(numDensityProfiles) * NUM_ROLES * sizeof(float);
+    }
+
+    int variationBucket(float variation) const {
+        return std::clamp(static_cast<int>(variation * static_cast<float>(variationBuckets)), 0, variationBuckets - 1);
+    }
+
+    float variationCenter(int bucket) const {
+        return (static_cast<float>(bucket) + 0.5f) / static_cast<float>(variationBuckets);
+    }
+
+    int densityBucket(float density) const {
+        float normalized = density / PatternBankFormat::MAX_DENSITY;
+        return std::clamp(static_cast<int>(normalized * static_cast<float>(densityBuckets)), 0, densityBuckets - 1);
+    }
+
+    /**
+     * 每個角色的 density 都與 profile 的同一角色落在同一個分桶的第一個 profile，沒有則回傳 -1
+     */
+    int densityProfile(const float* roleDensities) const {
+        for (int p = 0; p < numDensityProfiles; p++) {
+            bool match = true;
+            for (int r = 0; r < NUM_ROLES && match; r++) {
+                match = densityBucket(roleDensities[r]) == densityBucket(densityProfiles[p][r]);
+            }
+            if (match) return p;
+        }
+        return -1;
+    }
+
+    uint64_t groupIndex(uint64_t styleTuple, int variationBucket, int densityProfile) const {
+        return (styleTuple * static_cast<uint64_t>(variationBuckets) + static_cast<uint64_t>(variationBucket))
+                   * static_cast<uint64_t>(numDensityProfiles) + static_cast<uint64_t>(densityProfile);
+    }
+
+    uint64_t styleTuple(const int* roleStyles) const {
+        uint64_t tuple = 0;
+        for (int r = 0; r < NUM_ROLES; r++) {
+            tuple = tuple * static_cast<uint64_t>(numStyles) + static_cast<uint64_t>(roleStyles[r]);
+        }
+        return tuple;
+    }
+
+    void decodeStyleTuple(uint64_t tuple, int* roleStyles) const {
+        for (int r = NUM_ROLES - 1; r >= 0; r--) {
+            roleStyles[r] = static_cast<int>(tuple % static_cast<uint64_t>(numStyles));
+            tuple /= static_cast<uint64_t>(numStyles);
+        }
+    }
+
+    /**
+     * 前 numStyles 個風格名稱的 FNV-1a（風格順序或內容不同時 bank 失效）
+     */
+    static uint32_t styleChecksum(int numStyles) {
+        uint32_t hash = 2166136261u;
+        for (int s = 0; s < numStyles; s++) {
+            for (const char* c = getStyleName(s); *c != '\0'; c++) {
+                hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+            }
+            hash = (hash ^ 0xFFu) * 16777619u;
+        }
+        return hash;
+    }
+
+    /**
+     * Deck → record（velocity 量化為 1-255，0 = 無觸發）
+     */
+    void encode(const Deck& deck, uint8_t* out) const {
+        for (int v = 0; v < NUM_PATTERN_VOICES; v++) {
+            encodePattern(deck.patterns.patterns[v], out + v * length);
+            for (int level = 0; level < Deck::FILL_LEVELS; level++) {
+                encodePattern(deck.fillBank[level].patterns[v], out + fillRow(level, v) * length);
+            }
+        }
+        uint8_t* mods = out + PATTERN_ROWS * length;
+        for (int i = 0; i < NUM_VOICES; i++) {
+            mods[i] = quantize(deck.synthMods.freqMod[i], 0.5f, 2.0f);
+            mods[NUM_VOICES + i] = quantize(deck.synthMods.decayMod[i], 0.2f, 2.0f);
+        }
+    }
+
+    /**
+     * record → Deck 的 patterns / fillBank / synth modifiers（fillPatterns 由安裝時的 selectFill 設定）
+     */
+    void decode(const uint8_t* in, Deck& deck) const {
+        for (int v = 0; v < NUM_PATTERN_VOICES; v++) {
+            decodePattern(in + v * length, deck.patterns.patterns[v]);
+            for (int level = 0; level < Deck::FILL_LEVELS; level++) {
+                decodePattern(in + fillRow(level, v) * length, deck.fillBank[level].patterns[v]);
+            }
+        }
+        const uint8_t* mods = in + PATTERN_ROWS * length;
+        for (int i = 0; i < NUM_VOICES; i++) {
+            deck.synthMods.freqMod[i] = dequantize(mods[i], 0.5f, 2.0f);
+            deck.synthMods.decayMod[i] = dequantize(mods[NUM_VOICES + i], 0.2f, 2.0f);
+        }
+    }
+
+private:
+    static int fillRow(int level, int voice) {
+        return NUM_PATTERN_VOICES * (1 + level) + voice;
+    }
+
+    void encodePattern(const Pattern& p, uint8_t* out) const {
+        for (int i = 0; i < length; i++) {
+            out[i] = p.hasOnset(i)
+                ? static_cast<uint8_t>(std::clamp(static_cast<int>(std::lround(p.velocities[i] * 255.0f)), 1, 255))
+                : 0;
+        }
+    }
+
+    void decodePattern(const uint8_t* in, Pattern& p) const {
+        p = Pattern(length);
+        for (int i = 0; i < length; i++) {
+            if (in[i] != 0) p.setOnset(i, static_cast<float>(in[i]) * (1.0f / 255.0f));
+        }
+    }
+
+    static uint8_t quantize(float value, float lo, float hi) {
+        return static_cast<uint8_t>(std::lround(std::clamp((value - lo) / (hi - lo), 0.0f, 1.0f) * 255.0f));
+    }
+
+    static float dequantize(uint8_t value, float lo, float hi) {
+        return lo + (hi - lo) * static_cast<float>(value) * (1.0f / 255.0f);
+    }
+};
+
+/**
+ * 唯讀的 bank（資料由呼叫端映射並保持有效）
+ */
+class PatternBank {
+public:
+    /**
+     * 驗證並使用 data；格式不符或與目前風格不一致時回傳 false
+     */
+    bool attach(const void* data, size_t size) {
+        detach();
+        if (data == nullptr || size < sizeof(PatternBankHeader)) return false;
+
+        PatternBankHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, PatternBankFormat::MAGIC, sizeof(header.magic)) != 0) return false;
+        if (header.version != PatternBankFormat::VERSION) return false;
+        if (header.fillLevels != static_cast<uint32_t>(Deck::FILL_LEVELS)) return false;
+
+        PatternBankLayout layout;
+        layout.numStyles = static_cast<int>(header.numStyles);
+        layout.length = static_cast<int>(header.length);
+        layout.variationBuckets = static_cast<int>(header.variationBuckets);
+        layout.densityBuckets = static_cast<int>(header.densityBuckets);
+        layout.numDensityProfiles = static_cast<int>(header.numDensityProfiles);
+
+        if (layout.numStyles < 1 || layout.numStyles > getNumStyles()) return false;
+        if (header.styleChecksum != PatternBankLayout::styleChecksum(layout.numStyles)) return false;
+        if (layout.length < 1 || layout.length > Pattern::MAX_STEPS) return false;
+        if (layout.variationBuckets < 1 || layout.variationBuckets > 64) return false;
+        if (layout.densityBuckets < 1 || layout.densityBuckets > 64) return false;
+        if (layout.numDensityProfiles < 1 || layout.numDensityProfiles > PatternBankFormat::MAX_DENSITY_PROFILES) return false;
+        if (header.recordSize != layout.recordSize() || header.numGroups != layout.numGroups()) return false;
+
+        const uint64_t groupsOffset = sizeof(PatternBankHeader) + layout.densityProfilesSize();
+        const uint64_t indexEnd = groupsOffset + header.numGroups * sizeof(PatternBankGroup);
+        if (indexEnd > size || header.recordsOffset < indexEnd || header.recordsOffset > size) return false;
+        if (header.numRecords > (size - header.recordsOffset) / header.recordSize) return false;
+
+        const char* bytes = static_cast<const char*>(data);
+        std::memcpy(layout.densityProfiles, bytes + sizeof(PatternBankHeader), layout.densityProfilesSize());
+        for (int p = 0; p < layout.numDensityProfiles; p++) {
+            for (int r = 0; r < NUM_ROLES; r++) {
+                const float d = layout.densityProfiles[p][r];
+                if (!(d >= 0.0f && d <= PatternBankFormat::MAX_DENSITY)) return false;
+            }
+        }
+
+        header_ = header;
+        layout_ = layout;
+        groups_ = reinterpret_cast<const PatternBankGroup*>(bytes + groupsOffset);
+        records_ = reinterpret_cast<const uint8_t*>(bytes + header.recordsOffset);
+        return true;
+    }
+
+    void detach() {
+        groups_ = nullptr;
+        records_ = nullptr;
+    }
+
+    bool isLoaded() const { return groups_ != nullptr; }
+
+    const PatternBankHeader& getHeader() const { return header_; }
+    const PatternBankLayout& getLayout() const { return layout_; }
+
+    /**
+     * 查詢並解碼一個 variant 到 deck（O(1)）
+     * @param pick 選擇 variant 的亂數（同一個值永遠得到同一個 variant）
+     * @return false = 沒有對應的 variant，deck 不變
+     */
+    bool load(const int* roleStyles, float variation, const float* roleDensities, int length,
+              uint64_t pick, Deck& deck) const {
+        if (!isLoaded() || length != layout_.length) return false;
+
+        for (int r = 0; r < NUM_ROLES; r++) {
+            if (roleStyles[r] < 0 || roleStyles[r] >= layout_.numStyles) return false;
+        }
+        const int densityProfile = layout_.densityProfile(roleDensities);
+        if (densityProfile < 0) return false;
+        const int variationBucket = layout_.variationBucket(variation);
+
+        const PatternBankGroup& group =
+            groups_[layout_.groupIndex(layout_.styleTuple(roleStyles), variationBucket, densityProfile)];
+        if (group.count == 0 || static_cast<uint64_t>(group.firstRecord) + group.count > header_.numRecords) return false;
+
+        const uint64_t record = group.firstRecord + pick % group.count;
+        layout_.decode(records_ + record * header_.recordSize, deck);
+        for (int r = 0; r < NUM_ROLES; r++) {
+            deck.styleIndices[r] = roleStyles[r];
+        }
+        deck.variation = layout_.variationCenter(variationBucket);
+        return true;
+    }
+
+private:
+    PatternBankHeader header_ = {};
+    PatternBankLayout layout_;
+    const PatternBankGroup* groups_ = nullptr;
+    const uint8_t* records_ = nullptr;
+};
+
+} // namespace TechnoMachine
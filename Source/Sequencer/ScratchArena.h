@@ -0,0 +1,69 @@
+/**
+ * ScratchArena.h
+ * Techno Machine - 生成用暫存配置器
+ *
+ * 固定大小的 bump allocator，取代 pattern 生成時的暫存 std::vector：
+ * - 記憶體內嵌在物件中，配置只是移動 offset，不會觸及 heap
+ * - 以 Scope 標記釋放：Scope 解構時回到建立時的 offset
+ * - 空間不足時回傳 nullptr（呼叫端需處理）
+ * - 非執行緒安全，每個生成器各自持有一個
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace TechnoMachine {
+
+template <size_t CapacityBytes>
+class ScratchArena {
+public:
+    /**
+     * 配置 count 個 T（未初始化）
+     */
+    template <typename T>
+    T* allocate(int count) {
+        static_assert(std::is_trivially_destructible<T>::value, "ScratchArena never runs destructors");
+        static_assert(alignof(T) <= ALIGNMENT, "ScratchArena alignment too small for T");
+
+        if (count <= 0) return nullptr;
+
+        size_t bytes = sizeof(T) * static_cast<size_t>(count);
+        size_t start = (offset_ + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        if (start + bytes > CapacityBytes) return nullptr;
+
+        offset_ = start + bytes;
+        return reinterpret_cast<T*>(buffer_ + start);
+    }
+
+    void reset() { offset_ = 0; }
+
+    size_t used() const { return offset_; }
+    static constexpr size_t capacity() { return CapacityBytes; }
+
+    /**
+     * RAII 標記：離開 scope 時釋放期間配置的全部空間
+     */
+    class Scope {
+    public:
+        explicit Scope(ScratchArena& arena) : arena_(arena), mark_(arena.offset_) {}
+        ~Scope() { arena_.offset_ = mark_; }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        ScratchArena& arena_;
+        size_t mark_;
+    };
+
+private:
+    static constexpr size_t ALIGNMENT = 16;
+
+    alignas(ALIGNMENT) uint8_t buffer_[CapacityBytes];
+    size_t offset_ = 0;
+};
+
+} // namespace TechnoMachine
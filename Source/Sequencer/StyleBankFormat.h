@@ -0,0 +1,78 @@
+/**
+ * StyleBankFormat.h
+ * Techno Machine - 訓練風格庫的二進位格式
+ *
+ * 由 Tools/StyleTrainer 從 MIDI 鼓組檔案產生，引擎啟動時以 memory map 讀取：
+ *
+ *   [StyleBankHeader][StyleBankEntry × numStyles]
+ *
+ * - 固定大小的 entry，第 i 個風格位於 sizeof(header) + i × sizeof(entry)，不需解析
+ * - 所有欄位為 little-endian 的 32-bit 值（與 macOS / Windows / Linux 的 x86-64 / arm64 相同）
+ * - 不依賴 JUCE，訓練工具與引擎共用
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "../Synthesis/SynthTypes.h"
+
+namespace TechnoMachine {
+
+namespace StyleBankFormat {
+    static constexpr char MAGIC[4] = {'T', 'M', 'S', 'B'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr int NAME_LENGTH = 32;
+    static constexpr int POSITIONS = 16;
+    static constexpr int HISTORY_BITS = 4;
+    static constexpr int HISTORIES = 1 << HISTORY_BITS;
+}
+
+struct StyleBankHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t numStyles;
+    uint32_t entrySize;     // sizeof(StyleBankEntry)，讀取時驗證
+};
+
+struct StyleBankEntry {
+    char name[StyleBankFormat::NAME_LENGTH];   // 以 '\0' 結尾
+    float swing;                                // 0.5 = straight
+    uint32_t numFiles;
+    uint32_t numBars;
+
+    // 與 StyleProfile 相同的 16 位置權重（最大值正規化為 1.0）
+    float weights[NUM_ROLES][StyleBankFormat::POSITIONS];
+
+    // 每小節 density 的 [10%, 90%] 百分位
+    float densityRange[NUM_ROLES][2];
+
+    // 馬可夫轉移次數：[角色][小節內位置][前 4 步歷史 (bit 0 = 前一步)][REST / HIT]
+    uint32_t transitions[NUM_ROLES][StyleBankFormat::POSITIONS][StyleBankFormat::HISTORIES][2];
+};
+
+static_assert(sizeof(StyleBankHeader) == 16, "StyleBankHeader layout");
+static_assert(sizeof(StyleBankEntry) == 32 + 12 + NUM_ROLES * 16 * 4 + NUM_ROLES * 2 * 4 + NUM_ROLES * 16 * 16 * 2 * 4,
+              "StyleBankEntry layout");
+
+namespace StyleBankFormat {
+    /**
+     * 驗證 header 並回傳 entry 陣列（格式錯誤或資料不完整時回傳 nullptr）
+     */
+    inline const StyleBankEntry* entries(const void* data, size_t size, int& numStyles) {
+        numStyles = 0;
+        if (data == nullptr || size < sizeof(StyleBankHeader)) return nullptr;
+
+        StyleBankHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) return nullptr;
+        if (header.version != VERSION || header.entrySize != sizeof(StyleBankEntry)) return nullptr;
+        if (header.numStyles > (size - sizeof(StyleBankHeader)) / sizeof(StyleBankEntry)) return nullptr;
+
+        numStyles = static_cast<int>(header.numStyles);
+        return reinterpret_cast<const StyleBankEntry*>(static_cast<const char*>(data) + sizeof(StyleBankHeader));
+    }
+}
+
+} // namespace TechnoMachine
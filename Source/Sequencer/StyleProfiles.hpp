@@ -4,11 +4,17 @@
  *
  * 來源：UniversalRhythm StyleProfiles.hpp
  * 修改：所有風格 Techno 化（straight timing, 適合 4/4）
+ *
+ * 內建風格之後可再登錄訓練出的風格（StyleRegistry，見 StyleBankFormat.h）
  */
 
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include "../Synthesis/MinimalDrumSynth.h"
+#include "StyleBankFormat.h"
 
 namespace TechnoMachine {
 
@@ -329,9 +335,148 @@ inline const StyleProfile* const STYLES[] = {
     &STYLE_GAMELAN
 };
 
+static_assert(NUM_STYLE_PRESETS == NUM_STYLES, "每個內建風格都需要一組音色預設");
+
+/**
+ * 兩個風格位置權重的平均差距（0.0 - 1.0）
+ */
+inline float getStyleWeightDistance(const StyleProfile& a, const StyleProfile& b) {
+    float sum = 0.0f;
+    for (int pos = 0; pos < 16; pos++) {
+        sum += std::fabs(a.timeline[pos] - b.timeline[pos])
+             + std::fabs(a.foundation[pos] - b.foundation[pos])
+             + std::fabs(a.groove[pos] - b.groove[pos])
+             + std::fabs(a.lead[pos] - b.lead[pos]);
+    }
+    return sum / (16.0f * NUM_ROLES);
+}
+
+// ============================================================
+// Style Registry
+// ============================================================
+// index 0 到 NUM_STYLES - 1 為內建風格，之後是從風格庫載入的訓練風格
+
+static constexpr int MAX_STYLES = 64;
+
+class StyleRegistry {
+public:
+    static StyleRegistry& instance() {
+        static StyleRegistry registry;
+        return registry;
+    }
+
+    int count() const { return count_; }
+
+    const StyleProfile* get(int styleIdx) const {
+        if (styleIdx < 0 || styleIdx >= count_) return nullptr;
+        return styleIdx < NUM_STYLES ? STYLES[styleIdx] : &trained_[styleIdx - NUM_STYLES];
+    }
+
+    /**
+     * 訓練風格的原始資料（含馬可夫轉移次數）；內建風格回傳 nullptr
+     */
+    const StyleBankEntry* getTrainedEntry(int styleIdx) const {
+        if (styleIdx < NUM_STYLES || styleIdx >= count_) return nullptr;
+        return entries_[styleIdx - NUM_STYLES];
+    }
+
+    /**
+     * 音色預設使用的內建風格：內建風格為自己，訓練風格為位置權重最接近的內建風格，超出範圍為 0
+     */
+    int getPresetStyle(int styleIdx) const {
+        if (styleIdx < 0 || styleIdx >= count_) return 0;
+        return styleIdx < NUM_STYLES ? styleIdx : presetStyles_[styleIdx - NUM_STYLES];
+    }
+
+    /**
+     * 登錄風格庫中的風格（entry 指向的記憶體必須在程式結束前保持有效）
+     * 只能在啟動時、建立任何引擎物件之前呼叫；馬可夫表建立後即鎖定
+     * @return 實際登錄的數量（超過 MAX_STYLES 的部分略過）
+     */
+    int addTrained(const StyleBankEntry* entries, int numEntries) {
+        if (frozen_) return 0;
+
+        int added = 0;
+        for (int i = 0; i < numEntries && count_ < MAX_STYLES; i++) {
+            const StyleBankEntry& e = entries[i];
+            const int slot = count_ - NUM_STYLES;
+
+            std::memcpy(names_[slot], e.name, sizeof(names_[slot]));
+            names_[slot][StyleBankFormat::NAME_LENGTH - 1] = '\0';
+
+            StyleProfile& p = trained_[slot];
+            p.name = names_[slot];
+            p.swing = std::clamp(e.swing, 0.5f, 0.75f);
+            for (int pos = 0; pos < 16; pos++) {
+                p.timeline[pos] = std::clamp(e.weights[TIMELINE][pos], 0.0f, 1.0f);
+                p.foundation[pos] = std::clamp(e.weights[FOUNDATION][pos], 0.0f, 1.0f);
+                p.groove[pos] = std::clamp(e.weights[GROOVE][pos], 0.0f, 1.0f);
+                p.lead[pos] = std::clamp(e.weights[LEAD][pos], 0.0f, 1.0f);
+            }
+            for (int r = 0; r < NUM_ROLES; r++) {
+                p.densityRange[r][0] = std::clamp(e.densityRange[r][0], 0.0f, 1.0f);
+                p.densityRange[r][1] = std::clamp(e.densityRange[r][1], p.densityRange[r][0], 1.0f);
+            }
+
+            int nearest = 0;
+            for (int s = 1; s < NUM_STYLES; s++) {
+                if (getStyleWeightDistance(p, *STYLES[s]) < getStyleWeightDistance(p, *STYLES[nearest])) {
+                    nearest = s;
+                }
+            }
+            presetStyles_[slot] = nearest;
+
+            entries_[slot] = &e;
+            count_++;
+            added++;
+        }
+        return added;
+    }
+
+    void freeze() { frozen_ = true; }
+
+private:
+    static constexpr int MAX_TRAINED = MAX_STYLES - NUM_STYLES;
+
+    StyleProfile trained_[MAX_TRAINED] = {};
+    char names_[MAX_TRAINED][StyleBankFormat::NAME_LENGTH] = {};
+    const StyleBankEntry* entries_[MAX_TRAINED] = {};
+    int presetStyles_[MAX_TRAINED] = {};
+    int count_ = NUM_STYLES;
+    bool frozen_ = false;
+
+    StyleRegistry() = default;
+};
+
+/**
+ * 目前可用的風格數（內建 + 訓練）
+ */
+inline int getNumStyles() {
+    return StyleRegistry::instance().count();
+}
+
+/**
+ * 取得風格（超出範圍回傳 nullptr）
+ */
+inline const StyleProfile* getStyleProfile(int styleIdx) {
+    return StyleRegistry::instance().get(styleIdx);
+}
+
 inline const char* getStyleName(int styleIdx) {
-    if (styleIdx < 0 || styleIdx >= NUM_STYLES) return "Unknown";
-    return STYLES[styleIdx]->name;
+    const StyleProfile* style = getStyleProfile(styleIdx);
+    return style ? style->name : "Unknown";
+}
+
+inline float getStyleSwing(int styleIdx) {
+    const StyleProfile* style = getStyleProfile(styleIdx);
+    return style ? style->swing : 0.5f;
+}
+
+/**
+ * 取得指定風格的音色預設（任何 index 都回傳有效的 NUM_VOICES 個預設）
+ */
+inline const VoicePreset* getStylePreset(int styleIdx) {
+    return STYLE_PRESETS[StyleRegistry::instance().getPresetStyle(styleIdx)];
 }
 
 // ============================================================
@@ -358,22 +503,30 @@ inline const float STYLE_DISSIMILARITY[NUM_STYLES][NUM_STYLES] = {
  * 取得兩個風格之間的差異度
  */
 inline float getStyleDissimilarity(int styleA, int styleB) {
-    if (styleA < 0 || styleA >= NUM_STYLES || styleB < 0 || styleB >= NUM_STYLES) {
-        return 0.5f;
+    if (styleA >= 0 && styleA < NUM_STYLES && styleB >= 0 && styleB < NUM_STYLES) {
+        return STYLE_DISSIMILARITY[styleA][styleB];
     }
-    return STYLE_DISSIMILARITY[styleA][styleB];
+
+    // 訓練風格：以位置權重的平均差距估計（矩陣中的內建風格約落在相同範圍）
+    const StyleProfile* a = getStyleProfile(styleA);
+    const StyleProfile* b = getStyleProfile(styleB);
+    if (a == nullptr || b == nullptr) return 0.5f;
+    if (a == b) return 0.0f;
+
+    return std::min(1.0f, 2.0f * getStyleWeightDistance(*a, *b));
 }
 
 /**
  * 找出與指定風格差異最大的風格列表
  * @param currentStyle 當前風格
  * @param minDissimilarity 最小差異度門檻
- * @param outStyles 輸出的風格索引陣列
+ * @param outStyles 輸出的風格索引陣列（至少 MAX_STYLES 個）
  * @return 符合條件的風格數量
  */
 inline int findDissimilarStyles(int currentStyle, float minDissimilarity, int* outStyles) {
     int count = 0;
-    for (int i = 0; i < NUM_STYLES; i++) {
+    const int numStyles = getNumStyles();
+    for (int i = 0; i < numStyles; i++) {
         if (i != currentStyle && getStyleDissimilarity(currentStyle, i) >= minDissimilarity) {
             outStyles[count++] = i;
         }
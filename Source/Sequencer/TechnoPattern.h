@@ -11,52 +11,107 @@
 
 #pragma once
 
-#include <vector>
-#include <random>
 #include <algorithm>
 #include <cmath>
+#include <memory>
+#include <atomic>
+#include <type_traits>
 #include "StyleProfiles.hpp"
 #include "MarkovChain.hpp"
+#include "ScratchArena.h"
+#include "OnsetMask.h"
+#include "WeightedSampler.h"
 #include "../Synthesis/MinimalDrumSynth.h"
+#include "../Core/RandomStream.h"
 
 namespace TechnoMachine {
 
 /**
  * Pattern 結構
+ * 固定容量的內嵌陣列（最多 MAX_STEPS 步），無 heap 配置，複製即 memcpy
+ * onsetMask 與 velocities 同步（bit i = velocities[i] > 0），只能經由 setOnset / clearOnset / clear 修改
  */
 struct Pattern {
-    std::vector<float> velocities;  // 0.0 = 無觸發, 0.01-1.0 = velocity
+    static constexpr int MAX_STEPS = 64;
+
+    float velocities[MAX_STEPS];  // 0.0 = 無觸發, 0.01-1.0 = velocity；length 之後的步恆為 0
+    uint64_t onsetMask;
     int length;
 
     Pattern(int len = 16) :
-        velocities(static_cast<size_t>(std::max(1, len)), 0.0f),
-        length(std::max(1, len)) {}
+        velocities{},
+        onsetMask(0),
+        length(clampLength(len)) {}
+
+    static int clampLength(int len) {
+        return std::clamp(len, 1, MAX_STEPS);
+    }
 
     void clear() {
-        std::fill(velocities.begin(), velocities.end(), 0.0f);
+        std::fill(velocities, velocities + MAX_STEPS, 0.0f);
+        onsetMask = 0;
+    }
+
+    int wrap(int pos) const {
+        return (pos >= 0 && pos < length) ? pos : ((pos % length) + length) % length;
     }
 
     bool hasOnset(int pos) const {
         if (length <= 0) return false;
-        return velocities[static_cast<size_t>(pos % length)] > 0.0f;
+        return (onsetMask >> wrap(pos)) & 1u;
     }
 
     float getVelocity(int pos) const {
         if (length <= 0) return 0.0f;
-        return velocities[static_cast<size_t>(pos % length)];
+        return velocities[wrap(pos)];
     }
 
     void setOnset(int pos, float velocity = 0.7f) {
         if (length <= 0) return;
-        velocities[static_cast<size_t>(pos % length)] = std::clamp(velocity, 0.01f, 1.0f);
+        int i = wrap(pos);
+        velocities[i] = std::clamp(velocity, 0.01f, 1.0f);
+        onsetMask |= uint64_t(1) << i;
     }
 
     void clearOnset(int pos) {
         if (length <= 0) return;
-        velocities[static_cast<size_t>(pos % length)] = 0.0f;
+        int i = wrap(pos);
+        velocities[i] = 0.0f;
+        onsetMask &= ~(uint64_t(1) << i);
     }
+
+    // === 位元查詢 ===
+
+    // 前 length 步的遮罩
+    uint64_t stepMask() const { return OnsetMask::steps(length); }
+
+    // 空白步遮罩
+    uint64_t restMask() const { return stepMask() & ~onsetMask; }
+
+    int countOnsets() const { return OnsetMask::popcount(onsetMask); }
+
+    float getDensity() const { return static_cast<float>(countOnsets()) / static_cast<float>(length); }
+
+    // pos 之後（不含）下一個 onset，循環搜尋；沒有 onset 時回傳 -1
+    int nextOnset(int pos) const { return OnsetMask::next(onsetMask, wrap(pos), length); }
+
+    // === Interlock 位元運算（兩個 pattern 長度需相同） ===
+
+    // 兩者同時有 onset 的步
+    uint64_t overlapWith(const Pattern& other) const { return onsetMask & other.onsetMask; }
+
+    // 只有自己有 onset 的步
+    uint64_t exclusiveOf(const Pattern& other) const { return onsetMask & ~other.onsetMask; }
+
+    // 與自己 onset 相鄰的步（循環）
+    uint64_t neighbourMask() const { return OnsetMask::neighbours(onsetMask, length); }
+
+    // 平移 n 步後的遮罩（循環）
+    uint64_t shiftedMask(int n) const { return OnsetMask::rotate(onsetMask, n, length); }
 };
 
+static_assert(std::is_trivially_copyable<Pattern>::value, "Pattern must stay memcpy-able");
+
 /**
  * 風格權重存取器
  * 支援 per-role 不同風格（複合風格）
@@ -65,15 +120,21 @@ class StyleWeights {
 public:
     // 設定統一風格（所有角色使用相同風格）
     static void setStyle(const StyleProfile* style) {
+        int idx = 0;
+        const int numStyles = getNumStyles();
+        for (int s = 0; s < numStyles; s++) {
+            if (getStyleProfile(s) == style) idx = s;
+        }
         for (int i = 0; i < NUM_ROLES; i++) {
             roleStyles_[i] = style;
+            roleStyleIndices_[i] = idx;
         }
     }
 
     // 設定統一風格（by index）
     static void setStyle(int styleIdx) {
-        if (styleIdx >= 0 && styleIdx < NUM_STYLES) {
-            setStyle(STYLES[styleIdx]);
+        if (const StyleProfile* style = getStyleProfile(styleIdx)) {
+            setStyle(style);
         }
     }
 
@@ -81,19 +142,25 @@ public:
     static void setCompositeStyle(const int* roleStyleIndices) {
         for (int i = 0; i < NUM_ROLES; i++) {
             int idx = roleStyleIndices[i];
-            if (idx >= 0 && idx < NUM_STYLES) {
-                roleStyles_[i] = STYLES[idx];
+            if (const StyleProfile* style = getStyleProfile(idx)) {
+                roleStyles_[i] = style;
+                roleStyleIndices_[i] = idx;
             }
         }
     }
 
     // 設定單一角色的風格
     static void setRoleStyle(Role role, int styleIdx) {
-        if (role >= 0 && role < NUM_ROLES && styleIdx >= 0 && styleIdx < NUM_STYLES) {
-            roleStyles_[role] = STYLES[styleIdx];
+        const StyleProfile* style = getStyleProfile(styleIdx);
+        if (role >= 0 && role < NUM_ROLES && style != nullptr) {
+            roleStyles_[role] = style;
+            roleStyleIndices_[role] = styleIdx;
         }
     }
 
+    // 作用中 Deck 各角色的風格 index（馬可夫轉移表直接讀取作用中 Deck，不經過這裡）
+    static const int* getStyleIndices() { return roleStyleIndices_; }
+
     static const StyleProfile* getStyle(Role role) {
         if (role >= 0 && role < NUM_ROLES && roleStyles_[role]) {
             return roleStyles_[role];
@@ -129,6 +196,7 @@ private:
     static inline const StyleProfile* roleStyles_[NUM_ROLES] = {
         &STYLE_TECHNO, &STYLE_TECHNO, &STYLE_TECHNO, &STYLE_TECHNO
     };
+    static inline int roleStyleIndices_[NUM_ROLES] = {0, 0, 0, 0};
 };
 
 /**
@@ -160,9 +228,21 @@ struct MultiVoicePatterns {
  */
 class PatternGenerator {
 public:
-    PatternGenerator() : rng_(std::random_device{}()) {}
+    PatternGenerator() = default;
+
+    void seed(uint64_t s) { rng_.reset(s, 0); }
 
-    void seed(unsigned int s) { rng_.seed(s); }
+    /**
+     * 設定各角色使用的風格（生成時不讀取全域 StyleWeights，可在背景執行緒使用）
+     */
+    void setStyles(const int* roleStyleIndices) {
+        for (int i = 0; i < NUM_ROLES; i++) {
+            int idx = roleStyleIndices[i];
+            if (const StyleProfile* style = getStyleProfile(idx)) {
+                styles_[i] = style;
+            }
+        }
+    }
 
     /**
      * 生成完整的 8 聲道 Pattern
@@ -170,6 +250,7 @@ public:
      */
     MultiVoicePatterns generate(int length = 16, float variation = 0.5f,
                                 const float* densities = nullptr) {
+        length = Pattern::clampLength(length);
         MultiVoicePatterns result(length);
 
         // 計算各 Role 的 density
@@ -181,8 +262,8 @@ public:
         } else {
             // 從當前風格取得範圍，用 variation 計算
             for (int r = 0; r < NUM_ROLES; r++) {
-                float dMin = StyleWeights::getDensityMin(static_cast<Role>(r));
-                float dMax = StyleWeights::getDensityMax(static_cast<Role>(r));
+                float dMin = getDensityMin(static_cast<Role>(r));
+                float dMax = getDensityMax(static_cast<Role>(r));
                 localDensities[r] = dMin + variation * (dMax - dMin);
             }
         }
@@ -218,18 +299,21 @@ private:
         Pattern p(length);
         if (density < 0.01f) return p;
 
-        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-        std::uniform_real_distribution<float> velVar(-0.1f, 0.1f);
+        UniformReal dist(0.0f, 1.0f);
+        UniformReal velVar(-0.1f, 0.1f);
 
-        const float* styleWeights = StyleWeights::getWeights(role);
+        const float* styleWeights = getWeights(role);
+
+        // 建立權重陣列（暫存於 arena）
+        ScratchScope scope(scratch_);
+        float* weights = scratch_.allocate<float>(length);
+        if (weights == nullptr) return p;
 
-        // 建立權重陣列
-        std::vector<float> weights(static_cast<size_t>(length));
         for (int i = 0; i < length; i++) {
             int mapped = (i * 16) / length;
-            weights[static_cast<size_t>(i)] = styleWeights[mapped];
+            weights[i] = styleWeights[mapped];
             // 套用 variation（與 uniform 混合）
-            weights[static_cast<size_t>(i)] = weights[static_cast<size_t>(i)] * (1.0f - variation) + variation;
+            weights[i] = weights[i] * (1.0f - variation) + variation;
         }
 
         // 權重式隨機選擇
@@ -246,8 +330,8 @@ private:
         Pattern p(length);
         if (density < 0.01f) return p;
 
-        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-        std::uniform_real_distribution<float> velVar(-0.05f, 0.05f);
+        UniformReal dist(0.0f, 1.0f);
+        UniformReal velVar(-0.05f, 0.05f);
 
         int quarterInterval = length / 4;
 
@@ -259,7 +343,7 @@ private:
 
         // 高 variation 時加入 off-beat
         if (variation > 0.3f) {
-            const float* styleWeights = StyleWeights::getWeights(FOUNDATION);
+            const float* styleWeights = getWeights(FOUNDATION);
             for (int i = 0; i < length; i++) {
                 if (p.hasOnset(i)) continue;
                 int mapped = (i * 16) / length;
@@ -280,8 +364,8 @@ private:
         Pattern p(length);
         if (density < 0.01f) return p;
 
-        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-        std::uniform_real_distribution<float> velVar(-0.08f, 0.08f);
+        UniformReal dist(0.0f, 1.0f);
+        UniformReal velVar(-0.08f, 0.08f);
 
         int quarterInterval = length / 4;
 
@@ -312,29 +396,40 @@ private:
         Pattern p(length);
         if (density < 0.01f) return p;
 
-        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-        std::uniform_real_distribution<float> velVar(-0.1f, 0.1f);
+        UniformReal dist(0.0f, 1.0f);
+        UniformReal velVar(-0.1f, 0.1f);
+
+        const float* styleWeights = getWeights(role);
 
-        const float* styleWeights = StyleWeights::getWeights(role);
+        // 建立權重陣列（暫存於 arena）
+        ScratchScope scope(scratch_);
+        float* weights = scratch_.allocate<float>(length);
+        if (weights == nullptr) return p;
+
+        // Reference 長度不同時以步數重新取樣（一般情況兩者相同）
+        uint64_t referenceMask = reference.onsetMask;
+        if (reference.length != length) {
+            referenceMask = 0;
+            for (int i = 0; i < length; i++) {
+                if (reference.hasOnset(i)) referenceMask |= uint64_t(1) << i;
+            }
+        }
+        const uint64_t adjacentMask = OnsetMask::neighbours(referenceMask, length);
 
-        // 建立權重陣列
-        std::vector<float> weights(static_cast<size_t>(length));
         for (int i = 0; i < length; i++) {
             int mapped = (i * 16) / length;
-            weights[static_cast<size_t>(i)] = styleWeights[mapped];
-            weights[static_cast<size_t>(i)] = weights[static_cast<size_t>(i)] * (1.0f - variation) + variation;
+            weights[i] = styleWeights[mapped];
+            weights[i] = weights[i] * (1.0f - variation) + variation;
 
             // === Interlock 規則 ===
             // Reference 有 onset 的位置：降低權重
-            if (reference.hasOnset(i)) {
-                weights[static_cast<size_t>(i)] *= 0.2f;
+            if ((referenceMask >> i) & 1u) {
+                weights[i] *= 0.2f;
             }
 
             // Reference 的相鄰位置：提升權重
-            int prev = (i - 1 + length) % length;
-            int next = (i + 1) % length;
-            if (reference.hasOnset(prev) || reference.hasOnset(next)) {
-                weights[static_cast<size_t>(i)] *= 1.3f;
+            if ((adjacentMask >> i) & 1u) {
+                weights[i] *= 1.3f;
             }
         }
 
@@ -346,21 +441,35 @@ private:
     }
 
     /**
-     * 權重式隨機選擇
+     * 權重式隨機選擇（不放回）
+     * 短 pattern 用線性掃描，長 pattern 用 Fenwick tree（兩者分佈相同）
+     */
+    void weightedSelect(Pattern& p, float* weights, int targetOnsets,
+                        UniformReal& velVar,
+                        UniformReal& dist) {
+        if (p.length >= FENWICK_MIN_LENGTH) {
+            weightedSelectFenwick(p, weights, targetOnsets, velVar, dist);
+        } else {
+            weightedSelectLinear(p, weights, targetOnsets, velVar, dist);
+        }
+    }
+
+    /**
+     * 線性版：每次重算總權重並累加掃描，O(length × onsets)
      */
-    void weightedSelect(Pattern& p, std::vector<float>& weights, int targetOnsets,
-                        std::uniform_real_distribution<float>& velVar,
-                        std::uniform_real_distribution<float>& dist) {
-        int length = p.length;
+    void weightedSelectLinear(Pattern& p, float* weights, int targetOnsets,
+                              UniformReal& velVar,
+                              UniformReal& dist) {
         int placed = 0;
 
         while (placed < targetOnsets) {
+            // 只走訪空白步
+            const uint64_t rests = p.restMask();
+
             // 計算總權重
             float totalWeight = 0.0f;
-            for (int i = 0; i < length; i++) {
-                if (!p.hasOnset(i)) {
-                    totalWeight += weights[static_cast<size_t>(i)];
-                }
+            for (uint64_t m = rests; m != 0; m &= m - 1) {
+                totalWeight += weights[OnsetMask::lowestBit(m)];
             }
 
             if (totalWeight < 0.001f) break;
@@ -370,20 +479,19 @@ private:
             float cumulative = 0.0f;
             int selected = -1;
 
-            for (int i = 0; i < length; i++) {
-                if (!p.hasOnset(i)) {
-                    cumulative += weights[static_cast<size_t>(i)];
-                    if (cumulative >= rand) {
-                        selected = i;
-                        break;
-                    }
+            for (uint64_t m = rests; m != 0; m &= m - 1) {
+                int i = OnsetMask::lowestBit(m);
+                cumulative += weights[i];
+                if (cumulative >= rand) {
+                    selected = i;
+                    break;
                 }
             }
 
             if (selected >= 0) {
-                float vel = 0.6f + weights[static_cast<size_t>(selected)] * 0.3f + velVar(rng_);
+                float vel = 0.6f + weights[selected] * 0.3f + velVar(rng_);
                 p.setOnset(selected, std::clamp(vel, 0.3f, 1.0f));
-                weights[static_cast<size_t>(selected)] = 0.0f;  // 防止重複選擇
+                weights[selected] = 0.0f;  // 防止重複選擇
                 placed++;
             } else {
                 break;
@@ -391,7 +499,58 @@ private:
         }
     }
 
-    std::mt19937 rng_;
+    /**
+     * Fenwick 版：建樹 O(length)，每個 onset O(log length)
+     * 呼叫時 p 必須沒有 onset（與線性版相同，已有 onset 的位置不會被排除）
+     */
+    void weightedSelectFenwick(Pattern& p, float* weights, int targetOnsets,
+                               UniformReal& velVar,
+                               UniformReal& dist) {
+        sampler_.build(weights, p.length);
+        int placed = 0;
+
+        while (placed < targetOnsets) {
+            float totalWeight = sampler_.total();
+            if (totalWeight < 0.001f) break;
+
+            int selected = sampler_.sample(dist(rng_), totalWeight);
+            if (selected < 0) break;
+
+            float vel = 0.6f + weights[selected] * 0.3f + velVar(rng_);
+            p.setOnset(selected, std::clamp(vel, 0.3f, 1.0f));
+            weights[selected] = 0.0f;
+            sampler_.remove(selected);
+            placed++;
+        }
+    }
+
+    const float* getWeights(Role role) const {
+        const StyleProfile* s = styles_[role];
+        switch (role) {
+            case TIMELINE: return s->timeline;
+            case FOUNDATION: return s->foundation;
+            case GROOVE: return s->groove;
+            case LEAD: return s->lead;
+            default: return s->timeline;
+        }
+    }
+
+    float getDensityMin(Role role) const { return styles_[role]->densityRange[role][0]; }
+    float getDensityMax(Role role) const { return styles_[role]->densityRange[role][1]; }
+
+    // 實測（x86-64, -O2）：低於 48 步時線性掃描較快
+    static constexpr int FENWICK_MIN_LENGTH = 48;
+
+    // 生成暫存（每次最多同時使用一個 MAX_STEPS 長度的權重陣列）
+    using Scratch = ScratchArena<Pattern::MAX_STEPS * sizeof(float) * 4>;
+    using ScratchScope = Scratch::Scope;
+
+    RandomStream rng_;
+    Scratch scratch_;
+    FenwickSampler<Pattern::MAX_STEPS> sampler_;
+    const StyleProfile* styles_[NUM_ROLES] = {
+        &STYLE_TECHNO, &STYLE_TECHNO, &STYLE_TECHNO, &STYLE_TECHNO
+    };
 };
 
 /**
@@ -428,6 +587,14 @@ struct MergedTriggerDecision {
     bool fromPrimary;  // true = Primary, false = Secondary
 };
 
+/**
+ * 單一步的全部決策（8 個 pattern voice + 4 個合併結果）
+ */
+struct StepDecisions {
+    CrossfadeDecision voices[NUM_PATTERN_VOICES];
+    MergedTriggerDecision merged[NUM_ROLES];
+};
+
 /**
  * Enhanced Fill 設定
  * intensity 控制所有衍生參數
@@ -467,22 +634,277 @@ struct MixedPreset {
     float decay[NUM_VOICES];
 };
 
+/**
+ * 一個 Deck 的完整內容（patterns、fill、音色修正、風格）
+ *
+ * Fill 在載入時依 FILL_LEVELS 個 intensity 等級各生成一組（fillBank），
+ * 改變 intensity 只從 fillBank 選出 / 內插到 fillPatterns，不重新生成
+ */
+struct Deck {
+    static constexpr int FILL_LEVELS = 5;  // intensity 0, 0.25, 0.5, 0.75, 1.0
+
+    MultiVoicePatterns patterns{16};
+    MultiVoicePatterns fillPatterns{16};            // 目前 intensity 使用的 fill
+    MultiVoicePatterns fillBank[FILL_LEVELS];
+    SynthModifiers synthMods;
+    int styleIndices[NUM_ROLES] = {0, 0, 0, 0};
+    float variation = 0.5f;
+
+    static float fillLevelIntensity(int level) {
+        return static_cast<float>(level) / static_cast<float>(FILL_LEVELS - 1);
+    }
+
+    /**
+     * 依 intensity 從 fillBank 設定 fillPatterns（不配置、不使用亂數，可在音訊執行緒呼叫）
+     * @param crossfade false = 最接近的等級；true = 相鄰兩級之間過渡：
+     *                  兩級共有的音符內插 velocity；只在其中一級的音符依每一步固定的門檻
+     *                  逐一換入 / 換出，音符數隨 intensity 線性變化，來回移動時結果相同
+     */
+    void selectFill(float intensity, bool crossfade) {
+        const float position = std::clamp(intensity, 0.0f, 1.0f) * static_cast<float>(FILL_LEVELS - 1);
+        const int lower = std::min(static_cast<int>(position), FILL_LEVELS - 1);
+        const int upper = std::min(lower + 1, FILL_LEVELS - 1);
+        const float frac = position - static_cast<float>(lower);
+
+        if (!crossfade || lower == upper || frac <= 0.0f) {
+            fillPatterns = fillBank[crossfade ? lower : static_cast<int>(std::lround(position))];
+            return;
+        }
+
+        for (int v = 0; v < NUM_PATTERN_VOICES; v++) {
+            const Pattern& a = fillBank[lower].patterns[v];
+            const Pattern& b = fillBank[upper].patterns[v];
+            Pattern& out = fillPatterns.patterns[v];
+            out = Pattern(a.length);
+
+            for (uint64_t m = a.onsetMask | b.onsetMask; m != 0; m &= m - 1) {
+                const int i = OnsetMask::lowestBit(m);
+                const bool inA = (a.onsetMask >> i) & 1u;
+                const bool inB = (b.onsetMask >> i) & 1u;
+
+                if (inA && inB) {
+                    out.setOnset(i, a.velocities[i] * (1.0f - frac) + b.velocities[i] * frac);
+                } else if (inB == (crossfadeThreshold(v, i) < frac)) {
+                    out.setOnset(i, inA ? a.velocities[i] : b.velocities[i]);
+                }
+            }
+        }
+    }
+
+    /**
+     * 每個 (voice, step) 固定的 [0, 1) 門檻（雜湊，不消耗亂數串流）
+     */
+    static float crossfadeThreshold(int voice, int step) {
+        uint64_t h = RandomDetail::mix64(static_cast<uint64_t>(voice * Pattern::MAX_STEPS + step) + 1);
+        return static_cast<float>(h >> 40) * (1.0f / 16777216.0f);
+    }
+
+    void clear() {
+        for (int i = 0; i < NUM_PATTERN_VOICES; i++) {
+            patterns.patterns[i].clear();
+            fillPatterns.patterns[i].clear();
+            for (auto& level : fillBank) {
+                level.patterns[i].clear();
+            }
+        }
+    }
+};
+
+/**
+ * Deck 生成器
+ * 不依賴全域狀態（風格由 deck.styleIndices 決定），每個執行緒各自持有一個實例
+ */
+class DeckGenerator {
+public:
+    DeckGenerator() = default;
+
+    void seed(uint64_t s) {
+        rng_.reset(s, 0);
+        generator_.seed(RandomStream::deriveKey(s, 1));
+    }
+
+    /**
+     * 生成 Deck 的 patterns、ghost notes、synth modifiers 與各 intensity 等級的 fill
+     * deck.styleIndices 需事先設定；fillPatterns 由呼叫端以 selectFill() 依目前 intensity 設定
+     */
+    void generate(Deck& deck, int length, float variation, const float* roleDensities) {
+        generator_.setStyles(deck.styleIndices);
+
+        // 生成 patterns
+        deck.patterns = generator_.generate(length, variation, roleDensities);
+        deck.variation = variation;
+
+        // 加入 Ghost Notes
+        addGhostNotes(deck, variation);
+
+        // 生成 Synth Modifiers
+        generateSynthModifiers(deck, variation);
+
+        // 生成各等級的 Fill Pattern
+        generateFillBank(deck, length, variation, roleDensities);
+    }
+
+    /**
+     * 為指定 Deck 生成全部 FILL_LEVELS 個等級的 fill
+     * 每個等級使用同一個子 seed，相鄰等級的 pattern 高度相關，內插時不會突然整組換掉
+     */
+    void generateFillBank(Deck& deck, int length, float variation, const float* roleDensities) {
+        generator_.setStyles(deck.styleIndices);
+        const uint64_t fillSeed = rng_.nextU64();
+
+        for (int level = 0; level < Deck::FILL_LEVELS; level++) {
+            FillSettings settings;
+            settings.intensity = Deck::fillLevelIntensity(level);
+
+            generator_.seed(RandomStream::deriveKey(fillSeed, 1));
+            fillRng_.reset(fillSeed, 2);
+            generateFill(deck.fillBank[level], length, variation, roleDensities, settings);
+        }
+    }
+
+private:
+    /**
+     * 生成單一等級的 Fill Pattern
+     * 使用 FillSettings 控制複雜度與密度
+     *
+     * Complexity 決定參與的角色數量：
+     * 1 = Timeline only
+     * 2 = Timeline + Foundation
+     * 3 = Timeline + Foundation + Groove
+     * 4 = All roles
+     */
+    void generateFill(MultiVoicePatterns& out, int length, float variation,
+                      const float* roleDensities, const FillSettings& fillSettings) {
+
+        // 取得 fill 設定
+        int complexity = fillSettings.getComplexity();     // 1-4
+        float fillDensity = fillSettings.getDensity();     // 0.4-0.9
+        float accentProb = fillSettings.getAccentProbability();
+
+        // 建立 fill 專用的 density 陣列
+        float fillDensities[NUM_ROLES];
+        for (int r = 0; r < NUM_ROLES; r++) {
+            // 根據 complexity 決定角色是否參與
+            // Role 順序: TIMELINE=0, FOUNDATION=1, GROOVE=2, LEAD=3
+            if (r < complexity) {
+                // 參與 fill 的角色使用較高密度
+                fillDensities[r] = fillDensity;
+            } else {
+                // 不參與的角色維持基礎節奏
+                fillDensities[r] = roleDensities[r] * 0.3f;
+            }
+        }
+
+        // 生成 fill patterns
+        out = generator_.generate(length, variation + 0.2f, fillDensities);
+
+        // 套用 velocity 和 accent
+        UniformReal dist(0.0f, 1.0f);
+        UniformReal velDist(0.7f, 0.95f);
+        UniformReal accentVelDist(0.95f, 1.0f);
+
+        for (int v = 0; v < NUM_PATTERN_VOICES; v++) {
+            int role = v / 2;
+            Pattern& fill = out.patterns[v];
+
+            for (int i = 0; i < fill.length; i++) {
+                if (fill.hasOnset(i)) {
+                    // 決定是否為 accent hit
+                    if (role < complexity && dist(fillRng_) < accentProb) {
+                        fill.setOnset(i, accentVelDist(fillRng_));
+                    } else {
+                        fill.setOnset(i, velDist(fillRng_));
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * 為指定 Deck 加入 Ghost Notes
+     * 處理 8 個 Pattern
+     */
+    void addGhostNotes(Deck& deck, float variation) {
+        UniformReal dist(0.0f, 1.0f);
+        UniformReal velDist(0.25f, 0.32f);
+        float ghostProb = 0.1f + variation * 0.2f;
+
+        for (int v = 0; v < NUM_PATTERN_VOICES; v++) {
+            Pattern& p = deck.patterns.patterns[v];
+            for (int i = 0; i < p.length; i++) {
+                if (p.hasOnset(i)) continue;
+
+                int prev = (i - 1 + p.length) % p.length;
+                int next = (i + 1) % p.length;
+                bool nearHit = p.hasOnset(prev) || p.hasOnset(next);
+                bool isWeakBeat = (i % 2 == 1);
+
+                float prob = ghostProb;
+                if (nearHit) prob *= 2.0f;
+                if (isWeakBeat) prob *= 1.5f;
+
+                if (dist(rng_) < prob) {
+                    p.setOnset(i, velDist(rng_));
+                }
+            }
+        }
+    }
+
+    /**
+     * 為指定 Deck 生成 Synth Modifiers
+     */
+    void generateSynthModifiers(Deck& deck, float variation) {
+        UniformReal freqVar(-0.3f, 0.3f);
+        UniformReal decayVar(-0.2f, 0.2f);
+
+        for (int v = 0; v < NUM_VOICES; v++) {
+            float freqBase = 1.0f + (variation - 0.5f) * 0.4f;
+            float decayBase = 1.0f + (variation - 0.5f) * 0.3f;
+
+            deck.synthMods.freqMod[v] = std::clamp(freqBase + freqVar(rng_) * variation, 0.5f, 2.0f);
+            deck.synthMods.decayMod[v] = std::clamp(decayBase + decayVar(rng_) * variation, 0.2f, 2.0f);
+        }
+    }
+
+    PatternGenerator generator_;
+    RandomStream rng_;
+    RandomStream fillRng_;
+};
+
+/**
+ * 預設的 per-role 生成 density（PatternBankBuilder 的預設 density profile 也使用這組值）
+ */
+static constexpr float DEFAULT_ROLE_DENSITIES[NUM_ROLES] = {0.4f, 0.2f, 0.5f, 0.5f};
+
 /**
  * Techno Pattern 引擎
  */
 class TechnoPatternEngine {
 public:
-    TechnoPatternEngine() : rng_(std::random_device{}()) {}
+    TechnoPatternEngine() {
+        syncStyleMirror(0);
+        syncStyleMirror(1);
+    }
+
+    /**
+     * 由引擎 seed 設定所有隨機串流（同步生成、混音決策、馬可夫鏈）
+     */
+    void setSeed(uint64_t seed) {
+        rng_.reset(seed, RandomStreamId::MixDecision);
+        markov_.seed(seed);
+        deckGenerator_.seed(RandomStream::deriveKey(seed, RandomStreamId::PatternEngine));
+    }
 
     // 風格切換（統一風格）- 設定到當前作用中的 Deck
     void setStyle(int styleIdx) {
-        if (styleIdx >= 0 && styleIdx < NUM_STYLES) {
+        if (styleIdx >= 0 && styleIdx < getNumStyles()) {
             currentStyleIdx_ = styleIdx;
-            Deck& d = (crossfaderPosition_ < 0.5f) ? deckA_ : deckB_;
+            Deck& d = (crossfaderPosition_ < 0.5f) ? *deckA_ : *deckB_;
             for (int i = 0; i < NUM_ROLES; i++) {
                 d.styleIndices[i] = styleIdx;
             }
             StyleWeights::setStyle(styleIdx);
+            syncStyleMirror(getActiveDeck());
         }
     }
 
@@ -492,12 +914,13 @@ public:
 
     // 設定複合風格到當前作用中的 Deck
     void setCompositeStyle(const int* roleStyles) {
-        Deck& d = (crossfaderPosition_ < 0.5f) ? deckA_ : deckB_;
+        Deck& d = (crossfaderPosition_ < 0.5f) ? *deckA_ : *deckB_;
         for (int i = 0; i < NUM_ROLES; i++) {
             d.styleIndices[i] = roleStyles[i];
         }
         StyleWeights::setCompositeStyle(roleStyles);
         currentStyleIdx_ = d.styleIndices[0];
+        syncStyleMirror(getActiveDeck());
     }
 
     // 設定複合風格到指定 Deck
@@ -506,13 +929,13 @@ public:
         for (int i = 0; i < NUM_ROLES; i++) {
             d.styleIndices[i] = roleStyles[i];
         }
+        syncStyleMirror(deck);
     }
 
     int getStyleIdx() const { return currentStyleIdx_; }
     int getRoleStyleIdx(Role role) const {
         if (role >= 0 && role < NUM_ROLES) {
-            const Deck& d = (crossfaderPosition_ < 0.5f) ? deckA_ : deckB_;
-            return d.styleIndices[role];
+            return deckStyles_[getActiveDeck()][role].load(std::memory_order_relaxed);
         }
         return 0;
     }
@@ -525,15 +948,15 @@ public:
         float djPos = applyDJCurve(crossfaderPosition_);
 
         // 取得各 Deck 主要風格的 swing（使用 Foundation 的風格作為代表）
-        float swingA = STYLES[deckA_.styleIndices[FOUNDATION]]->swing;
-        float swingB = STYLES[deckB_.styleIndices[FOUNDATION]]->swing;
+        float swingA = getStyleSwing(deckStyles_[0][FOUNDATION].load(std::memory_order_relaxed));
+        float swingB = getStyleSwing(deckStyles_[1][FOUNDATION].load(std::memory_order_relaxed));
 
         return swingA * (1.0f - djPos) + swingB * djPos;
     }
 
     // 取得當前作用中 Deck 的風格名稱
     const char* getStyleName() const {
-        return getDeckStyleName((crossfaderPosition_ < 0.5f) ? 0 : 1);
+        return getDeckStyleName(getActiveDeck());
     }
 
     // Density 控制
@@ -555,26 +978,26 @@ public:
      * 生成到 Deck A 並設定 crossfader 為 0
      */
     void regenerate(int length = 16, float variation = 0.5f) {
-        patternLength_ = length;
+        patternLength_ = Pattern::clampLength(length);
 
         // 使用當前風格設定
         int styles[NUM_ROLES];
         for (int i = 0; i < NUM_ROLES; i++) {
-            styles[i] = deckA_.styleIndices[i];
+            styles[i] = deckA_->styleIndices[i];
         }
 
         // 生成到 Deck A
         loadToDeck(0, styles, variation);
 
         // 確保 crossfader 在 A
-        crossfaderPosition_ = 0.0f;
+        setCrossfader(0.0f);
     }
 
     /**
      * 初始化兩個 Deck（首次啟動時使用）
      */
     void initializeDecks(int length, float variationA, float variationB) {
-        patternLength_ = length;
+        patternLength_ = Pattern::clampLength(length);
 
         // Deck A 使用預設 Techno
         int defaultStyle[NUM_ROLES] = {0, 0, 0, 0};
@@ -583,15 +1006,15 @@ public:
         // Deck B 也初始化（使用不同 variation）
         loadToDeck(1, defaultStyle, variationB);
 
-        crossfaderPosition_ = 0.0f;
+        setCrossfader(0.0f);
     }
 
     // 相容舊介面：取得當前作用中 deck 的 patterns
     const MultiVoicePatterns& patterns() const {
-        return (crossfaderPosition_ < 0.5f) ? deckA_.patterns : deckB_.patterns;
+        return (crossfaderPosition_ < 0.5f) ? deckA_->patterns : deckB_->patterns;
     }
     MultiVoicePatterns& patterns() {
-        return (crossfaderPosition_ < 0.5f) ? deckA_.patterns : deckB_.patterns;
+        return (crossfaderPosition_ < 0.5f) ? deckA_->patterns : deckB_->patterns;
     }
 
     const Pattern& getPattern(int voiceIdx) const {
@@ -599,26 +1022,37 @@ public:
     }
 
     float getVariation() const {
-        return (crossfaderPosition_ < 0.5f) ? deckA_.variation : deckB_.variation;
+        return (crossfaderPosition_ < 0.5f) ? deckA_->variation : deckB_->variation;
     }
 
     // 取得混合後的 SynthModifiers（用於音色控制）
     const SynthModifiers& getSynthModifiers() const {
         // 注意：這是靜態相容介面，實際應使用 getMixedSynthModifiers()
-        return (crossfaderPosition_ < 0.5f) ? deckA_.synthMods : deckB_.synthMods;
+        return (crossfaderPosition_ < 0.5f) ? deckA_->synthMods : deckB_->synthMods;
     }
 
     // Fill 系統
-    void setFillInterval(int bars) { fillSettings_.interval = std::max(1, bars); }
-    int getFillInterval() const { return fillSettings_.interval; }
+    void setFillInterval(int bars) {
+        fillSettings_.interval = std::max(1, bars);
+        fillIntervalMirror_.store(fillSettings_.interval, std::memory_order_relaxed);
+    }
+    int getFillInterval() const { return fillIntervalMirror_.load(std::memory_order_relaxed); }
 
+    // 只從兩個 Deck 的 fillBank 選出對應等級（Build-up 每秒呼叫數十次，不生成、不重新隨機）
     void setFillIntensity(float intensity) {
         fillSettings_.intensity = std::clamp(intensity, 0.0f, 1.0f);
-        // 重新生成 Fill patterns 以套用新的 intensity 設定
-        generateDeckFillPattern(deckA_, patternLength_, deckA_.variation);
-        generateDeckFillPattern(deckB_, patternLength_, deckB_.variation);
+        fillIntensityMirror_.store(fillSettings_.intensity, std::memory_order_relaxed);
+        deckA_->selectFill(fillSettings_.intensity, fillCrossfade_);
+        deckB_->selectFill(fillSettings_.intensity, fillCrossfade_);
     }
-    float getFillIntensity() const { return fillSettings_.intensity; }
+    float getFillIntensity() const { return fillIntensityMirror_.load(std::memory_order_relaxed); }
+
+    // 相鄰 intensity 等級之間是否內插（false = 取最接近的等級）
+    void setFillCrossfade(bool enabled) {
+        fillCrossfade_ = enabled;
+        setFillIntensity(fillSettings_.intensity);
+    }
+    bool getFillCrossfade() const { return fillCrossfade_; }
 
     const FillSettings& getFillSettings() const { return fillSettings_; }
 
@@ -644,7 +1078,7 @@ public:
     // 取得當前作用中的 pattern（考慮 Fill）
     // voiceIdx: 0-7（Pattern voice 索引）
     const Pattern& getActivePattern(int voiceIdx) const {
-        const Deck& d = (crossfaderPosition_ < 0.5f) ? deckA_ : deckB_;
+        const Deck& d = (crossfaderPosition_ < 0.5f) ? *deckA_ : *deckB_;
         if (fillActive_ && voiceIdx >= 0 && voiceIdx < NUM_PATTERN_VOICES) {
             return d.fillPatterns.getPattern(voiceIdx);
         }
@@ -673,10 +1107,15 @@ public:
      * @param position 0.0 = 全 Deck A，1.0 = 全 Deck B
      */
     void setCrossfader(float position) {
+        const int previousDeck = getActiveDeck();
         crossfaderPosition_ = std::clamp(position, 0.0f, 1.0f);
+        crossfaderMirror_.store(crossfaderPosition_, std::memory_order_relaxed);
+        if (getActiveDeck() != previousDeck) {
+            StyleWeights::setCompositeStyle(getDeck(getActiveDeck()).styleIndices);
+        }
     }
 
-    float getCrossfader() const { return crossfaderPosition_; }
+    float getCrossfader() const { return crossfaderMirror_.load(std::memory_order_relaxed); }
 
     /**
      * 載入歌曲到指定 Deck
@@ -693,9 +1132,31 @@ public:
         }
 
         // 生成 patterns
-        generateDeckPatterns(d, patternLength_, variation);
+        generateDeck(deck, variation);
     }
 
+    /**
+     * 安裝背景建好的 Deck（音訊執行緒；只交換指標，不配置也不釋放記憶體）
+     * @param incoming 新 Deck（所有權轉移）
+     * @return 被換下的 Deck，呼叫端負責在音訊執行緒外釋放
+     */
+    Deck* installDeck(int deck, Deck* incoming) {
+        std::unique_ptr<Deck>& slot = (deck == 0) ? deckA_ : deckB_;
+        Deck* previous = slot.release();
+        slot.reset(incoming);
+        incoming->selectFill(fillSettings_.intensity, fillCrossfade_);
+
+        // 預載到非作用中 Deck 不影響正在播放的風格
+        if (deck == getActiveDeck()) {
+            StyleWeights::setCompositeStyle(incoming->styleIndices);
+            currentStyleIdx_ = incoming->styleIndices[0];
+        }
+        syncStyleMirror(deck);
+        return previous;
+    }
+
+    int getPatternLength() const { return patternLength_; }
+
     /**
      * 載入下一首歌到非作用中的 Deck
      * 自動決定目標 Deck（根據 crossfader 位置）
@@ -712,18 +1173,19 @@ public:
      * 取得當前作用中 Deck（根據 crossfader 位置）
      */
     int getActiveDeck() const {
-        return (crossfaderPosition_ < 0.5f) ? 0 : 1;
+        return (getCrossfader() < 0.5f) ? 0 : 1;
     }
 
     /**
      * 取得指定 Deck 的風格名稱
      */
     const char* getDeckStyleName(int deck) const {
-        const Deck& d = getDeck(deck);
+        deck = (deck == 0) ? 0 : 1;
         // 檢查是否為複合風格
+        int first = deckStyles_[deck][0].load(std::memory_order_relaxed);
         bool isComposite = false;
         for (int i = 1; i < NUM_ROLES; i++) {
-            if (d.styleIndices[i] != d.styleIndices[0]) {
+            if (deckStyles_[deck][i].load(std::memory_order_relaxed) != first) {
                 isComposite = true;
                 break;
             }
@@ -731,16 +1193,15 @@ public:
         if (isComposite) {
             return "Mixed";
         }
-        return TechnoMachine::getStyleName(d.styleIndices[0]);
+        return TechnoMachine::getStyleName(first);
     }
 
     /**
      * 取得指定 Deck 的特定角色風格名稱
      */
     const char* getDeckRoleStyleName(int deck, Role role) const {
-        const Deck& d = getDeck(deck);
         if (role >= 0 && role < NUM_ROLES) {
-            return TechnoMachine::getStyleName(d.styleIndices[role]);
+            return TechnoMachine::getStyleName(getDeckRoleStyleIdx(deck, role));
         }
         return "Unknown";
     }
@@ -749,13 +1210,19 @@ public:
      * 取得指定 Deck 的特定角色風格索引
      */
     int getDeckRoleStyleIdx(int deck, Role role) const {
-        const Deck& d = getDeck(deck);
         if (role >= 0 && role < NUM_ROLES) {
-            return d.styleIndices[role];
+            return deckStyles_[(deck == 0) ? 0 : 1][role].load(std::memory_order_relaxed);
         }
         return 0;
     }
 
+    /**
+     * 取得指定 Deck 的 variation（任何執行緒）
+     */
+    float getDeckVariation(int deck) const {
+        return deckVariations_[(deck == 0) ? 0 : 1].load(std::memory_order_relaxed);
+    }
+
     /**
      * 取得混合後的音色預設
      * 根據 crossfader 位置平滑混合 Deck A 和 B 的風格預設
@@ -769,17 +1236,15 @@ public:
             // v 直接對應 Role（NUM_VOICES = 4 = NUM_ROLES）
             int role = v;
 
-            // 取得各 Deck 對應角色的風格預設
-            int styleA = deckA_.styleIndices[role];
-            int styleB = deckB_.styleIndices[role];
-            const VoicePreset& presetA = STYLE_PRESETS[styleA][v];
-            const VoicePreset& presetB = STYLE_PRESETS[styleB][v];
+            // 取得各 Deck 對應角色的風格預設（訓練風格使用最接近的內建風格）
+            const VoicePreset& presetA = getStylePreset(deckA_->styleIndices[role])[v];
+            const VoicePreset& presetB = getStylePreset(deckB_->styleIndices[role])[v];
 
             // 套用 Deck 的 variation 修正
-            float freqA = presetA.freq * deckA_.synthMods.freqMod[v];
-            float decayA = presetA.decay * deckA_.synthMods.decayMod[v];
-            float freqB = presetB.freq * deckB_.synthMods.freqMod[v];
-            float decayB = presetB.decay * deckB_.synthMods.decayMod[v];
+            float freqA = presetA.freq * deckA_->synthMods.freqMod[v];
+            float decayA = presetA.decay * deckA_->synthMods.decayMod[v];
+            float freqB = presetB.freq * deckB_->synthMods.freqMod[v];
+            float decayB = presetB.decay * deckB_->synthMods.decayMod[v];
 
             // 所有角色都平滑混合
             result.mode[v] = (djPos < 0.5f) ? presetA.mode : presetB.mode;
@@ -806,81 +1271,73 @@ public:
      * 整合馬可夫鏈提供有機變化
      */
     CrossfadeDecision getMixDecision(int voiceIdx, int step) {
-        CrossfadeDecision result = {false, 0.0f};
-
         float djPos = applyDJCurve(crossfaderPosition_);
         int role = voiceIdx / 2;
         float density = roleDensities_[role];
 
         // 選擇 pattern（考慮 Fill）
         const Pattern& patA = fillActive_ ?
-            deckA_.fillPatterns.getPattern(voiceIdx) :
-            deckA_.patterns.getPattern(voiceIdx);
+            deckA_->fillPatterns.getPattern(voiceIdx) :
+            deckA_->patterns.getPattern(voiceIdx);
         const Pattern& patB = fillActive_ ?
-            deckB_.fillPatterns.getPattern(voiceIdx) :
-            deckB_.patterns.getPattern(voiceIdx);
-
-        bool hasA = patA.hasOnset(step);
-        bool hasB = patB.hasOnset(step);
-
-        // 取得風格權重作為馬可夫輸入
-        const float* weightsA = StyleWeights::getWeights(static_cast<Role>(role));
-        float stepWeight = weightsA[step % 16];
+            deckB_->fillPatterns.getPattern(voiceIdx) :
+            deckB_->patterns.getPattern(voiceIdx);
 
-        // 更新馬可夫鏈參數
-        markov_.getChain(voiceIdx).setStepWeight(stepWeight, density);
-        markov_.getChain(voiceIdx).setTemperature(0.5f + density);
-
-        // 馬可夫決策
+        // 馬可夫決策（轉移表依作用中 Deck 的風格選擇）
         bool markovHit = false;
         if (markovEnabled_) {
-            markovHit = markov_.getChain(voiceIdx).step(fillActive_, fillSettings_.intensity);
+            int styleIdx = getDeck(getActiveDeck()).styleIndices[role];
+            markovHit = markov_.stepVoice(voiceIdx, step, styleIdx, density,
+                                          fillActive_, fillSettings_.intensity);
         }
 
         // 所有角色：機率混合
-        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-        float randVal = dist(rng_);
+        float randVal = rng_.nextFloat();
 
-        float weightA = 1.0f - djPos;
-        float weightB = djPos;
+        return resolveMix(patA, patB, step, djPos, randVal, markovHit, density);
+    }
 
-        // Pattern 決策
-        bool patternTrigger = false;
-        float patternVel = 0.0f;
+    /**
+     * 一次算出一步的 8 個 voice 決策與 4 個合併結果
+     * 與逐一呼叫 getMergedDecision 的規則相同，但：
+     * - DJ 曲線、pattern 集合（含 Fill）每步只取一次
+     * - 16 個亂數（8 個混音 + 8 個馬可夫）一次批次取出
+     * - 8 條馬可夫鏈一次查表推進
+     */
+    void getStepDecisions(int step, StepDecisions& out) {
+        const float djPos = applyDJCurve(crossfaderPosition_);
 
-        if (hasA && hasB) {
-            if (randVal < weightB) {
-                patternTrigger = true;
-                patternVel = patB.getVelocity(step);
-            } else {
-                patternTrigger = true;
-                patternVel = patA.getVelocity(step);
-            }
-        } else if (hasA) {
-            if (randVal < weightA) {
-                patternTrigger = true;
-                patternVel = patA.getVelocity(step);
-            }
-        } else if (hasB) {
-            if (randVal < weightB) {
-                patternTrigger = true;
-                patternVel = patB.getVelocity(step);
-            }
-        }
+        const MultiVoicePatterns& setA = fillActive_ ? deckA_->fillPatterns : deckA_->patterns;
+        const MultiVoicePatterns& setB = fillActive_ ? deckB_->fillPatterns : deckB_->patterns;
 
-        // 整合 Pattern 和馬可夫決策
-        if (patternTrigger) {
-            // Pattern 有觸發：使用 pattern
-            result.shouldTrigger = true;
-            result.velocity = patternVel;
-        } else if (markovHit && density > 0.3f) {
-            // Pattern 沒觸發但馬可夫說要打：額外觸發（需 density > 0.3）
-            result.shouldTrigger = true;
-            // 馬可夫觸發的音符稍弱
-            result.velocity = 0.4f + density * 0.3f;
+        // [0, 8) 混音、[8, 16) 馬可夫
+        float rolls[2 * NUM_PATTERN_VOICES];
+        rng_.fill(rolls, 2 * NUM_PATTERN_VOICES);
+
+        bool markovHits[NUM_PATTERN_VOICES] = {};
+        if (markovEnabled_) {
+            markov_.step(step, getDeck(getActiveDeck()).styleIndices, roleDensities_,
+                         fillActive_, fillSettings_.intensity, rolls + NUM_PATTERN_VOICES, markovHits);
         }
 
-        return result;
+        for (int role = 0; role < NUM_ROLES; role++) {
+            const float density = roleDensities_[role];
+
+            for (int k = 0; k < 2; k++) {
+                const int v = role * 2 + k;
+                out.voices[v] = resolveMix(setA.patterns[v], setB.patterns[v], step,
+                                           djPos, rolls[v], markovHits[v], density);
+            }
+
+            // Primary 優先
+            const auto& primary = out.voices[role * 2];
+            const auto& secondary = out.voices[role * 2 + 1];
+            auto& merged = out.merged[role];
+            merged.shouldTrigger = primary.shouldTrigger || secondary.shouldTrigger;
+            merged.fromPrimary = primary.shouldTrigger;
+            merged.velocity = primary.shouldTrigger ? primary.velocity
+                            : secondary.shouldTrigger ? secondary.velocity : 0.0f;
+        }
     }
 
     // 相容舊介面
@@ -892,8 +1349,7 @@ public:
     void startCrossfade(int /*durationBars*/, float newVariation) {
         // 相容舊介面：載入到另一個 deck
         int targetDeck = (crossfaderPosition_ < 0.5f) ? 1 : 0;
-        Deck& d = getDeck(targetDeck);
-        generateDeckPatterns(d, patternLength_, newVariation);
+        generateDeck(targetDeck, newVariation);
     }
 
     // 已棄用，改用 getMixDecision
@@ -937,37 +1393,34 @@ public:
     }
 
 private:
-    PatternGenerator generator_;
+    DeckGenerator deckGenerator_;
     int patternLength_ = 16;
 
     // === Deck A/B 雙軌系統 ===
-    struct Deck {
-        MultiVoicePatterns patterns{16};
-        MultiVoicePatterns fillPatterns{16};
-        SynthModifiers synthMods;
-        int styleIndices[NUM_ROLES] = {0, 0, 0, 0};
-        float variation = 0.5f;
-
-        void clear() {
-            for (int i = 0; i < NUM_PATTERN_VOICES; i++) {
-                patterns.patterns[i].clear();
-                fillPatterns.patterns[i].clear();
-            }
-        }
-    };
+    // Deck 為 heap 物件：背景建好的 Deck 以指標交換安裝（installDeck）
+    std::unique_ptr<Deck> deckA_ = std::make_unique<Deck>();
+    std::unique_ptr<Deck> deckB_ = std::make_unique<Deck>();
 
-    Deck deckA_;
-    Deck deckB_;
+    // 各 Deck 風格索引與 variation 的副本，供 UI 執行緒查詢（Deck 可能在音訊執行緒被換掉）
+    std::atomic<int> deckStyles_[2][NUM_ROLES] = {};
+    std::atomic<float> deckVariations_[2] = {};
     int activeDeck_ = 0;  // 0 = A, 1 = B（用於載入新歌時決定目標）
 
     // 手動 Crossfader（0.0 = 全 A，1.0 = 全 B）
     float crossfaderPosition_ = 0.0f;
 
     // Per-role density（0.0 - 0.9）- 全域設定
-    float roleDensities_[NUM_ROLES] = {0.4f, 0.2f, 0.5f, 0.5f};
+    float roleDensities_[NUM_ROLES] = {DEFAULT_ROLE_DENSITIES[TIMELINE], DEFAULT_ROLE_DENSITIES[FOUNDATION],
+                                       DEFAULT_ROLE_DENSITIES[GROOVE], DEFAULT_ROLE_DENSITIES[LEAD]};
 
     // Fill 狀態
     FillSettings fillSettings_;
+
+    // Crossfader 與 Fill 設定的副本，供 UI 執行緒查詢（只在音訊執行緒寫入）
+    std::atomic<float> crossfaderMirror_{0.0f};
+    std::atomic<float> fillIntensityMirror_{FillSettings().intensity};
+    std::atomic<int> fillIntervalMirror_{FillSettings().interval};
+    bool fillCrossfade_ = true;
     bool fillActive_ = false;
     int fillStepsRemaining_ = 0;
 
@@ -978,7 +1431,59 @@ private:
     MarkovEngine markov_;
     bool markovEnabled_ = true;
 
-    std::mt19937 rng_;
+    RandomStream rng_;
+
+    /**
+     * 單一 voice 的混音規則：兩個 deck 的 pattern 依 crossfader 機率選擇，否則由馬可夫補打
+     */
+    static CrossfadeDecision resolveMix(const Pattern& patA, const Pattern& patB, int step,
+                                       float djPos, float randVal, bool markovHit, float density) {
+        CrossfadeDecision result = {false, 0.0f};
+
+        bool hasA = patA.hasOnset(step);
+        bool hasB = patB.hasOnset(step);
+
+        float weightA = 1.0f - djPos;
+        float weightB = djPos;
+
+        // Pattern 決策
+        bool patternTrigger = false;
+        float patternVel = 0.0f;
+
+        if (hasA && hasB) {
+            if (randVal < weightB) {
+                patternTrigger = true;
+                patternVel = patB.getVelocity(step);
+            } else {
+                patternTrigger = true;
+                patternVel = patA.getVelocity(step);
+            }
+        } else if (hasA) {
+            if (randVal < weightA) {
+                patternTrigger = true;
+                patternVel = patA.getVelocity(step);
+            }
+        } else if (hasB) {
+            if (randVal < weightB) {
+                patternTrigger = true;
+                patternVel = patB.getVelocity(step);
+            }
+        }
+
+        // 整合 Pattern 和馬可夫決策
+        if (patternTrigger) {
+            // Pattern 有觸發：使用 pattern
+            result.shouldTrigger = true;
+            result.velocity = patternVel;
+        } else if (markovHit && density > 0.3f) {
+            // Pattern 沒觸發但馬可夫說要打：額外觸發（需 density > 0.3）
+            result.shouldTrigger = true;
+            // 馬可夫觸發的音符稍弱
+            result.velocity = 0.4f + density * 0.3f;
+        }
+
+        return result;
+    }
 
     /**
      * DJ 風格 Crossfader 曲線
@@ -1005,133 +1510,34 @@ private:
      * 取得指定 Deck 的參考
      */
     Deck& getDeck(int deck) {
-        return (deck == 0) ? deckA_ : deckB_;
+        return (deck == 0) ? *deckA_ : *deckB_;
     }
 
     const Deck& getDeck(int deck) const {
-        return (deck == 0) ? deckA_ : deckB_;
-    }
-
-    /**
-     * 內部：生成指定 Deck 的 patterns
-     */
-    void generateDeckPatterns(Deck& deck, int length, float variation) {
-        // 設定風格權重
-        StyleWeights::setCompositeStyle(deck.styleIndices);
-
-        // 生成 patterns
-        deck.patterns = generator_.generate(length, variation, roleDensities_);
-        deck.variation = variation;
-
-        // 加入 Ghost Notes
-        addGhostNotesToDeck(deck, variation);
-
-        // 生成 Synth Modifiers
-        generateDeckSynthModifiers(deck, variation);
-
-        // 生成 Fill Pattern
-        generateDeckFillPattern(deck, length, variation);
+        return (deck == 0) ? *deckA_ : *deckB_;
     }
 
     /**
-     * 為指定 Deck 加入 Ghost Notes
-     * 處理 8 個 Pattern
+     * 內部：生成指定 Deck 的 patterns（同步，用於初始化與舊介面）
      */
-    void addGhostNotesToDeck(Deck& deck, float variation) {
-        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-        std::uniform_real_distribution<float> velDist(0.25f, 0.32f);
-        float ghostProb = 0.1f + variation * 0.2f;
-
-        for (int v = 0; v < NUM_PATTERN_VOICES; v++) {
-            Pattern& p = deck.patterns.patterns[v];
-            for (int i = 0; i < p.length; i++) {
-                if (p.hasOnset(i)) continue;
-
-                int prev = (i - 1 + p.length) % p.length;
-                int next = (i + 1) % p.length;
-                bool nearHit = p.hasOnset(prev) || p.hasOnset(next);
-                bool isWeakBeat = (i % 2 == 1);
-
-                float prob = ghostProb;
-                if (nearHit) prob *= 2.0f;
-                if (isWeakBeat) prob *= 1.5f;
-
-                if (dist(rng_) < prob) {
-                    p.setOnset(i, velDist(rng_));
-                }
-            }
-        }
-    }
-
-    /**
-     * 為指定 Deck 生成 Synth Modifiers
-     */
-    void generateDeckSynthModifiers(Deck& deck, float variation) {
-        std::uniform_real_distribution<float> freqVar(-0.3f, 0.3f);
-        std::uniform_real_distribution<float> decayVar(-0.2f, 0.2f);
-
-        for (int v = 0; v < NUM_VOICES; v++) {
-            float freqBase = 1.0f + (variation - 0.5f) * 0.4f;
-            float decayBase = 1.0f + (variation - 0.5f) * 0.3f;
+    void generateDeck(int deck, float variation) {
+        Deck& d = getDeck(deck);
+        deckGenerator_.generate(d, patternLength_, variation, roleDensities_);
+        d.selectFill(fillSettings_.intensity, fillCrossfade_);
 
-            deck.synthMods.freqMod[v] = std::clamp(freqBase + freqVar(rng_) * variation, 0.5f, 2.0f);
-            deck.synthMods.decayMod[v] = std::clamp(decayBase + decayVar(rng_) * variation, 0.2f, 2.0f);
+        // 全域風格權重只跟隨作用中的 Deck
+        if (deck == getActiveDeck()) {
+            StyleWeights::setCompositeStyle(d.styleIndices);
         }
+        syncStyleMirror(deck);
     }
 
-    /**
-     * 為指定 Deck 生成 Fill Pattern
-     * 使用 FillSettings 控制複雜度與密度
-     *
-     * Complexity 決定參與的角色數量：
-     * 1 = Timeline only
-     * 2 = Timeline + Foundation
-     * 3 = Timeline + Foundation + Groove
-     * 4 = All roles
-     */
-    void generateDeckFillPattern(Deck& deck, int length, float variation) {
-        // 取得 fill 設定
-        int complexity = fillSettings_.getComplexity();     // 1-4
-        float fillDensity = fillSettings_.getDensity();     // 0.4-0.9
-        float accentProb = fillSettings_.getAccentProbability();
-
-        // 建立 fill 專用的 density 陣列
-        float fillDensities[NUM_ROLES];
-        for (int r = 0; r < NUM_ROLES; r++) {
-            // 根據 complexity 決定角色是否參與
-            // Role 順序: TIMELINE=0, FOUNDATION=1, GROOVE=2, LEAD=3
-            if (r < complexity) {
-                // 參與 fill 的角色使用較高密度
-                fillDensities[r] = fillDensity;
-            } else {
-                // 不參與的角色維持基礎節奏
-                fillDensities[r] = roleDensities_[r] * 0.3f;
-            }
-        }
-
-        // 生成 fill patterns
-        deck.fillPatterns = generator_.generate(length, variation + 0.2f, fillDensities);
-
-        // 套用 velocity 和 accent
-        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-        std::uniform_real_distribution<float> velDist(0.7f, 0.95f);
-        std::uniform_real_distribution<float> accentVelDist(0.95f, 1.0f);
-
-        for (int v = 0; v < NUM_PATTERN_VOICES; v++) {
-            int role = v / 2;
-            Pattern& fill = deck.fillPatterns.patterns[v];
-
-            for (int i = 0; i < fill.length; i++) {
-                if (fill.hasOnset(i)) {
-                    // 決定是否為 accent hit
-                    if (role < complexity && dist(rng_) < accentProb) {
-                        fill.setOnset(i, accentVelDist(rng_));
-                    } else {
-                        fill.setOnset(i, velDist(rng_));
-                    }
-                }
-            }
+    void syncStyleMirror(int deck) {
+        const Deck& d = getDeck(deck);
+        for (int i = 0; i < NUM_ROLES; i++) {
+            deckStyles_[deck][i].store(d.styleIndices[i], std::memory_order_relaxed);
         }
+        deckVariations_[deck].store(d.variation, std::memory_order_relaxed);
     }
 
 };  // class TechnoPatternEngine
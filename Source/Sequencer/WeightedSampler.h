@@ -0,0 +1,99 @@
+/**
+ * WeightedSampler.h
+ * Techno Machine - 不放回的權重抽樣
+ *
+ * Fenwick tree（binary indexed tree）保存前綴和：
+ * - build O(n)、sample O(log n)、remove O(log n)
+ * - sample(u) 回傳累積區間包含 u * total 的位置，與線性累加掃描的分佈相同
+ *   （已移除 / 權重為 0 的位置區間長度為 0，不會被抽中）
+ * - 固定容量，內嵌陣列，不配置記憶體
+ */
+
+#pragma once
+
+#include <algorithm>
+
+namespace TechnoMachine {
+
+template <int Capacity>
+class FenwickSampler {
+public:
+    /**
+     * 以 weights[0..n) 建立（負值視為 0）
+     */
+    void build(const float* weights, int n) {
+        n_ = std::clamp(n, 0, Capacity);
+
+        tree_[0] = 0.0f;
+        for (int i = 0; i < n_; i++) {
+            weights_[i] = std::max(0.0f, weights[i]);
+            tree_[i + 1] = weights_[i];
+        }
+        // O(n) 建樹：每個節點把自己加到父節點
+        for (int i = 1; i <= n_; i++) {
+            int parent = i + (i & -i);
+            if (parent <= n_) tree_[parent] += tree_[i];
+        }
+
+        topStep_ = 1;
+        while (topStep_ * 2 <= n_) topStep_ *= 2;
+    }
+
+    int size() const { return n_; }
+
+    float weight(int index) const { return weights_[index]; }
+
+    /**
+     * 剩餘總權重
+     */
+    float total() const { return prefix(n_); }
+
+    /**
+     * 以 u ∈ [0, 1) 抽樣，回傳位置；總權重為 0 或數值誤差超出範圍時回傳 -1
+     */
+    int sample(float u, float totalWeight) const {
+        float remaining = u * totalWeight;
+        int pos = 0;
+
+        // 往下走：找出最大的 pos 使 prefix(pos) <= remaining
+        for (int step = topStep_; step > 0; step >>= 1) {
+            int next = pos + step;
+            if (next <= n_ && tree_[next] <= remaining) {
+                pos = next;
+                remaining -= tree_[next];
+            }
+        }
+
+        return (pos < n_ && weights_[pos] > 0.0f) ? pos : -1;
+    }
+
+    int sample(float u) const { return sample(u, total()); }
+
+    /**
+     * 移除位置（權重歸零），之後不會再被抽中
+     */
+    void remove(int index) {
+        float w = weights_[index];
+        if (w == 0.0f) return;
+        weights_[index] = 0.0f;
+        for (int i = index + 1; i <= n_; i += i & -i) {
+            tree_[i] -= w;
+        }
+    }
+
+private:
+    float prefix(int count) const {
+        float sum = 0.0f;
+        for (int i = count; i > 0; i -= i & -i) {
+            sum += tree_[i];
+        }
+        return sum;
+    }
+
+    float tree_[Capacity + 1] = {};
+    float weights_[Capacity] = {};
+    int n_ = 0;
+    int topStep_ = 1;
+};
+
+} // namespace TechnoMachine
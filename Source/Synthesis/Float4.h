@@ -0,0 +1,102 @@
+/**
+ * Float4.h
+ * Techno Machine - 4-lane float SIMD wrapper
+ *
+ * One register = 4 synth voices (NUM_VOICES = 4)
+ * - x86/x64: SSE2
+ * - ARM (Apple Silicon): NEON
+ * - Other: TECHNO_SIMD = 0, callers use their scalar path
+ */
+
+#pragma once
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define TECHNO_SIMD 1
+    #define TECHNO_SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define TECHNO_SIMD 1
+    #define TECHNO_SIMD_NEON 1
+#else
+    #define TECHNO_SIMD 0
+#endif
+
+#if TECHNO_SIMD
+
+namespace TechnoMachine {
+
+/**
+ * 4 個 float 的向量
+ * Mask 也用 Float4 表示（每個 lane 全 1 或全 0 bits）
+ */
+struct Float4 {
+#if TECHNO_SIMD_SSE2
+    __m128 v;
+
+    static Float4 load(const float* p) { return {_mm_load_ps(p)}; }
+    static Float4 loadUnaligned(const float* p) { return {_mm_loadu_ps(p)}; }
+    static Float4 broadcast(float x) { return {_mm_set1_ps(x)}; }
+    static Float4 zero() { return {_mm_setzero_ps()}; }
+    void store(float* p) const { _mm_store_ps(p, v); }
+
+    // 4 個 lane 的總和
+    float sum() const {
+        __m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+    }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return {_mm_add_ps(a.v, b.v)}; }
+    friend Float4 operator-(Float4 a, Float4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+    friend Float4 operator*(Float4 a, Float4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+
+    // Mask 運算
+    static Float4 greaterEqual(Float4 a, Float4 b) { return {_mm_cmpge_ps(a.v, b.v)}; }
+    static Float4 lessThan(Float4 a, Float4 b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+    static Float4 bitAnd(Float4 a, Float4 b) { return {_mm_and_ps(a.v, b.v)}; }
+    static Float4 bitAndNot(Float4 mask, Float4 b) { return {_mm_andnot_ps(mask.v, b.v)}; }
+    // mask ? a : b
+    static Float4 select(Float4 mask, Float4 a, Float4 b) {
+        return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))};
+    }
+    static bool anyTrue(Float4 mask) { return _mm_movemask_ps(mask.v) != 0; }
+#elif TECHNO_SIMD_NEON
+    float32x4_t v;
+
+    static Float4 load(const float* p) { return {vld1q_f32(p)}; }
+    static Float4 loadUnaligned(const float* p) { return {vld1q_f32(p)}; }
+    static Float4 broadcast(float x) { return {vdupq_n_f32(x)}; }
+    static Float4 zero() { return {vdupq_n_f32(0.0f)}; }
+    void store(float* p) const { vst1q_f32(p, v); }
+
+    float sum() const {
+        float32x2_t pairs = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+        return vget_lane_f32(vpadd_f32(pairs, pairs), 0);
+    }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return {vaddq_f32(a.v, b.v)}; }
+    friend Float4 operator-(Float4 a, Float4 b) { return {vsubq_f32(a.v, b.v)}; }
+    friend Float4 operator*(Float4 a, Float4 b) { return {vmulq_f32(a.v, b.v)}; }
+
+    static Float4 greaterEqual(Float4 a, Float4 b) { return {vreinterpretq_f32_u32(vcgeq_f32(a.v, b.v))}; }
+    static Float4 lessThan(Float4 a, Float4 b) { return {vreinterpretq_f32_u32(vcltq_f32(a.v, b.v))}; }
+    static Float4 bitAnd(Float4 a, Float4 b) {
+        return {vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v)))};
+    }
+    static Float4 bitAndNot(Float4 mask, Float4 b) {
+        return {vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(b.v), vreinterpretq_u32_f32(mask.v)))};
+    }
+    static Float4 select(Float4 mask, Float4 a, Float4 b) {
+        return {vbslq_f32(vreinterpretq_u32_f32(mask.v), a.v, b.v)};
+    }
+    static bool anyTrue(Float4 mask) {
+        uint32x4_t u = vreinterpretq_u32_f32(mask.v);
+        uint32x2_t m = vorr_u32(vget_low_u32(u), vget_high_u32(u));
+        return (vget_lane_u32(m, 0) | vget_lane_u32(m, 1)) != 0;
+    }
+#endif
+};
+
+} // namespace TechnoMachine
+
+#endif // TECHNO_SIMD
@@ -0,0 +1,161 @@
+/**
+ * MappedSample.h
+ * Techno Machine - Zero-copy playback of float WAV files
+ *
+ * A WAV file whose data is already 32-bit float at the engine rate is played straight from a
+ * read-only memory map of the file: no decode, no private copy. The mapping is backed by the
+ * OS page cache, so several engine instances using the same kit share its pages.
+ *
+ * MappedPages touches every page on the loader thread and locks it (best effort, limited by
+ * RLIMIT_MEMLOCK / the working set quota), so the audio thread never takes a page fault.
+ * Locks are released when the mapping is unmapped. Also used for SampleCache entries.
+ *
+ * Loader thread only (file I/O).
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include "SampleEngine.h"
+
+#if JUCE_WINDOWS
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+#endif
+
+namespace TechnoMachine {
+
+namespace MappedPages {
+    static constexpr size_t TOUCH_STRIDE = 4096;   // Smallest page size on the supported platforms
+
+    /**
+     * Fault in and pin the pages of a mapped region
+     * @return true if the pages are locked (otherwise they are only prefaulted)
+     */
+    inline bool prefaultAndLock(const void* data, size_t bytes) {
+        if (data == nullptr || bytes == 0) return false;
+
+        const volatile char* p = static_cast<const volatile char*>(data);
+        char sink = 0;
+        for (size_t offset = 0; offset < bytes; offset += TOUCH_STRIDE) sink ^= p[offset];
+        sink ^= p[bytes - 1];
+        (void)sink;
+
+#if JUCE_WINDOWS
+        return VirtualLock(const_cast<void*>(data), bytes) != 0;
+#else
+        return mlock(data, bytes) == 0;
+#endif
+    }
+}
+
+namespace MappedSample {
+
+/**
+ * Location of the sample frames inside a float WAV file
+ */
+struct FloatWavLayout {
+    double sampleRate = 0.0;
+    int numChannels = 0;
+    uint64_t dataOffset = 0;
+    uint64_t numFrames = 0;
+};
+
+namespace Detail {
+    inline uint32_t readU32(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+             | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    inline uint16_t readU16(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+}
+
+/**
+ * Parse the RIFF chunks of a mapped file
+ * @return false unless it is a WAVE file with 32-bit IEEE float data (plain or extensible format)
+ */
+inline bool parseFloatWav(const uint8_t* bytes, size_t size, FloatWavLayout& layout) {
+    using namespace Detail;
+    if (bytes == nullptr || size < 12) return false;
+    if (std::memcmp(bytes, "RIFF", 4) != 0 || std::memcmp(bytes + 8, "WAVE", 4) != 0) return false;
+
+    bool hasFormat = false;
+    size_t offset = 12;
+    while (offset + 8 <= size) {
+        const uint8_t* chunk = bytes + offset;
+        const uint64_t chunkSize = readU32(chunk + 4);
+        const size_t body = offset + 8;
+
+        if (std::memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunkSize < 16 || body + 16 > size) return false;
+            uint16_t formatTag = readU16(bytes + body);
+            const uint16_t channels = readU16(bytes + body + 2);
+            const uint32_t rate = readU32(bytes + body + 4);
+            const uint16_t bits = readU16(bytes + body + 14);
+
+            // WAVE_FORMAT_EXTENSIBLE: the sub-format GUID starts with the format tag
+            if (formatTag == 0xFFFE) {
+                if (chunkSize < 40 || body + 40 > size) return false;
+                formatTag = readU16(bytes + body + 24);
+            }
+
+            if (formatTag != 3 || bits != 32 || channels == 0) return false;
+            layout.sampleRate = static_cast<double>(rate);
+            layout.numChannels = channels;
+            hasFormat = true;
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!hasFormat) return false;
+            const uint64_t available = std::min<uint64_t>(chunkSize, size - body);
+            layout.dataOffset = body;
+            layout.numFrames = available / (4u * static_cast<uint64_t>(layout.numChannels));
+            return true;
+        }
+
+        // Chunks are padded to an even size
+        offset = body + static_cast<size_t>(chunkSize + (chunkSize & 1));
+    }
+    return false;
+}
+
+/**
+ * Map a float WAV file for in-place playback
+ * @return nullptr if the file is not 32-bit float WAV at sampleRate (the caller decodes instead)
+ */
+inline std::unique_ptr<SampleData> mapFloatWav(const juce::File& file, double sampleRate) {
+    if (!file.hasFileExtension("wav;wave")) return nullptr;
+
+    auto mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    FloatWavLayout layout;
+    if (!parseFloatWav(static_cast<const uint8_t*>(mapped->getData()), mapped->getSize(), layout)) return nullptr;
+
+    // Same tolerance as SampleLoader's resampling
+    if (std::abs(layout.sampleRate - sampleRate) > 1.0) return nullptr;
+    if (layout.numFrames == 0 || layout.numFrames > static_cast<uint64_t>(std::numeric_limits<int>::max())) return nullptr;
+    if (layout.dataOffset % sizeof(float) != 0) return nullptr;   // Floats must be aligned to read in place
+
+    const float* samples = reinterpret_cast<const float*>(static_cast<const char*>(mapped->getData()) + layout.dataOffset);
+    MappedPages::prefaultAndLock(samples, layout.numFrames * static_cast<uint64_t>(layout.numChannels) * sizeof(float));
+
+    auto data = std::make_unique<SampleData>();
+    data->samples = samples;
+    data->numFrames = static_cast<int>(layout.numFrames);
+    data->stride = layout.numChannels;
+    data->mapping = std::move(mapped);
+    return data;
+}
+
+} // namespace MappedSample
+
+} // namespace TechnoMachine
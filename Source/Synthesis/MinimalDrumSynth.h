@@ -18,51 +18,86 @@
 #pragma once
 
 #include <cmath>
-#include <random>
-
-// MSVC compatibility
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
+#include <cstdint>
+#include <algorithm>
+#include "SynthTypes.h"
+#include "SimdVoiceBank.h"
+#include "NoiseSource.h"
+#include "SineOscillator.h"
 
 namespace TechnoMachine {
 
-// 合成器模式
-enum class SynthMode {
-    SINE,   // 音調類：Kick, Tom
-    NOISE   // 噪音類：Hi-Hat, Clap, Rim
-};
-
-// 四角色定義
-enum Role {
-    TIMELINE = 0,    // Hi-Hat
-    FOUNDATION = 1,  // Kick
-    GROOVE = 2,      // Clap
-    LEAD = 3,        // Perc
-    NUM_ROLES = 4
-};
-
-// Pattern 系統用（保留 8 個 pattern 的 Interlock 邏輯）
-static constexpr int NUM_PATTERN_VOICES = 8;
-
-// 合成器聲道數（每 Role 一個）
-static constexpr int NUM_VOICES = 4;
-
 /**
  * 極簡單聲道合成器
  * 修正：BPF 使用正確的 0dB peak gain 公式
+ *
+ * 控制率（control-rate）層：
+ * - decay 係數在 trigger() / setSampleRate() 計算
+ * - phase 增量與 BPF 係數在 setFreq() / setSampleRate() 計算
+ * - 發聲中改變頻率時可選擇以區塊速率平滑（setFreqSmoothing），每區塊只重算一次係數
+ * process() 內只剩乘加運算（加上 sin / 噪音）
+ * 噪音為可設定種子的 xorshift（NoiseSource），processBlock() 一次填滿整個區塊
+ * SINE 振盪器可選 std::sin / 查表 / minimax 多項式 / 遞迴正交（SineBackend，預設多項式）
+ *
+ * MinimalDrumSynth 以 SimdVoiceBank 渲染；此類別保留為單聲道 scalar 參考實作
  */
 class MinimalVoice {
 public:
     void setSampleRate(float sr) {
         sampleRate_ = sr;
-        cachedFreq_ = -1.0f;  // 強制更新 BPF 係數
+        updateSmoothingCoef();
+        updateFreqCoefficients();
+        updateDecayCoef();
     }
 
     void setMode(SynthMode m) { mode_ = m; }
-    void setFreq(float f) { freq_ = std::max(20.0f, std::min(f, 20000.0f)); }
+
+    /**
+     * 切換 SINE 振盪器實作（從目前 phase 接續，不會跳相位）
+     */
+    void setSineBackend(SineBackend b) {
+        sineBackend_ = b;
+        if (b == SineBackend::WAVETABLE) {
+            SineOscillator::SineTable::get();  // 在呼叫端執行緒建表，避免音訊執行緒首次初始化
+        } else if (b == SineBackend::QUADRATURE) {
+            quadSin_ = std::sin(2.0f * static_cast<float>(M_PI) * phase_);
+            quadCos_ = std::cos(2.0f * static_cast<float>(M_PI) * phase_);
+        }
+    }
+
+    SineBackend getSineBackend() const { return sineBackend_; }
+
+    /**
+     * 設定頻率
+     * 平滑關閉或聲道靜止時立即生效；否則在後續區塊中滑向目標
+     */
+    void setFreq(float f) {
+        targetFreq_ = std::max(20.0f, std::min(f, 20000.0f));
+        if (smoothingMs_ <= 0.0f || !isActive()) {
+            freq_ = targetFreq_;
+            updateFreqCoefficients();
+        }
+    }
+
     void setDecay(float d) { decay_ = std::max(1.0f, std::min(d, 5000.0f)); }
-    float getFreq() const { return freq_; }
+    float getFreq() const { return targetFreq_; }
+
+    /**
+     * 噪音種子（相同種子 = 可重現的輸出）
+     */
+    void setNoiseSeed(uint32_t seed) { noise_.setSeed(seed); }
+
+    /**
+     * 頻率平滑時間（ms，時間常數），0 = 關閉
+     */
+    void setFreqSmoothing(float ms) {
+        smoothingMs_ = std::max(0.0f, ms);
+        updateSmoothingCoef();
+        if (smoothingMs_ <= 0.0f && freq_ != targetFreq_) {
+            freq_ = targetFreq_;
+            updateFreqCoefficients();
+        }
+    }
 
     /**
      * 觸發音符
@@ -73,40 +108,168 @@ public:
         envValue_ = velocity_;  // 直接跳到峰值（超快攻擊）
         // 從 0.25 相位開始 = sin(π/2) = 1.0，產生瞬間 click
         phase_ = 0.25f;
+        quadSin_ = 1.0f;
+        quadCos_ = 0.0f;
         // 重置濾波器狀態
         bpfZ1_ = bpfZ2_ = 0.0f;
         // velocity 影響 decay 長度
         float velScale = 0.1f + 0.9f * std::pow(velocity_, 1.5f);
         actualDecay_ = decay_ * velScale;
+        updateDecayCoef();
+        // 新音符直接使用目標頻率
+        if (freq_ != targetFreq_) {
+            freq_ = targetFreq_;
+            updateFreqCoefficients();
+        }
     }
 
     float process() {
-        if (envValue_ < 0.0001f) return 0.0f;
+        if (envValue_ < ENV_THRESHOLD) return 0.0f;
+
+        // 逐 sample 呼叫時每 SMOOTHING_INTERVAL 個 sample 推進一次平滑
+        if (freq_ != targetFreq_ && ++smoothingCounter_ >= SMOOTHING_INTERVAL) {
+            smoothingCounter_ = 0;
+            advanceSmoothing(SMOOTHING_INTERVAL);
+        }
 
         float output = 0.0f;
 
         if (mode_ == SynthMode::SINE) {
             // === Sine 模式 ===
-            output = std::sin(2.0f * static_cast<float>(M_PI) * phase_);
-            phase_ += freq_ / sampleRate_;
-            if (phase_ >= 1.0f) phase_ -= 1.0f;
+            switch (sineBackend_) {
+                case SineBackend::WAVETABLE:  output = sineSample<SineBackend::WAVETABLE>(); break;
+                case SineBackend::POLYNOMIAL: output = sineSample<SineBackend::POLYNOMIAL>(); break;
+                case SineBackend::QUADRATURE:
+                    output = sineSample<SineBackend::QUADRATURE>();
+                    normalizeQuadrature();
+                    break;
+                default:                      output = sineSample<SineBackend::STD>(); break;
+            }
         } else {
             // === Noise + BPF 模式 ===
-            float noise = noiseDist_(rng_);
+            float noise = noise_.next();
             output = processBPF(noise);
         }
 
         // VCA 包絡（指數衰減）
-        float decaySamples = (actualDecay_ / 1000.0f) * sampleRate_;
-        float decayCoef = std::exp(-1.0f / decaySamples);
-        envValue_ *= decayCoef;
+        envValue_ *= decayCoef_;
 
         return output * envValue_;
     }
 
+    bool isActive() const { return envValue_ >= ENV_THRESHOLD; }
+
+    /**
+     * 區塊處理：與 process() 逐 sample 結果相同（平滑關閉時）
+     * 模式分支移到迴圈外，頻率平滑每區塊推進一次
+     */
+    void processBlock(float* out, int numSamples) {
+        if (freq_ != targetFreq_) {
+            advanceSmoothing(numSamples);
+        }
+
+        const float decayCoef = decayCoef_;
+
+        int i = 0;
+        if (mode_ == SynthMode::SINE) {
+            // backend 分支在區塊層級
+            switch (sineBackend_) {
+                case SineBackend::WAVETABLE:  i = renderSine<SineBackend::WAVETABLE>(out, numSamples, decayCoef); break;
+                case SineBackend::POLYNOMIAL: i = renderSine<SineBackend::POLYNOMIAL>(out, numSamples, decayCoef); break;
+                case SineBackend::QUADRATURE: i = renderSine<SineBackend::QUADRATURE>(out, numSamples, decayCoef); break;
+                default:                      i = renderSine<SineBackend::STD>(out, numSamples, decayCoef); break;
+            }
+        } else {
+            // 先把整個區塊填成噪音，再原地濾波
+            if (envValue_ >= ENV_THRESHOLD) {
+                noise_.fill(out, numSamples);
+            }
+            for (; i < numSamples && envValue_ >= ENV_THRESHOLD; i++) {
+                out[i] = processBPF(out[i]) * (envValue_ *= decayCoef);
+            }
+        }
+
+        // 包絡結束後補零
+        for (; i < numSamples; i++) {
+            out[i] = 0.0f;
+        }
+    }
+
 private:
-    void updateBPFCoefficients() {
-        if (std::abs(freq_ - cachedFreq_) < 0.01f && std::abs(sampleRate_ - cachedSampleRate_) < 0.01f) return;
+    /**
+     * 輸出 sin(2π·phase_) 並推進相位
+     * QUADRATURE 以 (sin, cos) 每 sample 旋轉一次；振幅校正由呼叫端執行（normalizeQuadrature）
+     */
+    template <SineBackend Backend>
+    float sineSample() {
+        float output;
+        if (Backend == SineBackend::QUADRATURE) {
+            output = quadSin_;
+            float s = quadSin_ * rotCos_ + quadCos_ * rotSin_;
+            quadCos_ = quadCos_ * rotCos_ - quadSin_ * rotSin_;
+            quadSin_ = s;
+        } else if (Backend == SineBackend::WAVETABLE) {
+            output = SineOscillator::sinTable(phase_);
+        } else if (Backend == SineBackend::POLYNOMIAL) {
+            output = SineOscillator::sinPoly(phase_);
+        } else {
+            output = std::sin(2.0f * static_cast<float>(M_PI) * phase_);
+        }
+        phase_ += phaseInc_;
+        if (phase_ >= 1.0f) phase_ -= 1.0f;
+        return output;
+    }
+
+    template <SineBackend Backend>
+    int renderSine(float* out, int numSamples, float decayCoef) {
+        int i = 0;
+        for (; i < numSamples && envValue_ >= ENV_THRESHOLD; i++) {
+            float output = sineSample<Backend>();
+            envValue_ *= decayCoef;
+            out[i] = output * envValue_;
+        }
+        if (Backend == SineBackend::QUADRATURE) normalizeQuadrature();
+        return i;
+    }
+
+    /**
+     * 一階振幅校正：把 (sin, cos) 拉回單位圓，每區塊一次即可抑制捨入漂移
+     */
+    void normalizeQuadrature() {
+        float gain = 1.5f - 0.5f * (quadSin_ * quadSin_ + quadCos_ * quadCos_);
+        quadSin_ *= gain;
+        quadCos_ *= gain;
+    }
+
+    void updateDecayCoef() {
+        float decaySamples = (actualDecay_ / 1000.0f) * sampleRate_;
+        decayCoef_ = std::exp(-1.0f / decaySamples);
+    }
+
+    void updateSmoothingCoef() {
+        if (smoothingMs_ <= 0.0f) {
+            smoothingCoef_ = 0.0f;
+            return;
+        }
+        float smoothingSamples = (smoothingMs_ / 1000.0f) * sampleRate_;
+        smoothingCoef_ = -1.0f / smoothingSamples;
+    }
+
+    /**
+     * 一階平滑 freq_ → targetFreq_，推進 numSamples 個 sample
+     * 每次呼叫只重算一次係數
+     */
+    void advanceSmoothing(int numSamples) {
+        float keep = std::exp(smoothingCoef_ * static_cast<float>(numSamples));
+        freq_ = targetFreq_ + (freq_ - targetFreq_) * keep;
+        if (std::abs(freq_ - targetFreq_) < 0.01f) freq_ = targetFreq_;
+        updateFreqCoefficients();
+    }
+
+    void updateFreqCoefficients() {
+        phaseInc_ = freq_ / sampleRate_;
+        rotCos_ = std::cos(2.0f * static_cast<float>(M_PI) * phaseInc_);
+        rotSin_ = std::sin(2.0f * static_cast<float>(M_PI) * phaseInc_);
 
         float omega = 2.0f * static_cast<float>(M_PI) * freq_ / sampleRate_;
         float sinOmega = std::sin(omega);
@@ -116,23 +279,16 @@ private:
         float a0 = 1.0f + alpha;
 
         // 修正：使用 constant 0dB peak gain BPF 公式
-        // b0 = Q * alpha = sin(omega) / 2
+        // b0 = Q * alpha = sin(omega) / 2，b1 = 0，b2 = -b0
         // 這確保中心頻率增益為 0dB
         bpf_b0_ = (sinOmega / 2.0f) / a0;
-        bpf_b1_ = 0.0f;
-        bpf_b2_ = -(sinOmega / 2.0f) / a0;
         bpf_a1_ = (-2.0f * cosOmega) / a0;
         bpf_a2_ = (1.0f - alpha) / a0;
-
-        cachedFreq_ = freq_;
-        cachedSampleRate_ = sampleRate_;
     }
 
     float processBPF(float input) {
-        updateBPFCoefficients();
-
         float w = input - bpf_a1_ * bpfZ1_ - bpf_a2_ * bpfZ2_;
-        float output = bpf_b0_ * w + bpf_b1_ * bpfZ1_ + bpf_b2_ * bpfZ2_;
+        float output = bpf_b0_ * (w - bpfZ2_);
 
         bpfZ2_ = bpfZ1_;
         bpfZ1_ = w;
@@ -140,6 +296,9 @@ private:
         return output;
     }
 
+    static constexpr float ENV_THRESHOLD = 0.0001f;
+    static constexpr int SMOOTHING_INTERVAL = 32;
+
     // 狀態
     float sampleRate_ = 48000.0f;
     float phase_ = 0.0f;
@@ -149,19 +308,30 @@ private:
 
     // 參數
     SynthMode mode_ = SynthMode::SINE;
-    float freq_ = 100.0f;
+    SineBackend sineBackend_ = SineBackend::POLYNOMIAL;
+    float freq_ = 100.0f;        // 目前（平滑中）頻率
+    float targetFreq_ = 100.0f;
     float decay_ = 200.0f;
 
+    // 控制率係數
+    float phaseInc_ = 100.0f / 48000.0f;
+    float decayCoef_ = 0.0f;
+    float smoothingMs_ = 0.0f;
+    float smoothingCoef_ = 0.0f;
+    int smoothingCounter_ = 0;
+
+    // 正交振盪器狀態與每 sample 旋轉量
+    float quadSin_ = 0.0f, quadCos_ = 1.0f;
+    float rotCos_ = 1.0f, rotSin_ = 0.0f;
+
     // BPF 狀態
     float bpfZ1_ = 0.0f, bpfZ2_ = 0.0f;
-    float cachedFreq_ = -1.0f, cachedSampleRate_ = -1.0f;
-    float bpf_b0_ = 0.0f, bpf_b1_ = 0.0f, bpf_b2_ = 0.0f;
+    float bpf_b0_ = 0.0f;
     float bpf_a1_ = 0.0f, bpf_a2_ = 0.0f;
     static constexpr float BPF_Q = 2.0f;
 
-    // 噪音生成器
-    std::mt19937 rng_{std::random_device{}()};
-    std::uniform_real_distribution<float> noiseDist_{-1.0f, 1.0f};
+    // 噪音生成器（4 bytes 狀態）
+    NoiseSource noise_;
 };
 
 /**
@@ -185,10 +355,13 @@ inline const VoicePreset TECHNO_PRESETS[NUM_VOICES] = {
 };
 
 /**
- * 10 種風格的音色預設
+ * 10 種內建風格的音色預設
  * 每種風格 4 個音色（每 Role 一個）
+ * 以 getStylePreset() 讀取（StyleProfiles.hpp；訓練風格對應到最接近的內建風格）
  */
-inline const VoicePreset STYLE_PRESETS[10][NUM_VOICES] = {
+static constexpr int NUM_STYLE_PRESETS = 10;
+
+inline const VoicePreset STYLE_PRESETS[NUM_STYLE_PRESETS][NUM_VOICES] = {
     // 0: TECHNO - 經典 909 電子音色
     {
         { SynthMode::NOISE, 10000.0f, 20.0f },   // TIMELINE: HiHat
@@ -261,14 +434,6 @@ inline const VoicePreset STYLE_PRESETS[10][NUM_VOICES] = {
     }
 };
 
-/**
- * 取得指定風格的音色預設
- */
-inline const VoicePreset* getStylePreset(int styleIdx) {
-    if (styleIdx < 0 || styleIdx >= 10) styleIdx = 0;
-    return STYLE_PRESETS[styleIdx];
-}
-
 /**
  * 4 聲道打擊樂合成器（每 Role 一個聲道）
  */
@@ -276,19 +441,40 @@ class MinimalDrumSynth {
 public:
     void setSampleRate(float sr) {
         sampleRate_ = sr;
-        for (int i = 0; i < NUM_VOICES; i++) {
-            voices_[i].setSampleRate(sr);
-        }
+        bank_.setSampleRate(sr);
+    }
+
+    /**
+     * 發聲中改變頻率時的平滑時間（ms），0 = 立即跳變
+     */
+    void setFreqSmoothing(float ms) {
+        bank_.setFreqSmoothing(ms);
+    }
+
+    /**
+     * 噪音種子（4 個聲道由此衍生，相同種子 = 可重現的輸出）
+     */
+    void setNoiseSeed(uint32_t seed) {
+        bank_.setNoiseSeed(seed);
     }
 
+    /**
+     * SINE 振盪器實作（4 個聲道共用，見 SineBackend）
+     */
+    void setSineBackend(SineBackend b) {
+        bank_.setSineBackend(b);
+    }
+
+    SineBackend getSineBackend() const { return bank_.getSineBackend(); }
+
     /**
      * 套用 Techno 預設音色
      */
     void applyTechnoPreset() {
         for (int i = 0; i < NUM_VOICES; i++) {
-            voices_[i].setMode(TECHNO_PRESETS[i].mode);
-            voices_[i].setFreq(TECHNO_PRESETS[i].freq);
-            voices_[i].setDecay(TECHNO_PRESETS[i].decay);
+            bank_.setMode(i, TECHNO_PRESETS[i].mode);
+            bank_.setFreq(i, TECHNO_PRESETS[i].freq);
+            bank_.setDecay(i, TECHNO_PRESETS[i].decay);
         }
     }
 
@@ -298,9 +484,9 @@ public:
      */
     void setVoiceParams(int voiceIdx, SynthMode mode, float freq, float decay) {
         if (voiceIdx < 0 || voiceIdx >= NUM_VOICES) return;
-        voices_[voiceIdx].setMode(mode);
-        voices_[voiceIdx].setFreq(freq);
-        voices_[voiceIdx].setDecay(decay);
+        bank_.setMode(voiceIdx, mode);
+        bank_.setFreq(voiceIdx, freq);
+        bank_.setDecay(voiceIdx, decay);
     }
 
     /**
@@ -310,7 +496,7 @@ public:
      */
     void triggerRole(Role role, float velocity) {
         if (role < 0 || role >= NUM_ROLES) return;
-        if (velocity > 0.0f) voices_[role].trigger(velocity);
+        if (velocity > 0.0f) bank_.trigger(role, velocity);
     }
 
     /**
@@ -319,7 +505,7 @@ public:
      */
     void triggerVoice(int voiceIdx, float velocity = 1.0f) {
         if (voiceIdx < 0 || voiceIdx >= NUM_VOICES) return;
-        voices_[voiceIdx].trigger(velocity);
+        bank_.trigger(voiceIdx, velocity);
     }
 
     /**
@@ -327,7 +513,7 @@ public:
      */
     float getVoiceFrequency(int voiceIdx) const {
         if (voiceIdx < 0 || voiceIdx >= NUM_VOICES) return 440.0f;
-        return voices_[voiceIdx].getFreq();
+        return bank_.getFreq(voiceIdx);
     }
 
     /**
@@ -349,13 +535,15 @@ public:
     StereoOutput process() {
         float mixL = 0.0f, mixR = 0.0f;
 
+        float signals[NUM_VOICES];
+        bank_.processSample(signals);
+
         for (int r = 0; r < NUM_ROLES; r++) {
-            float signal = voices_[r].process();
             float pan = rolePan_[r];
 
             // Panning
-            mixL += signal * levels_[r] * (0.5f - pan * 0.5f) * 1.414f;
-            mixR += signal * levels_[r] * (0.5f + pan * 0.5f) * 1.414f;
+            mixL += signals[r] * levels_[r] * (0.5f - pan * 0.5f) * 1.414f;
+            mixR += signals[r] * levels_[r] * (0.5f + pan * 0.5f) * 1.414f;
         }
 
         // 軟限幅
@@ -365,17 +553,59 @@ public:
         };
     }
 
+    /**
+     * 區塊處理：輸出立體聲混音（覆寫 left/right）
+     * 4 聲道由 SimdVoiceBank 一次渲染，再套用 pan/level 與軟限幅
+     */
+    void processBlock(float* left, float* right, int numSamples) {
+        alignas(16) float frames[MAX_BLOCK_CHUNK * NUM_VOICES];
+
+        float gainL[NUM_VOICES], gainR[NUM_VOICES];
+        for (int r = 0; r < NUM_ROLES; r++) {
+            float pan = rolePan_[r];
+            gainL[r] = levels_[r] * (0.5f - pan * 0.5f) * 1.414f;
+            gainR[r] = levels_[r] * (0.5f + pan * 0.5f) * 1.414f;
+        }
+
+        for (int start = 0; start < numSamples; start += MAX_BLOCK_CHUNK) {
+            int n = std::min(MAX_BLOCK_CHUNK, numSamples - start);
+            float* outL = left + start;
+            float* outR = right + start;
+
+            if (!bank_.anyActive()) {
+                std::fill(outL, outL + n, 0.0f);
+                std::fill(outR, outR + n, 0.0f);
+                continue;
+            }
+
+            bank_.processBlock(frames, n);
+
+            for (int i = 0; i < n; i++) {
+                const float* f = frames + i * NUM_VOICES;
+                float mixL = f[0] * gainL[0] + f[1] * gainL[1] + f[2] * gainL[2] + f[3] * gainL[3];
+                float mixR = f[0] * gainR[0] + f[1] * gainR[1] + f[2] * gainR[2] + f[3] * gainR[3];
+
+                // 軟限幅
+                outL[i] = std::tanh(mixL * 0.7f);
+                outR[i] = std::tanh(mixR * 0.7f);
+            }
+        }
+    }
+
     /**
      * 處理並輸出 4 個獨立聲道
      */
     void processSeparate(float* outputs) {
+        bank_.processSample(outputs);
         for (int r = 0; r < NUM_ROLES; r++) {
-            outputs[r] = voices_[r].process() * levels_[r];
+            outputs[r] *= levels_[r];
         }
     }
 
 private:
-    MinimalVoice voices_[NUM_VOICES];
+    static constexpr int MAX_BLOCK_CHUNK = SimdVoiceBank::MAX_BLOCK;
+
+    SimdVoiceBank bank_;
     float sampleRate_ = 48000.0f;
 
     // 音量（per Role）
@@ -0,0 +1,144 @@
+/**
+ * NoiseSource.h
+ * Techno Machine - 可設定種子的快速白噪音
+ *
+ * 取代每聲道 std::mt19937 + uniform_real_distribution（約 5 KB 狀態）：
+ * - xorshift32，每條串流 4 bytes 狀態
+ * - 輸出 [-1, 1) 的均勻噪音：取高 23 bits 放進 float mantissa（[2, 4) - 3），無除法
+ * - NoiseSource 為單聲道（MinimalVoice），NoiseSource4 在一個 SSE/NEON 暫存器內跑 4 條串流
+ * - 同一個種子在兩者中產生完全相同的序列
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "Float4.h"
+
+namespace TechnoMachine {
+
+namespace NoiseDetail {
+    /**
+     * SplitMix32 風格的種子擴散，保證 xorshift 狀態不為 0
+     */
+    inline uint32_t scrambleSeed(uint32_t seed) {
+        uint32_t z = seed + 0x9E3779B9u;
+        z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+        z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+        z ^= z >> 16;
+        return z != 0 ? z : 0x6D2B79F5u;
+    }
+
+    inline uint32_t next(uint32_t& s) {
+        s ^= s << 13;
+        s ^= s >> 17;
+        s ^= s << 5;
+        return s;
+    }
+
+    inline float toBipolar(uint32_t x) {
+        uint32_t bits = (x >> 9) | 0x40000000u;  // [2, 4)
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f - 3.0f;
+    }
+}
+
+/**
+ * 單串流噪音
+ */
+class NoiseSource {
+public:
+    explicit NoiseSource(uint32_t seed = 0) { setSeed(seed); }
+
+    void setSeed(uint32_t seed) { state_ = NoiseDetail::scrambleSeed(seed); }
+
+    float next() { return NoiseDetail::toBipolar(NoiseDetail::next(state_)); }
+
+    void fill(float* out, int numSamples) {
+        uint32_t s = state_;
+        for (int i = 0; i < numSamples; i++) {
+            out[i] = NoiseDetail::toBipolar(NoiseDetail::next(s));
+        }
+        state_ = s;
+    }
+
+private:
+    uint32_t state_ = 1;
+};
+
+/**
+ * 4 條獨立串流（每條對應一個聲道），一次推進一個暫存器
+ */
+class NoiseSource4 {
+public:
+    static constexpr int LANES = 4;
+
+    NoiseSource4() {
+        for (int l = 0; l < LANES; l++) setSeed(l, static_cast<uint32_t>(l));
+    }
+
+    void setSeed(int lane, uint32_t seed) { state_[lane] = NoiseDetail::scrambleSeed(seed); }
+
+    float next(int lane) { return NoiseDetail::toBipolar(NoiseDetail::next(state_[lane])); }
+
+    /**
+     * 填入 interleaved 噪音（out[i * LANES + lane]）
+     * enabled[lane] 為 false 的串流不推進，輸出 0
+     */
+    void fillInterleaved(float* out, int numSamples, const bool* enabled) {
+#if TECHNO_SIMD_SSE2
+        __m128i s = _mm_load_si128(reinterpret_cast<const __m128i*>(state_));
+        const __m128i mask = _mm_set_epi32(enabled[3] ? -1 : 0, enabled[2] ? -1 : 0,
+                                           enabled[1] ? -1 : 0, enabled[0] ? -1 : 0);
+        const __m128i exponent = _mm_set1_epi32(0x40000000);
+        const __m128 three = _mm_set1_ps(3.0f);
+        const __m128 maskPs = _mm_castsi128_ps(mask);
+
+        for (int i = 0; i < numSamples; i++) {
+            __m128i x = _mm_xor_si128(s, _mm_slli_epi32(s, 13));
+            x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+            x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+            s = _mm_or_si128(_mm_and_si128(mask, x), _mm_andnot_si128(mask, s));
+
+            __m128 f = _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(x, 9), exponent)), three);
+            _mm_store_ps(out + i * LANES, _mm_and_ps(maskPs, f));
+        }
+
+        _mm_store_si128(reinterpret_cast<__m128i*>(state_), s);
+#elif TECHNO_SIMD_NEON
+        uint32x4_t s = vld1q_u32(state_);
+        const uint32_t maskBits[LANES] = {
+            enabled[0] ? 0xFFFFFFFFu : 0u, enabled[1] ? 0xFFFFFFFFu : 0u,
+            enabled[2] ? 0xFFFFFFFFu : 0u, enabled[3] ? 0xFFFFFFFFu : 0u
+        };
+        const uint32x4_t mask = vld1q_u32(maskBits);
+        const uint32x4_t exponent = vdupq_n_u32(0x40000000u);
+        const float32x4_t three = vdupq_n_f32(3.0f);
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+
+        for (int i = 0; i < numSamples; i++) {
+            uint32x4_t x = veorq_u32(s, vshlq_n_u32(s, 13));
+            x = veorq_u32(x, vshrq_n_u32(x, 17));
+            x = veorq_u32(x, vshlq_n_u32(x, 5));
+            s = vbslq_u32(mask, x, s);
+
+            float32x4_t f = vsubq_f32(vreinterpretq_f32_u32(vorrq_u32(vshrq_n_u32(x, 9), exponent)), three);
+            vst1q_f32(out + i * LANES, vbslq_f32(mask, f, zero));
+        }
+
+        vst1q_u32(state_, s);
+#else
+        for (int l = 0; l < LANES; l++) {
+            for (int i = 0; i < numSamples; i++) {
+                out[i * LANES + l] = enabled[l] ? next(l) : 0.0f;
+            }
+        }
+#endif
+    }
+
+private:
+    alignas(16) uint32_t state_[LANES] = {1, 1, 1, 1};
+};
+
+} // namespace TechnoMachine
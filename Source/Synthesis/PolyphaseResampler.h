@@ -0,0 +1,216 @@
+/**
+ * PolyphaseResampler.h
+ * Techno Machine - Windowed-sinc sample rate conversion for sample import
+ *
+ * Offline (loader thread) converter for arbitrary rate ratios:
+ * - Kaiser-windowed sinc, TAPS taps per phase at unity ratio; when downsampling the kernel is
+ *   stretched by 1 / ratio and its cutoff lowered, so content above the new Nyquist is removed
+ * - The kernel is tabulated at PHASES fractional offsets (+1 guard row); an output sample
+ *   blends the dot products of the two nearest phases
+ * - Each phase row is padded to a multiple of 4 taps and 16-byte aligned, so the inner loop
+ *   runs on Float4 (SSE2 / NEON) with a scalar fallback
+ *
+ * process() converts a whole buffer; processRange() renders any span of the output from the
+ * matching span of input (getInputRange), so a file can be converted block by block while
+ * streaming without keeping filter state.
+ *
+ * Not for the audio thread: construction and process() allocate.
+ * JUCE-free so it can be used from tools.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Float4.h"
+
+namespace TechnoMachine {
+
+class PolyphaseResampler {
+public:
+    static constexpr int TAPS = 64;             // Kernel length at ratio >= 1
+    static constexpr int PHASES = 256;          // Fractional offsets per input sample
+    static constexpr double BETA = 9.0;         // Kaiser window (~90 dB stopband)
+    static constexpr double PASSBAND = 0.92;    // Cutoff relative to the lower Nyquist
+
+    PolyphaseResampler(double inputRate, double outputRate)
+        : step_(inputRate / outputRate) {
+        const double ratio = outputRate / inputRate;
+        const double cutoff = PASSBAND * std::min(1.0, ratio);
+
+        // Wider kernel when downsampling keeps the transition band the same in output terms
+        const int taps = static_cast<int>(std::ceil(TAPS / std::min(1.0, ratio)));
+        stride_ = (taps + 3) & ~3;
+        half_ = stride_ / 2;
+
+        table_.assign(static_cast<size_t>(PHASES + 1) * stride_ + ALIGN_PADDING, 0.0f);
+        buildTable(cutoff);
+    }
+
+    /**
+     * Output length for an input of numInput samples
+     */
+    int64_t getOutputLength(int64_t numInput) const {
+        return static_cast<int64_t>(std::ceil(static_cast<double>(numInput) / step_));
+    }
+
+    /**
+     * Convert input (numInput samples) into output (getOutputLength(numInput) samples)
+     * Samples outside the input are treated as silence.
+     */
+    void process(const float* input, int numInput, float* output) const {
+        // Zero-padded copy so every kernel window is in range
+        std::vector<float> padded(static_cast<size_t>(numInput) + 2 * static_cast<size_t>(stride_) + 4, 0.0f);
+        std::copy(input, input + numInput, padded.begin() + stride_);
+
+        processRange(padded.data(), -stride_, 0, static_cast<int>(getOutputLength(numInput)), output);
+    }
+
+    /**
+     * Input span [firstInput, firstInput + numInput) that outputs [firstOutput, firstOutput + numOutput) read
+     * (it may start before 0 or end past the source; those samples are silence)
+     */
+    void getInputRange(int64_t firstOutput, int numOutput, int64_t& firstInput, int& numInput) const {
+        const int64_t firstIndex = inputIndex(firstOutput);
+        const int64_t lastIndex = inputIndex(firstOutput + numOutput - 1);
+        firstInput = firstIndex - half_ + 1;
+        numInput = static_cast<int>(lastIndex - firstIndex) + stride_;
+    }
+
+    /**
+     * Render outputs [firstOutput, firstOutput + numOutput)
+     * @param input The span given by getInputRange, starting at source index firstInput
+     */
+    void processRange(const float* input, int64_t firstInput, int64_t firstOutput, int numOutput, float* output) const {
+        const float* rows = alignedTable();
+
+        for (int i = 0; i < numOutput; i++) {
+            // Exact position for every sample (no accumulated drift over long files)
+            const double position = static_cast<double>(firstOutput + i) * step_;
+            const int64_t index = static_cast<int64_t>(position);
+            const double phase = (position - static_cast<double>(index)) * PHASES;
+            const int row = std::min(static_cast<int>(phase), PHASES - 1);
+            const float blend = static_cast<float>(phase - row);
+
+            const float* window = input + (index - half_ + 1 - firstInput);
+            const float* rowA = rows + static_cast<size_t>(row) * stride_;
+            const float* rowB = rowA + stride_;
+
+            float a = 0.0f;
+            float b = 0.0f;
+            dot2(window, rowA, rowB, a, b);
+            output[i] = a + (b - a) * blend;
+        }
+    }
+
+    /**
+     * Convenience: convert a whole buffer
+     */
+    static std::vector<float> convert(const float* input, int numInput, double inputRate, double outputRate) {
+        PolyphaseResampler resampler(inputRate, outputRate);
+        std::vector<float> output(static_cast<size_t>(resampler.getOutputLength(numInput)));
+        resampler.process(input, numInput, output.data());
+        return output;
+    }
+
+private:
+    static constexpr size_t ALIGN_PADDING = 4;  // Floats of slack to align the table to 16 bytes
+
+    double step_;                               // Input samples per output sample
+    int stride_ = 0;                            // Taps per row (multiple of 4)
+    int half_ = 0;
+    std::vector<float> table_;
+
+    int64_t inputIndex(int64_t output) const {
+        return static_cast<int64_t>(static_cast<double>(output) * step_);
+    }
+
+    const float* alignedTable() const {
+        const float* base = table_.data();
+        const size_t misalignment = (reinterpret_cast<size_t>(base) / sizeof(float)) & 3;
+        return base + ((4 - misalignment) & 3);
+    }
+
+    /**
+     * Row p holds the kernel for a fractional offset of p / PHASES:
+     * tap k weights input sample (index - half + 1 + k), at distance (k - half + 1 - p / PHASES)
+     */
+    void buildTable(double cutoff) {
+        float* rows = const_cast<float*>(alignedTable());
+        const double radius = static_cast<double>(half_);
+        const double norm = besselI0(BETA);
+
+        for (int p = 0; p <= PHASES; p++) {
+            const double fraction = static_cast<double>(p) / PHASES;
+            float* row = rows + static_cast<size_t>(p) * stride_;
+            double sum = 0.0;
+
+            for (int k = 0; k < stride_; k++) {
+                const double x = static_cast<double>(k - half_ + 1) - fraction;
+                const double r = x / radius;
+                if (std::abs(r) >= 1.0) {
+                    row[k] = 0.0f;
+                    continue;
+                }
+                const double window = besselI0(BETA * std::sqrt(1.0 - r * r)) / norm;
+                const double value = cutoff * sinc(cutoff * x) * window;
+                row[k] = static_cast<float>(value);
+                sum += value;
+            }
+
+            // Unity DC gain for every phase
+            if (sum != 0.0) {
+                for (int k = 0; k < stride_; k++) {
+                    row[k] = static_cast<float>(row[k] / sum);
+                }
+            }
+        }
+    }
+
+    void dot2(const float* window, const float* rowA, const float* rowB, float& a, float& b) const {
+#if TECHNO_SIMD
+        Float4 sumA = Float4::zero();
+        Float4 sumB = Float4::zero();
+        for (int k = 0; k < stride_; k += 4) {
+            const Float4 x = Float4::loadUnaligned(window + k);
+            sumA = sumA + x * Float4::load(rowA + k);
+            sumB = sumB + x * Float4::load(rowB + k);
+        }
+        a = sumA.sum();
+        b = sumB.sum();
+#else
+        float sumA = 0.0f;
+        float sumB = 0.0f;
+        for (int k = 0; k < stride_; k++) {
+            sumA += window[k] * rowA[k];
+            sumB += window[k] * rowB[k];
+        }
+        a = sumA;
+        b = sumB;
+#endif
+    }
+
+    static double sinc(double x) {
+        if (std::abs(x) < 1e-12) return 1.0;
+        const double px = 3.14159265358979323846 * x;
+        return std::sin(px) / px;
+    }
+
+    // Zeroth-order modified Bessel function of the first kind (series)
+    static double besselI0(double x) {
+        double sum = 1.0;
+        double term = 1.0;
+        const double quarterSquare = x * x * 0.25;
+        for (int k = 1; k < 64; k++) {
+            term *= quarterSquare / (static_cast<double>(k) * k);
+            sum += term;
+            if (term < sum * 1e-12) break;
+        }
+        return sum;
+    }
+};
+
+} // namespace TechnoMachine
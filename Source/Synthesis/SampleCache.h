@@ -0,0 +1,201 @@
+/**
+ * SampleCache.h
+ * Techno Machine - On-disk cache of decoded, resampled sample PCM
+ *
+ * One file per (file content, modification time, target rate):
+ *
+ *   <app data>/MADZINE/TechnoMachine/SampleCache/<content hash>-<mtime>-<rate>.tmpcm
+ *   [SampleCacheHeader][float32 × numSamples]
+ *
+ * - The content hash is a 64-bit FNV-1a variant over the mapped source file, so a renamed or copied
+ *   file still hits and an edited file misses
+ * - A hit is memory mapped; the returned SampleData plays straight from the mapping
+ *   (no decode, no resample, no copy). Pages are prefaulted and locked on the loader thread
+ *   (MappedPages) before the sample is published.
+ * - Files are written to a temporary name and renamed, so a half-written entry is never read
+ * - Least recently used entries are deleted once the cache exceeds MAX_BYTES
+ * - Native byte order: the cache is local to the machine
+ *
+ * Loader thread only (file I/O).
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "MappedSample.h"
+#include "SampleEngine.h"
+
+namespace TechnoMachine {
+
+namespace SampleCacheFormat {
+    static constexpr char MAGIC[4] = {'T', 'M', 'P', 'C'};
+    static constexpr uint32_t VERSION = 1;
+}
+
+struct SampleCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t contentHash;
+    int64_t modificationTime;   // ms since epoch
+    double sampleRate;          // Rate of the cached PCM
+    uint64_t numSamples;
+    uint8_t reserved[24];
+};
+
+static_assert(sizeof(SampleCacheHeader) == 64, "SampleCacheHeader layout");
+
+/**
+ * Identity of a source file; the cache key without the target rate
+ */
+struct SampleSourceKey {
+    uint64_t contentHash = 0;
+    int64_t modificationTime = 0;
+};
+
+class SampleCache {
+public:
+    static constexpr int64_t MAX_BYTES = int64_t(1) << 30;   // 1 GB
+    static constexpr const char* EXTENSION = ".tmpcm";
+
+    explicit SampleCache(const juce::File& directory = defaultDirectory())
+        : directory_(directory) {}
+
+    static juce::File defaultDirectory() {
+        return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+            .getChildFile("MADZINE").getChildFile("TechnoMachine").getChildFile("SampleCache");
+    }
+
+    /**
+     * Hash the contents of a source file
+     * @return false if the file cannot be read
+     */
+    static bool identify(const juce::File& file, SampleSourceKey& key) {
+        juce::MemoryMappedFile mapped(file, juce::MemoryMappedFile::readOnly);
+        if (mapped.getData() == nullptr && file.getSize() > 0) return false;
+
+        key.contentHash = hash(static_cast<const uint8_t*>(mapped.getData()), mapped.getSize());
+        key.modificationTime = file.getLastModificationTime().toMilliseconds();
+        return true;
+    }
+
+    /**
+     * Map a cached entry
+     * @return a SampleData backed by the mapping (fileName / filePath unset), or nullptr on a miss
+     */
+    std::unique_ptr<SampleData> open(const SampleSourceKey& key, double sampleRate) const {
+        juce::File entry = entryFile(key, sampleRate);
+        if (!entry.existsAsFile()) return nullptr;
+
+        auto mapped = std::make_unique<juce::MemoryMappedFile>(entry, juce::MemoryMappedFile::readOnly);
+        const size_t size = mapped->getSize();
+        if (mapped->getData() == nullptr || size < sizeof(SampleCacheHeader)) return nullptr;
+
+        SampleCacheHeader header;
+        std::memcpy(&header, mapped->getData(), sizeof(header));
+        if (std::memcmp(header.magic, SampleCacheFormat::MAGIC, sizeof(header.magic)) != 0) return nullptr;
+        if (header.version != SampleCacheFormat::VERSION) return nullptr;
+        if (header.contentHash != key.contentHash || header.modificationTime != key.modificationTime) return nullptr;
+        if (header.sampleRate != sampleRate) return nullptr;
+        if (header.numSamples > static_cast<uint64_t>(std::numeric_limits<int>::max())
+            || header.numSamples > (size - sizeof(SampleCacheHeader)) / sizeof(float)) return nullptr;
+
+        const float* samples = reinterpret_cast<const float*>(static_cast<const char*>(mapped->getData())
+                                                              + sizeof(SampleCacheHeader));
+        MappedPages::prefaultAndLock(samples, header.numSamples * sizeof(float));
+
+        auto data = std::make_unique<SampleData>();
+        data->samples = samples;
+        data->numFrames = static_cast<int>(header.numSamples);
+        data->mapping = std::move(mapped);
+
+        // Refresh for LRU pruning
+        entry.setLastModificationTime(juce::Time::getCurrentTime());
+        return data;
+    }
+
+    /**
+     * Write an entry (best effort; failures only cost a decode next time)
+     */
+    void store(const SampleSourceKey& key, double sampleRate, const float* samples, int numSamples) const {
+        if (!directory_.createDirectory()) return;
+
+        SampleCacheHeader header = {};
+        std::memcpy(header.magic, SampleCacheFormat::MAGIC, sizeof(header.magic));
+        header.version = SampleCacheFormat::VERSION;
+        header.contentHash = key.contentHash;
+        header.modificationTime = key.modificationTime;
+        header.sampleRate = sampleRate;
+        header.numSamples = static_cast<uint64_t>(numSamples);
+
+        juce::File entry = entryFile(key, sampleRate);
+        juce::File temp = entry.getSiblingFile(entry.getFileName() + ".tmp");
+        temp.deleteFile();
+        bool ok = false;
+        {
+            juce::FileOutputStream out(temp);
+            ok = out.openedOk()
+                && out.write(&header, sizeof(header))
+                && out.write(samples, static_cast<size_t>(numSamples) * sizeof(float));
+            out.flush();
+            ok = ok && out.getStatus().wasOk();
+        }
+        if (!ok || !temp.moveFileTo(entry)) {
+            temp.deleteFile();
+            return;
+        }
+
+        prune();
+    }
+
+private:
+    juce::File directory_;
+
+    juce::File entryFile(const SampleSourceKey& key, double sampleRate) const {
+        return directory_.getChildFile(juce::String::toHexString(static_cast<juce::int64>(key.contentHash))
+                                       + "-" + juce::String::toHexString(static_cast<juce::int64>(key.modificationTime))
+                                       + "-" + juce::String(juce::roundToInt(sampleRate)) + EXTENSION);
+    }
+
+    /**
+     * Delete least recently used entries until the cache fits in MAX_BYTES
+     */
+    void prune() const {
+        auto entries = directory_.findChildFiles(juce::File::findFiles, false, juce::String("*") + EXTENSION);
+        int64_t total = 0;
+        for (const auto& entry : entries) total += entry.getSize();
+        if (total <= MAX_BYTES) return;
+
+        std::sort(entries.begin(), entries.end(), [](const juce::File& a, const juce::File& b) {
+            return a.getLastModificationTime().toMilliseconds() < b.getLastModificationTime().toMilliseconds();
+        });
+        for (const auto& entry : entries) {
+            if (total <= MAX_BYTES) break;
+            const int64_t size = entry.getSize();
+            if (entry.deleteFile()) total -= size;
+        }
+    }
+
+    // FNV-1a over 64-bit words (high bits folded back each step), then the tail bytes
+    static uint64_t hash(const uint8_t* bytes, size_t size) {
+        uint64_t h = 14695981039346656037ull;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+            h = (h ^ word) * 1099511628211ull;
+            h ^= h >> 29;
+        }
+        for (; i < size; i++) {
+            h = (h ^ bytes[i]) * 1099511628211ull;
+        }
+        return (h ^ size) * 1099511628211ull;
+    }
+};
+
+} // namespace TechnoMachine
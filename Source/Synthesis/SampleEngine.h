@@ -4,136 +4,160 @@
  *
  * Allows loading one-shot samples per role (4 slots)
  * Works alongside MinimalDrumSynth for hybrid synth+sample sounds
+ *
+ * Files are decoded and resampled on a background thread (SampleLoader)
+ * and installed on the audio thread (SampleEngine::installSample)
  */
 
 #pragma once
 
 #include <JuceHeader.h>
 #include <atomic>
+#include <memory>
+#include "SampleStream.h"
 
 namespace TechnoMachine {
 
 /**
- * Single sample voice - loads and plays one WAV/AIFF file
+ * Sample at the engine rate
+ * Immutable once published; handed between threads by pointer (no frames = cleared voice)
+ *
+ * Playback reads numFrames floats from samples, stride floats apart. They live in one of:
+ * - buffer: decoded / resampled PCM owned by this object (useBuffer())
+ * - mapping: a read-only memory-mapped file (SampleCache entry, or a float WAV at the engine
+ *   rate played in place, channel 0 of its interleaved frames)
+ * - stream: a long file; samples / numFrames are its head and the rest comes from the stream's
+ *   ring (the only mutable part, read by the one Playback the SampleData is installed in)
+ */
+struct SampleData {
+    const float* samples = nullptr;
+    int numFrames = 0;
+    int stride = 1;
+
+    juce::AudioBuffer<float> buffer;
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    std::unique_ptr<SampleStream> stream;
+
+    juce::String fileName;
+    juce::String filePath;
+    uint32_t generation = 0;    // SampleLoader request that produced it
+
+    void useBuffer() {
+        samples = buffer.getReadPointer(0);
+        numFrames = buffer.getNumSamples();
+        stride = 1;
+    }
+
+    int64_t getLength() const { return stream != nullptr ? stream->getLength() : numFrames; }
+};
+
+/**
+ * Single sample voice - plays one decoded WAV/AIFF file
  */
 class SampleVoice {
 public:
     SampleVoice() = default;
 
+    ~SampleVoice() {
+        delete current_.data;
+        delete tail_.data;
+    }
+
     /**
-     * Load sample from file
-     * @param file WAV or AIFF file
-     * @param targetSampleRate Resample to this rate if different
-     * @return true if loaded successfully
+     * Install a new sample (audio thread; no allocation, no deallocation)
+     * The replaced sample keeps playing out its current hit as a tail, so swapping mid-set never clicks.
+     * @param incoming New sample (ownership transferred); a SampleData without frames clears the voice
+     * @return the previous tail (may be nullptr); the caller must dispose of it off the audio thread
      */
-    bool loadFromFile(const juce::File& file, double targetSampleRate) {
-        juce::AudioFormatManager formatManager;
-        formatManager.registerBasicFormats();
-
-        std::unique_ptr<juce::AudioFormatReader> reader(
-            formatManager.createReaderFor(file));
-
-        if (!reader) {
-            return false;
-        }
-
-        // Read into temporary buffer
-        juce::AudioBuffer<float> tempBuffer;
-        tempBuffer.setSize(1, static_cast<int>(reader->lengthInSamples));
-        reader->read(&tempBuffer, 0, tempBuffer.getNumSamples(), 0, true, false);
-
-        // Resample if needed
-        if (std::abs(reader->sampleRate - targetSampleRate) > 1.0) {
-            double ratio = targetSampleRate / reader->sampleRate;
-            int newLength = static_cast<int>(tempBuffer.getNumSamples() * ratio);
-
-            juce::AudioBuffer<float> resampledBuffer;
-            resampledBuffer.setSize(1, newLength);
-
-            // Simple linear interpolation resampling
-            for (int i = 0; i < newLength; ++i) {
-                double srcPos = i / ratio;
-                int srcIdx = static_cast<int>(srcPos);
-                float frac = static_cast<float>(srcPos - srcIdx);
-
-                if (srcIdx + 1 < tempBuffer.getNumSamples()) {
-                    float s0 = tempBuffer.getSample(0, srcIdx);
-                    float s1 = tempBuffer.getSample(0, srcIdx + 1);
-                    resampledBuffer.setSample(0, i, s0 + frac * (s1 - s0));
-                } else if (srcIdx < tempBuffer.getNumSamples()) {
-                    resampledBuffer.setSample(0, i, tempBuffer.getSample(0, srcIdx));
-                }
-            }
-
-            buffer_ = std::move(resampledBuffer);
-        } else {
-            buffer_ = std::move(tempBuffer);
-        }
-
-        fileName_ = file.getFileName();
-        filePath_ = file.getFullPathName();
-        loaded_ = true;
-        return true;
+    SampleData* install(SampleData* incoming) {
+        SampleData* released = tail_.data;
+        tail_ = current_;
+        current_ = Playback();
+        current_.data = incoming;
+        return released;
     }
 
     /**
      * Trigger sample playback
      */
     void trigger(float velocity) {
-        velocity_ = velocity;
-        playbackPosition_ = 0;
-        isPlaying_ = true;
+        if (!isLoaded()) return;
+        current_.velocity = velocity;
+        current_.position = 0;
+        current_.playing = true;
+        if (current_.data->stream != nullptr) current_.data->stream->restart();
     }
 
     /**
-     * Process one sample
-     * @return Mono output sample
+     * Process a block, adding the panned output into left/right
+     * @return number of streamed sounds that ran dry in this block (0-2)
      */
-    float process() {
-        if (!isPlaying_ || !loaded_ || buffer_.getNumSamples() == 0) {
-            return 0.0f;
-        }
+    int processBlock(float* left, float* right, int numSamples, float gainL, float gainR) {
+        int underruns = current_.render(left, right, numSamples, gainL, gainR) ? 1 : 0;
+        underruns += tail_.render(left, right, numSamples, gainL, gainR) ? 1 : 0;
+        return underruns;
+    }
 
-        if (playbackPosition_ >= buffer_.getNumSamples()) {
-            isPlaying_ = false;
-            return 0.0f;
-        }
+    bool isLoaded() const { return current_.data != nullptr && current_.data->numFrames > 0; }
+    bool isPlaying() const { return current_.playing || tail_.playing; }
 
-        float sample = buffer_.getSample(0, playbackPosition_) * velocity_;
-        playbackPosition_++;
+private:
+    struct Playback {
+        SampleData* data = nullptr;
+        int64_t position = 0;
+        bool playing = false;
+        float velocity = 0.0f;
+
+        // @return true if a stream underran
+        bool render(float* left, float* right, int numSamples, float gainL, float gainR) {
+            if (!playing || data == nullptr) return false;
+
+            const float levelL = gainL * velocity;
+            const float levelR = gainR * velocity;
+            int done = 0;
+            bool underrun = false;
+
+            // Frames in memory (the whole sample, or the head of a stream)
+            if (position < data->numFrames) {
+                done = static_cast<int>(std::min<int64_t>(numSamples, data->numFrames - position));
+                mix(data->samples + position * data->stride, data->stride, left, right, done, levelL, levelR);
+                position += done;
+            }
 
-        return sample;
-    }
+            const int64_t length = data->getLength();
+            if (data->stream != nullptr && done < numSamples && position < length) {
+                const int count = static_cast<int>(std::min<int64_t>(numSamples - done, length - position));
+                underrun = data->stream->read(position, left + done, right + done, count, levelL, levelR);
+                position += count;
+            }
 
-    bool isLoaded() const { return loaded_; }
-    bool isPlaying() const { return isPlaying_; }
-    juce::String getFileName() const { return fileName_; }
-    juce::String getFilePath() const { return filePath_; }
-
-    void clear() {
-        buffer_.setSize(0, 0);
-        loaded_ = false;
-        isPlaying_ = false;
-        fileName_ = "";
-        filePath_ = "";
-    }
+            if (position >= length) {
+                playing = false;
+            }
+            return underrun;
+        }
 
-private:
-    juce::AudioBuffer<float> buffer_;
-    int playbackPosition_ = 0;
-    bool isPlaying_ = false;
-    bool loaded_ = false;
-    float velocity_ = 0.0f;
-    juce::String fileName_;
-    juce::String filePath_;
-};
+        static void mix(const float* src, int stride, float* left, float* right, int count,
+                        float levelL, float levelR) {
+            if (stride == 1) {
+                juce::FloatVectorOperations::addWithMultiply(left, src, levelL, count);
+                juce::FloatVectorOperations::addWithMultiply(right, src, levelR, count);
+                return;
+            }
 
-/**
- * Stereo output structure
- */
-struct SampleStereoOutput {
-    float left = 0.0f;
-    float right = 0.0f;
+            // Interleaved mapped file: channel 0 of each frame
+            for (int i = 0; i < count; i++) {
+                const float x = src[static_cast<size_t>(i) * stride];
+                left[i] += x * levelL;
+                right[i] += x * levelR;
+            }
+        }
+    };
+
+    Playback current_;   // sample triggered by the sequencer
+    Playback tail_;      // previously installed sample, finishing its last hit
+
+    JUCE_DECLARE_NON_COPYABLE(SampleVoice)
 };
 
 /**
@@ -153,26 +177,19 @@ public:
         sampleRate_ = sampleRate;
     }
 
+    double getSampleRate() const { return sampleRate_; }
+
     /**
-     * Load sample for a specific voice
+     * Install the sample of a voice (audio thread)
      * @param voiceIdx 0-3 (one per role)
-     * @param file WAV or AIFF file
-     * @return true if loaded successfully
+     * @param incoming New sample (ownership transferred); a SampleData without frames clears the voice
+     * @return sample released by the voice (may be nullptr); the caller must dispose of it off the audio thread
      */
-    bool loadSample(int voiceIdx, const juce::File& file) {
+    SampleData* installSample(int voiceIdx, SampleData* incoming) {
         if (voiceIdx < 0 || voiceIdx >= NUM_VOICES) {
-            return false;
-        }
-        return samples_[voiceIdx].loadFromFile(file, sampleRate_);
-    }
-
-    /**
-     * Clear sample for a specific voice
-     */
-    void clearSample(int voiceIdx) {
-        if (voiceIdx >= 0 && voiceIdx < NUM_VOICES) {
-            samples_[voiceIdx].clear();
+            return incoming;
         }
+        return samples_[voiceIdx].install(incoming);
     }
 
     /**
@@ -185,47 +202,30 @@ public:
     }
 
     /**
-     * Process all samples and return stereo mix
+     * Process a block of all samples, adding the stereo mix into left/right
      */
-    SampleStereoOutput process() {
-        SampleStereoOutput output;
-
-        // Voice panning (same as synth voices)
-        // Timeline (0)=L, Foundation (1)=C, Groove (2)=C, Lead (3)=R
-        static const float panL[NUM_VOICES] = {0.7f, 0.5f, 0.5f, 0.3f};
-        static const float panR[NUM_VOICES] = {0.3f, 0.5f, 0.5f, 0.7f};
-
+    void processBlock(float* left, float* right, int numSamples) {
+        int underruns = 0;
         for (int v = 0; v < NUM_VOICES; ++v) {
-            float sample = samples_[v].process() * roleLevel_[v];
-            output.left += sample * panL[v];
-            output.right += sample * panR[v];
+            underruns += samples_[v].processBlock(left, right, numSamples,
+                                                  roleLevel_[v] * panL_[v], roleLevel_[v] * panR_[v]);
+        }
+        if (underruns > 0) {
+            streamUnderruns_.fetch_add(static_cast<uint64_t>(underruns), std::memory_order_relaxed);
         }
-
-        return output;
-    }
-
-    /**
-     * Check if voice has a sample loaded
-     */
-    bool hasSample(int voiceIdx) const {
-        if (voiceIdx < 0 || voiceIdx >= NUM_VOICES) return false;
-        return samples_[voiceIdx].isLoaded();
     }
 
     /**
-     * Get sample filename for a voice
+     * Blocks in which a streamed sample ran out of buffered audio (any thread)
      */
-    juce::String getSampleName(int voiceIdx) const {
-        if (voiceIdx < 0 || voiceIdx >= NUM_VOICES) return "";
-        return samples_[voiceIdx].getFileName();
-    }
+    uint64_t getStreamUnderruns() const { return streamUnderruns_.load(std::memory_order_relaxed); }
 
     /**
-     * Get full sample path for a voice
+     * Check if voice has a sample loaded (audio thread)
      */
-    juce::String getSamplePath(int voiceIdx) const {
-        if (voiceIdx < 0 || voiceIdx >= NUM_VOICES) return "";
-        return samples_[voiceIdx].getFilePath();
+    bool hasSample(int voiceIdx) const {
+        if (voiceIdx < 0 || voiceIdx >= NUM_VOICES) return false;
+        return samples_[voiceIdx].isLoaded();
     }
 
     /**
@@ -238,9 +238,15 @@ public:
     }
 
 private:
+    // Voice panning (same as synth voices)
+    // Timeline (0)=L, Foundation (1)=C, Groove (2)=C, Lead (3)=R
+    static constexpr float panL_[NUM_VOICES] = {0.7f, 0.5f, 0.5f, 0.3f};
+    static constexpr float panR_[NUM_VOICES] = {0.3f, 0.5f, 0.5f, 0.7f};
+
     SampleVoice samples_[NUM_VOICES];
     double sampleRate_ = 48000.0;
     float roleLevel_[NUM_ROLES] = {1.0f, 1.0f, 1.0f, 1.0f};
+    std::atomic<uint64_t> streamUnderruns_{0};
 };
 
 } // namespace TechnoMachine
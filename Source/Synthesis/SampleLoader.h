@@ -0,0 +1,344 @@
+/**
+ * SampleLoader.h
+ * Techno Machine - Background sample decoding
+ *
+ * Flow (same handoff as DeckBuilder):
+ * - Message thread calls requestLoad() (only the latest request per voice is kept)
+ * - Worker thread streams files longer than STREAM_SECONDS from disk (SampleStream), whatever
+ *   their format, so a long file is never mapped or locked in memory;
+ *   else maps a 32-bit float WAV at the engine rate and plays it in place (MappedSample);
+ *   else maps the result from SampleCache if this file was already decoded at this rate;
+ *   otherwise it decodes the file, keeps the PCM at its original rate, resamples it
+ *   (PolyphaseResampler) into a new, immutable SampleData and writes it to the cache.
+ *   Either way the SampleData is published in the voice's ready slot (atomic pointer).
+ * - setSampleRate() with a new rate rebuilds every loaded voice (cache, else its original PCM,
+ *   decoding the file only if it came from the cache) and publishes through the same slot
+ * - Audio thread takeReady() -> SampleEngine::installSample() -> retire() the buffer it replaced
+ * - Retired buffers are freed by the worker thread
+ * - Every request has a per-voice generation (returned by requestLoad and carried by the
+ *   SampleData it produces); a load that fails publishes nothing and reports its generation
+ *   through getFailedGeneration()
+ *
+ * Ownership moves with each atomic exchange, so exactly one thread owns a buffer at any time and
+ * the audio thread never locks, allocates or frees.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "MappedSample.h"
+#include "PolyphaseResampler.h"
+#include "SampleCache.h"
+#include "SampleEngine.h"
+#include "SampleStream.h"
+
+namespace TechnoMachine {
+
+class SampleLoader {
+public:
+    static constexpr int NUM_VOICES = SampleEngine::NUM_VOICES;
+
+    SampleLoader() {
+        formatManager_.registerBasicFormats();
+        worker_ = std::thread([this] { run(); });
+    }
+
+    ~SampleLoader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wakeUp_.notify_one();
+        worker_.join();
+
+        for (auto& slot : ready_) delete slot.exchange(nullptr);
+        reclaimRetired();
+    }
+
+    /**
+     * Rate samples are resampled to; a change re-resamples the loaded voices in the background
+     */
+    void setSampleRate(double sampleRate) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (sampleRate == sampleRate_) return;
+            sampleRate_ = sampleRate;
+            rateChanged_ = true;
+        }
+        wakeUp_.notify_one();
+    }
+
+    /**
+     * Queue a load (message thread); a default-constructed File clears the voice.
+     * An older request for the same voice that has not finished is dropped.
+     * @return the request's generation (0 for an invalid voice)
+     */
+    uint32_t requestLoad(int voiceIdx, const juce::File& file) {
+        if (voiceIdx < 0 || voiceIdx >= NUM_VOICES) return 0;
+        uint32_t generation = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_[voiceIdx] = file;
+            hasPending_[voiceIdx] = true;
+            generation = ++generation_[voiceIdx];
+            pendingGeneration_[voiceIdx] = generation;
+        }
+        wakeUp_.notify_one();
+        return generation;
+    }
+
+    /**
+     * Generation of the voice's most recent failed load (any thread), 0 if none failed
+     */
+    uint32_t getFailedGeneration(int voiceIdx) const {
+        return failedGeneration_[voiceIdx].load(std::memory_order_acquire);
+    }
+
+    /**
+     * Take a finished sample (audio thread), nullptr if none.
+     * A cleared voice is published as a SampleData without frames.
+     */
+    SampleData* takeReady(int voiceIdx) {
+        return ready_[voiceIdx].exchange(nullptr, std::memory_order_acquire);
+    }
+
+    bool hasReady(int voiceIdx) const {
+        return ready_[voiceIdx].load(std::memory_order_relaxed) != nullptr;
+    }
+
+    /**
+     * Whether a retire slot is free (audio thread; only the audio thread fills them)
+     */
+    bool canRetire() const {
+        for (const auto& slot : retired_) {
+            if (slot.load(std::memory_order_relaxed) == nullptr) return true;
+        }
+        return false;
+    }
+
+    /**
+     * Hand a replaced sample to the worker for deletion (audio thread)
+     * @return false if no slot is free (check canRetire() first)
+     */
+    bool retire(SampleData* data) {
+        if (data == nullptr) return true;
+        for (auto& slot : retired_) {
+            SampleData* expected = nullptr;
+            if (slot.compare_exchange_strong(expected, data, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    static constexpr int MAX_RETIRED = 8;
+    static constexpr double STREAM_SECONDS = 20.0;     // Longer files stream instead of loading into memory
+
+    /**
+     * Loaded file and, once decoded, its PCM at the original rate (worker thread only)
+     */
+    struct Source {
+        juce::File file;
+        SampleSourceKey key;
+        bool identified = false;    // key computed (only needed once the cache is used)
+        std::vector<float> pcm;
+        double sampleRate = 0.0;
+        juce::String fileName;
+        juce::String filePath;
+    };
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    bool stopping_ = false;
+    double sampleRate_ = 48000.0;
+    bool rateChanged_ = false;
+    juce::File pending_[NUM_VOICES];
+    bool hasPending_[NUM_VOICES] = {};
+
+    // Bumped by every requestLoad; a result is published only if no newer request arrived meanwhile
+    uint32_t generation_[NUM_VOICES] = {};
+    uint32_t pendingGeneration_[NUM_VOICES] = {};
+
+    std::atomic<SampleData*> ready_[NUM_VOICES] = {};
+    std::atomic<uint32_t> failedGeneration_[NUM_VOICES] = {};
+    std::atomic<SampleData*> retired_[MAX_RETIRED] = {};
+
+    juce::AudioFormatManager formatManager_;
+    SampleCache cache_;
+    Source sources_[NUM_VOICES];
+
+    void run() {
+        for (;;) {
+            juce::File files[NUM_VOICES];
+            uint32_t generations[NUM_VOICES] = {};
+            bool has[NUM_VOICES] = {};
+            double sampleRate = 0.0;
+            bool rateChanged = false;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                // The audio thread cannot notify; wake up periodically to free retired buffers
+                wakeUp_.wait_for(lock, std::chrono::milliseconds(50), [this] {
+                    if (stopping_ || rateChanged_) return true;
+                    for (bool pending : hasPending_) {
+                        if (pending) return true;
+                    }
+                    return false;
+                });
+                if (stopping_) return;
+
+                for (int v = 0; v < NUM_VOICES; v++) {
+                    has[v] = hasPending_[v];
+                    // A rate change re-publishes loaded voices under their current generation
+                    generations[v] = has[v] ? pendingGeneration_[v] : generation_[v];
+                    if (has[v]) files[v] = pending_[v];
+                    hasPending_[v] = false;
+                }
+                sampleRate = sampleRate_;
+                rateChanged = rateChanged_;
+                rateChanged_ = false;
+            }
+
+            reclaimRetired();
+
+            for (int v = 0; v < NUM_VOICES; v++) {
+                if (has[v]) {
+                    load(v, files[v], generations[v], sampleRate);
+                } else if (rateChanged && sources_[v].file.getFullPathName().isNotEmpty()) {
+                    if (auto data = build(sources_[v], sampleRate)) publish(v, std::move(data), generations[v]);
+                }
+            }
+        }
+    }
+
+    void load(int voiceIdx, const juce::File& file, uint32_t generation, double sampleRate) {
+        if (file.getFullPathName().isEmpty()) {
+            sources_[voiceIdx] = Source();
+            publish(voiceIdx, std::make_unique<SampleData>(), generation);
+            return;
+        }
+
+        // A failed load leaves the voice (and its source) as it was
+        Source source;
+        source.file = file;
+        source.fileName = file.getFileName();
+        source.filePath = file.getFullPathName();
+
+        auto data = build(source, sampleRate);
+        if (data == nullptr) {
+            failedGeneration_[voiceIdx].store(generation, std::memory_order_release);
+            return;
+        }
+        sources_[voiceIdx] = std::move(source);
+        publish(voiceIdx, std::move(data), generation);
+    }
+
+    /**
+     * Sample at sampleRate: streamed if long, else the file mapped in place, else from the cache,
+     * else resampled from the source PCM (decoded on demand)
+     */
+    std::unique_ptr<SampleData> build(Source& source, double sampleRate) {
+        // The reader only parses the header; its length decides before anything is mapped
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager_.createReaderFor(source.file));
+        if (reader == nullptr || reader->sampleRate <= 0.0 || reader->lengthInSamples <= 0) {
+            DBG("SampleLoader: cannot decode " << source.filePath);
+            return nullptr;
+        }
+
+        if (reader->lengthInSamples > static_cast<juce::int64>(STREAM_SECONDS * reader->sampleRate)) {
+            auto data = std::make_unique<SampleData>();
+            data->stream = SampleStream::create(std::move(reader), sampleRate);
+            data->samples = data->stream->getHead();
+            data->numFrames = data->stream->getHeadFrames();
+            data->fileName = source.fileName;
+            data->filePath = source.filePath;
+            return data;
+        }
+
+        if (auto mapped = MappedSample::mapFloatWav(source.file, sampleRate)) {
+            mapped->fileName = source.fileName;
+            mapped->filePath = source.filePath;
+            return mapped;
+        }
+
+        if (!source.identified) {
+            if (!SampleCache::identify(source.file, source.key)) {
+                DBG("SampleLoader: cannot read " << source.filePath);
+                return nullptr;
+            }
+            source.identified = true;
+        }
+
+        if (auto cached = cache_.open(source.key, sampleRate)) {
+            cached->fileName = source.fileName;
+            cached->filePath = source.filePath;
+            return cached;
+        }
+
+        if (source.pcm.empty()) decode(source, *reader);
+
+        auto data = resample(source, sampleRate);
+        cache_.store(source.key, sampleRate, data->samples, data->numFrames);
+        return data;
+    }
+
+    /**
+     * Read the first channel of a WAV/AIFF file at its own rate
+     */
+    static void decode(Source& source, juce::AudioFormatReader& reader) {
+        juce::AudioBuffer<float> buffer(1, static_cast<int>(reader.lengthInSamples));
+        reader.read(&buffer, 0, buffer.getNumSamples(), 0, true, false);
+
+        const float* samples = buffer.getReadPointer(0);
+        source.pcm.assign(samples, samples + buffer.getNumSamples());
+        source.sampleRate = reader.sampleRate;
+    }
+
+    static std::unique_ptr<SampleData> resample(const Source& source, double sampleRate) {
+        auto data = std::make_unique<SampleData>();
+        data->fileName = source.fileName;
+        data->filePath = source.filePath;
+
+        const int numInput = static_cast<int>(source.pcm.size());
+        if (std::abs(source.sampleRate - sampleRate) <= 1.0) {
+            data->buffer.setSize(1, numInput);
+            data->buffer.copyFrom(0, 0, source.pcm.data(), numInput);
+            data->useBuffer();
+            return data;
+        }
+
+        PolyphaseResampler resampler(source.sampleRate, sampleRate);
+        data->buffer.setSize(1, static_cast<int>(resampler.getOutputLength(numInput)));
+        resampler.process(source.pcm.data(), numInput, data->buffer.getWritePointer(0));
+        data->useBuffer();
+        return data;
+    }
+
+    /**
+     * Publish; an uninstalled older result is dropped, and so is this one if superseded
+     */
+    void publish(int voiceIdx, std::unique_ptr<SampleData> data, uint32_t generation) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation_[voiceIdx] != generation) return;
+        data->generation = generation;
+        delete ready_[voiceIdx].exchange(data.release(), std::memory_order_acq_rel);
+    }
+
+    void reclaimRetired() {
+        for (auto& slot : retired_) {
+            delete slot.exchange(nullptr, std::memory_order_acquire);
+        }
+    }
+};
+
+} // namespace TechnoMachine
@@ -0,0 +1,253 @@
+/**
+ * SampleStream.h
+ * Techno Machine - Disk streaming for long samples (ambient beds, field recordings)
+ *
+ * Memory per stream is bounded regardless of file length:
+ * - head: the first HEAD_SECONDS at the engine rate, in memory; played from the moment of the
+ *   trigger while the ring is being primed
+ * - ring: RING_FRAMES frames, refilled ahead of the playhead by the SampleStreamer thread
+ *   (file read + PolyphaseResampler::processRange when the file rate differs)
+ *
+ * Ring protocol (single producer = streamer thread, single consumer = audio thread):
+ * - Frame f of the sample lives in slot f % RING_FRAMES
+ * - The consumer publishes (generation, playhead); a trigger bumps the generation and rewinds
+ * - The producer publishes (generation, filled end); it restarts at the head end when the
+ *   generation changes and writes frame f only once f < playhead + RING_FRAMES
+ * - Frames the producer has not delivered in time play as silence and count as an underrun
+ *
+ * Both words pack a 24-bit generation with a 40-bit frame index, so each side publishes with one
+ * atomic store and the audio thread never locks or waits.
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "PolyphaseResampler.h"
+
+namespace TechnoMachine {
+
+class SampleStream {
+public:
+    static constexpr double HEAD_SECONDS = 1.0;
+    static constexpr int RING_FRAMES = 1 << 17;     // ~2.7 s at 48 kHz
+    static constexpr int CHUNK_FRAMES = 4096;       // Largest single refill
+
+    /**
+     * Open a stream (loader thread): reads the head and registers with the streamer
+     * @param reader Source file (ownership transferred; only the streamer thread reads it afterwards)
+     * @param sampleRate Engine rate
+     */
+    static std::unique_ptr<SampleStream> create(std::unique_ptr<juce::AudioFormatReader> reader, double sampleRate);
+
+    ~SampleStream();
+
+    // Length at the engine rate
+    int64_t getLength() const { return length_; }
+
+    const float* getHead() const { return head_.data(); }
+    int getHeadFrames() const { return static_cast<int>(head_.size()); }
+
+    /**
+     * Rewind to the start for a new trigger (audio thread)
+     */
+    void restart() {
+        generation_ = (generation_ + 1) & GENERATION_MASK;
+        if (generation_ == 0) generation_ = 1;     // 0 = never triggered
+        consumer_.store(pack(generation_, 0), std::memory_order_release);
+    }
+
+    /**
+     * Mix frames [position, position + count) from the ring (audio thread; position >= head frames)
+     * @return true if the streamer had not delivered all of them (the missing frames are silent)
+     */
+    bool read(int64_t position, float* left, float* right, int count, float levelL, float levelR) {
+        const uint64_t filled = filled_.load(std::memory_order_acquire);
+        const int64_t available = (generationOf(filled) == generation_) ? frameOf(filled) : getHeadFrames();
+        const int ready = static_cast<int>(std::clamp<int64_t>(available - position, 0, count));
+
+        for (int done = 0; done < ready;) {
+            const int slot = static_cast<int>((position + done) % RING_FRAMES);
+            const int run = std::min(ready - done, RING_FRAMES - slot);
+            juce::FloatVectorOperations::addWithMultiply(left + done, ring_.data() + slot, levelL, run);
+            juce::FloatVectorOperations::addWithMultiply(right + done, ring_.data() + slot, levelR, run);
+            done += run;
+        }
+
+        consumer_.store(pack(generation_, position + count), std::memory_order_release);
+        return ready < count;
+    }
+
+    /**
+     * Refill the ring ahead of the playhead (streamer thread)
+     */
+    void service() {
+        const uint64_t consumer = consumer_.load(std::memory_order_acquire);
+        const uint32_t generation = generationOf(consumer);
+        if (generation == 0) return;
+
+        if (generation != producerGeneration_) {
+            producerGeneration_ = generation;
+            writeEnd_ = getHeadFrames();
+            filled_.store(pack(generation, writeEnd_), std::memory_order_release);
+        }
+
+        // After an underrun, skip what the playhead has already passed
+        const int64_t playhead = frameOf(consumer);
+        writeEnd_ = std::max(writeEnd_, playhead);
+
+        const int64_t limit = std::min(length_, playhead + RING_FRAMES);
+        while (writeEnd_ < limit) {
+            // A new trigger makes the rest of this refill useless
+            if (generationOf(consumer_.load(std::memory_order_relaxed)) != generation) return;
+
+            const int slot = static_cast<int>(writeEnd_ % RING_FRAMES);
+            const int count = static_cast<int>(std::min<int64_t>({limit - writeEnd_, CHUNK_FRAMES, RING_FRAMES - slot}));
+            render(writeEnd_, count, ring_.data() + slot);
+            writeEnd_ += count;
+            filled_.store(pack(generation, writeEnd_), std::memory_order_release);
+        }
+    }
+
+private:
+    static constexpr int FRAME_BITS = 40;
+    static constexpr uint64_t FRAME_MASK = (uint64_t(1) << FRAME_BITS) - 1;
+    static constexpr uint32_t GENERATION_MASK = (1u << 24) - 1;
+
+    std::unique_ptr<juce::AudioFormatReader> reader_;
+    std::unique_ptr<PolyphaseResampler> resampler_;    // nullptr when the file is at the engine rate
+    int64_t length_ = 0;
+    std::vector<float> head_;
+    std::vector<float> ring_;
+    std::vector<float> input_;                         // Streamer thread scratch
+
+    std::atomic<uint64_t> consumer_{0};
+    std::atomic<uint64_t> filled_{0};
+    uint32_t generation_ = 0;                          // Audio thread
+    uint32_t producerGeneration_ = 0;                  // Streamer thread
+    int64_t writeEnd_ = 0;                             // Streamer thread
+
+    SampleStream() = default;
+
+    static uint64_t pack(uint32_t generation, int64_t frame) {
+        return (static_cast<uint64_t>(generation) << FRAME_BITS) | (static_cast<uint64_t>(frame) & FRAME_MASK);
+    }
+    static uint32_t generationOf(uint64_t packed) { return static_cast<uint32_t>(packed >> FRAME_BITS); }
+    static int64_t frameOf(uint64_t packed) { return static_cast<int64_t>(packed & FRAME_MASK); }
+
+    /**
+     * Frames [first, first + count) at the engine rate, first channel of the file
+     */
+    void render(int64_t first, int count, float* out) {
+        if (resampler_ == nullptr) {
+            reader_->read(&out, 1, first, count);
+            return;
+        }
+
+        int64_t firstInput = 0;
+        int numInput = 0;
+        resampler_->getInputRange(first, count, firstInput, numInput);
+        if (static_cast<int>(input_.size()) < numInput) input_.resize(static_cast<size_t>(numInput));
+
+        // The reader fills samples outside the file with silence
+        float* input = input_.data();
+        reader_->read(&input, 1, firstInput, numInput);
+        resampler_->processRange(input, firstInput, first, count, out);
+    }
+
+};
+
+/**
+ * Background thread refilling every open SampleStream (shared by all engine instances)
+ */
+class SampleStreamer {
+public:
+    static constexpr int SERVICE_INTERVAL_MS = 5;
+
+    static SampleStreamer& instance() {
+        static SampleStreamer streamer;
+        return streamer;
+    }
+
+    void add(SampleStream* stream) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            streams_.push_back(stream);
+            if (!worker_.joinable()) {
+                worker_ = std::thread([this] { run(); });
+            }
+        }
+        wakeUp_.notify_one();
+    }
+
+    /**
+     * Unregister; returns after any refill in progress has finished
+     */
+    void remove(SampleStream* stream) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        streams_.erase(std::remove(streams_.begin(), streams_.end(), stream), streams_.end());
+    }
+
+private:
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    bool stopping_ = false;
+    std::vector<SampleStream*> streams_;
+
+    SampleStreamer() = default;
+
+    ~SampleStreamer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wakeUp_.notify_one();
+        if (worker_.joinable()) worker_.join();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            // The audio thread cannot notify; poll well inside the head / ring margin
+            wakeUp_.wait_for(lock, std::chrono::milliseconds(SERVICE_INTERVAL_MS));
+            for (auto* stream : streams_) stream->service();
+        }
+    }
+};
+
+inline std::unique_ptr<SampleStream> SampleStream::create(std::unique_ptr<juce::AudioFormatReader> reader,
+                                                          double sampleRate) {
+    if (reader == nullptr || reader->sampleRate <= 0.0 || reader->lengthInSamples <= 0) return nullptr;
+
+    std::unique_ptr<SampleStream> stream(new SampleStream());
+    stream->length_ = reader->lengthInSamples;
+    if (std::abs(reader->sampleRate - sampleRate) > 1.0) {
+        stream->resampler_ = std::make_unique<PolyphaseResampler>(reader->sampleRate, sampleRate);
+        stream->length_ = stream->resampler_->getOutputLength(reader->lengthInSamples);
+    }
+    stream->reader_ = std::move(reader);
+
+    const int64_t headFrames = std::min<int64_t>(stream->length_, static_cast<int64_t>(HEAD_SECONDS * sampleRate));
+    stream->head_.assign(static_cast<size_t>(headFrames), 0.0f);
+    stream->render(0, static_cast<int>(headFrames), stream->head_.data());
+    stream->ring_.assign(RING_FRAMES, 0.0f);
+
+    SampleStreamer::instance().add(stream.get());
+    return stream;
+}
+
+inline SampleStream::~SampleStream() {
+    SampleStreamer::instance().remove(this);
+}
+
+} // namespace TechnoMachine
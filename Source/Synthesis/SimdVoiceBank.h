@@ -0,0 +1,418 @@
+/**
+ * SimdVoiceBank.h
+ * Techno Machine - 4 聲道向量化合成器
+ *
+ * 架構：
+ * - NUM_VOICES = 4 = 一個 SSE/NEON 暫存器
+ * - 所有聲道狀態以 structure-of-arrays 儲存（phase、包絡、BPF 狀態與係數）
+ * - SINE 與 NOISE 兩條路徑都計算，再用 mode mask 混合（無逐 sample 分支）
+ * - 係數在 trigger / setFreq / setDecay / setSampleRate 時計算
+ * - 發聲中的頻率變化可用區塊速率平滑（每 chunk 每聲道重算一次係數）
+ * - 噪音由 NoiseSource4 一次產生整個 chunk（4 條 xorshift 串流 = 一個暫存器）
+ * - SINE 振盪器可選 SineBackend（全部聲道共用，預設多項式）：POLYNOMIAL / QUADRATURE 為向量運算，
+ *   STD / WAVETABLE 每 sample 逐聲道計算（參考用）；backend 分支在 chunk 層級
+ *
+ * processSample() 為逐 sample 的 scalar 參考路徑（與 MinimalVoice::process() 相同演算法）
+ * processBlock() 為 SIMD 路徑，無 SIMD 時退回 scalar
+ */
+
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include "SynthTypes.h"
+#include "Float4.h"
+#include "NoiseSource.h"
+#include "SineOscillator.h"
+
+namespace TechnoMachine {
+
+class SimdVoiceBank {
+public:
+    static constexpr int LANES = NUM_VOICES;
+    static constexpr int MAX_BLOCK = 64;
+
+    SimdVoiceBank() {
+        for (int l = 0; l < LANES; l++) {
+            updateFilter(l);
+            updateDecayCoef(l);
+        }
+    }
+
+    void setSampleRate(float sr) {
+        sampleRate_ = sr;
+        updateSmoothingCoef();
+        for (int l = 0; l < LANES; l++) {
+            updateFilter(l);
+            updateDecayCoef(l);
+        }
+    }
+
+    void setMode(int lane, SynthMode m) {
+        mode_[lane] = m;
+        noiseMask_[lane] = (m == SynthMode::NOISE) ? allOnes() : 0.0f;
+    }
+
+    /**
+     * 平滑關閉或聲道靜止時立即生效；否則在後續區塊中滑向目標
+     */
+    void setFreq(int lane, float f) {
+        targetFreq_[lane] = std::max(20.0f, std::min(f, 20000.0f));
+        if (smoothingMs_ <= 0.0f || !isActive(lane)) {
+            freq_[lane] = targetFreq_[lane];
+            updateFilter(lane);
+        }
+    }
+
+    void setDecay(int lane, float d) {
+        decay_[lane] = std::max(1.0f, std::min(d, 5000.0f));
+    }
+
+    float getFreq(int lane) const { return targetFreq_[lane]; }
+
+    /**
+     * 噪音種子（相同種子 = 相同噪音序列，與 MinimalVoice::setNoiseSeed 相同）
+     */
+    void setNoiseSeed(int lane, uint32_t seed) { noise_.setSeed(lane, seed); }
+
+    /**
+     * 由一個種子衍生 4 個聲道的種子
+     */
+    void setNoiseSeed(uint32_t seed) {
+        uint32_t base = NoiseDetail::scrambleSeed(seed);
+        for (int l = 0; l < LANES; l++) {
+            noise_.setSeed(l, base + static_cast<uint32_t>(l) * 0x9E3779B9u);
+        }
+    }
+    SynthMode getMode(int lane) const { return mode_[lane]; }
+
+    /**
+     * 切換 SINE 振盪器實作（從目前 phase 接續，不會跳相位；與 MinimalVoice::setSineBackend 相同）
+     */
+    void setSineBackend(SineBackend b) {
+        sineBackend_ = b;
+        if (b == SineBackend::WAVETABLE) {
+            SineOscillator::SineTable::get();  // 在呼叫端執行緒建表，避免音訊執行緒首次初始化
+        } else if (b == SineBackend::QUADRATURE) {
+            for (int l = 0; l < LANES; l++) {
+                quadSin_[l] = std::sin(2.0f * static_cast<float>(M_PI) * phase_[l]);
+                quadCos_[l] = std::cos(2.0f * static_cast<float>(M_PI) * phase_[l]);
+            }
+        }
+    }
+
+    SineBackend getSineBackend() const { return sineBackend_; }
+
+    /**
+     * 頻率平滑時間（ms，時間常數），0 = 關閉
+     */
+    void setFreqSmoothing(float ms) {
+        smoothingMs_ = std::max(0.0f, ms);
+        updateSmoothingCoef();
+        if (smoothingMs_ <= 0.0f) {
+            for (int l = 0; l < LANES; l++) snapFreq(l);
+        }
+    }
+
+    /**
+     * 觸發音符（與 MinimalVoice::trigger 相同）
+     */
+    void trigger(int lane, float vel) {
+        float velocity = std::max(0.0f, std::min(vel, 1.0f));
+        env_[lane] = velocity;
+        phase_[lane] = 0.25f;
+        quadSin_[lane] = 1.0f;
+        quadCos_[lane] = 0.0f;
+        z1_[lane] = z2_[lane] = 0.0f;
+        float velScale = 0.1f + 0.9f * std::pow(velocity, 1.5f);
+        actualDecay_[lane] = decay_[lane] * velScale;
+        updateDecayCoef(lane);
+        snapFreq(lane);
+    }
+
+    bool isActive(int lane) const { return env_[lane] >= ENV_THRESHOLD; }
+
+    bool anyActive() const {
+        for (int l = 0; l < LANES; l++) {
+            if (isActive(l)) return true;
+        }
+        return false;
+    }
+
+    /**
+     * Scalar 參考路徑：輸出一個 frame（4 聲道）
+     */
+    void processSample(float* out) {
+        // 每 SMOOTHING_INTERVAL 個 sample 推進一次平滑
+        if (++smoothingCounter_ >= SMOOTHING_INTERVAL) {
+            smoothingCounter_ = 0;
+            advanceSmoothing(SMOOTHING_INTERVAL);
+        }
+
+        for (int l = 0; l < LANES; l++) {
+            if (env_[l] < ENV_THRESHOLD) {
+                out[l] = 0.0f;
+                continue;
+            }
+
+            float output;
+            if (mode_[l] == SynthMode::SINE) {
+                output = sineSample(l);
+                phase_[l] += phaseInc_[l];
+                if (phase_[l] >= 1.0f) phase_[l] -= 1.0f;
+            } else {
+                float noise = noise_.next(l);
+                float w = noise - a1_[l] * z1_[l] - a2_[l] * z2_[l];
+                output = b0_[l] * (w - z2_[l]);
+                z2_[l] = z1_[l];
+                z1_[l] = w;
+            }
+
+            env_[l] *= decayCoef_[l];
+            out[l] = output * env_[l];
+        }
+    }
+
+    /**
+     * 區塊處理：輸出 interleaved frames（frames[i * LANES + lane]）
+     */
+    void processBlock(float* frames, int numSamples) {
+#if TECHNO_SIMD
+        for (int start = 0; start < numSamples; start += MAX_BLOCK) {
+            int n = std::min(MAX_BLOCK, numSamples - start);
+            advanceSmoothing(n);
+            switch (sineBackend_) {
+                case SineBackend::WAVETABLE:  processChunkSimd<SineBackend::WAVETABLE>(frames + start * LANES, n); break;
+                case SineBackend::POLYNOMIAL: processChunkSimd<SineBackend::POLYNOMIAL>(frames + start * LANES, n); break;
+                case SineBackend::QUADRATURE: processChunkSimd<SineBackend::QUADRATURE>(frames + start * LANES, n); break;
+                default:                      processChunkSimd<SineBackend::STD>(frames + start * LANES, n); break;
+            }
+        }
+#else
+        processBlockScalar(frames, numSamples);
+#endif
+    }
+
+    void processBlockScalar(float* frames, int numSamples) {
+        for (int i = 0; i < numSamples; i++) {
+            processSample(frames + i * LANES);
+        }
+    }
+
+private:
+    static constexpr float ENV_THRESHOLD = 0.0001f;
+    static constexpr float BPF_Q = 2.0f;
+    static constexpr int SMOOTHING_INTERVAL = 32;
+
+    float sampleRate_ = 48000.0f;
+    float smoothingMs_ = 0.0f;
+    float smoothingCoef_ = 0.0f;
+    int smoothingCounter_ = 0;
+
+    // SoA 狀態（對齊一個暫存器）
+    alignas(16) float phase_[LANES] = {0.0f, 0.0f, 0.0f, 0.0f};
+    alignas(16) float phaseInc_[LANES] = {100.0f / 48000.0f, 100.0f / 48000.0f, 100.0f / 48000.0f, 100.0f / 48000.0f};
+    alignas(16) float env_[LANES] = {0.0f, 0.0f, 0.0f, 0.0f};
+    alignas(16) float decayCoef_[LANES] = {0.0f, 0.0f, 0.0f, 0.0f};
+    alignas(16) float z1_[LANES] = {0.0f, 0.0f, 0.0f, 0.0f};
+    alignas(16) float z2_[LANES] = {0.0f, 0.0f, 0.0f, 0.0f};
+    alignas(16) float b0_[LANES] = {0.0f, 0.0f, 0.0f, 0.0f};
+    alignas(16) float a1_[LANES] = {0.0f, 0.0f, 0.0f, 0.0f};
+    alignas(16) float a2_[LANES] = {0.0f, 0.0f, 0.0f, 0.0f};
+    alignas(16) float noiseMask_[LANES] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    // QUADRATURE：每聲道 (sin, cos) 與每 sample 的旋轉量
+    alignas(16) float quadSin_[LANES] = {0.0f, 0.0f, 0.0f, 0.0f};
+    alignas(16) float quadCos_[LANES] = {1.0f, 1.0f, 1.0f, 1.0f};
+    alignas(16) float rotCos_[LANES] = {1.0f, 1.0f, 1.0f, 1.0f};
+    alignas(16) float rotSin_[LANES] = {0.0f, 0.0f, 0.0f, 0.0f};
+    SineBackend sineBackend_ = SineBackend::POLYNOMIAL;
+
+    // 參數
+    SynthMode mode_[LANES] = {SynthMode::SINE, SynthMode::SINE, SynthMode::SINE, SynthMode::SINE};
+    float freq_[LANES] = {100.0f, 100.0f, 100.0f, 100.0f};        // 目前（平滑中）頻率
+    float targetFreq_[LANES] = {100.0f, 100.0f, 100.0f, 100.0f};
+    float decay_[LANES] = {200.0f, 200.0f, 200.0f, 200.0f};
+    float actualDecay_[LANES] = {200.0f, 200.0f, 200.0f, 200.0f};
+
+    // 噪音（每聲道獨立串流）與 interleaved 噪音區塊
+    NoiseSource4 noise_;
+    alignas(16) float noiseBlock_[MAX_BLOCK * LANES] = {};
+
+    /**
+     * 聲道 l 的 sin(2π·phase)（scalar 路徑；QUADRATURE 同時旋轉並校正振幅）
+     */
+    float sineSample(int l) {
+        switch (sineBackend_) {
+            case SineBackend::WAVETABLE:  return SineOscillator::sinTable(phase_[l]);
+            case SineBackend::POLYNOMIAL: return SineOscillator::sinPoly(phase_[l]);
+            case SineBackend::QUADRATURE: {
+                float output = quadSin_[l];
+                float s = quadSin_[l] * rotCos_[l] + quadCos_[l] * rotSin_[l];
+                float c = quadCos_[l] * rotCos_[l] - quadSin_[l] * rotSin_[l];
+                float gain = 1.5f - 0.5f * (s * s + c * c);
+                quadSin_[l] = s * gain;
+                quadCos_[l] = c * gain;
+                return output;
+            }
+            default:                      return std::sin(2.0f * static_cast<float>(M_PI) * phase_[l]);
+        }
+    }
+
+    static float allOnes() {
+        const unsigned int bits = 0xFFFFFFFFu;
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    void updateDecayCoef(int lane) {
+        float decaySamples = (actualDecay_[lane] / 1000.0f) * sampleRate_;
+        decayCoef_[lane] = std::exp(-1.0f / decaySamples);
+    }
+
+    void updateSmoothingCoef() {
+        if (smoothingMs_ <= 0.0f) {
+            smoothingCoef_ = 0.0f;
+            return;
+        }
+        float smoothingSamples = (smoothingMs_ / 1000.0f) * sampleRate_;
+        smoothingCoef_ = -1.0f / smoothingSamples;
+    }
+
+    void snapFreq(int lane) {
+        if (freq_[lane] == targetFreq_[lane]) return;
+        freq_[lane] = targetFreq_[lane];
+        updateFilter(lane);
+    }
+
+    /**
+     * 一階平滑 freq_ → targetFreq_，推進 numSamples 個 sample
+     * 只有滑動中的聲道需要重算係數
+     */
+    void advanceSmoothing(int numSamples) {
+        float keep = -1.0f;
+        for (int l = 0; l < LANES; l++) {
+            if (freq_[l] == targetFreq_[l]) continue;
+            if (keep < 0.0f) keep = std::exp(smoothingCoef_ * static_cast<float>(numSamples));
+            freq_[l] = targetFreq_[l] + (freq_[l] - targetFreq_[l]) * keep;
+            if (std::abs(freq_[l] - targetFreq_[l]) < 0.01f) freq_[l] = targetFreq_[l];
+            updateFilter(l);
+        }
+    }
+
+    /**
+     * phase 增量 + Constant 0dB peak gain BPF（與 MinimalVoice 相同；b1 = 0, b2 = -b0）
+     */
+    void updateFilter(int lane) {
+        phaseInc_[lane] = freq_[lane] / sampleRate_;
+        rotCos_[lane] = std::cos(2.0f * static_cast<float>(M_PI) * phaseInc_[lane]);
+        rotSin_[lane] = std::sin(2.0f * static_cast<float>(M_PI) * phaseInc_[lane]);
+
+        float omega = 2.0f * static_cast<float>(M_PI) * freq_[lane] / sampleRate_;
+        float sinOmega = std::sin(omega);
+        float cosOmega = std::cos(omega);
+        float alpha = sinOmega / (2.0f * BPF_Q);
+        float a0 = 1.0f + alpha;
+
+        b0_[lane] = (sinOmega / 2.0f) / a0;
+        a1_[lane] = (-2.0f * cosOmega) / a0;
+        a2_[lane] = (1.0f - alpha) / a0;
+    }
+
+#if TECHNO_SIMD
+    template <SineBackend Backend>
+    void processChunkSimd(float* frames, int n) {
+        // 噪音只為作用中的 NOISE 聲道產生
+        bool needsNoise[LANES];
+        for (int l = 0; l < LANES; l++) {
+            needsNoise[l] = (mode_[l] == SynthMode::NOISE) && isActive(l);
+        }
+        noise_.fillInterleaved(noiseBlock_, n, needsNoise);
+
+        const Float4 one = Float4::broadcast(1.0f);
+        const Float4 threshold = Float4::broadcast(ENV_THRESHOLD);
+        const Float4 zero = Float4::zero();
+
+        Float4 phase = Float4::load(phase_);
+        Float4 env = Float4::load(env_);
+        Float4 z1 = Float4::load(z1_);
+        Float4 z2 = Float4::load(z2_);
+        const Float4 phaseInc = Float4::load(phaseInc_);
+        const Float4 decayCoef = Float4::load(decayCoef_);
+        const Float4 b0 = Float4::load(b0_);
+        const Float4 a1 = Float4::load(a1_);
+        const Float4 a2 = Float4::load(a2_);
+        const Float4 noiseMask = Float4::load(noiseMask_);
+        Float4 quadSin = Float4::load(quadSin_);
+        Float4 quadCos = Float4::load(quadCos_);
+        const Float4 rotCos = Float4::load(rotCos_);
+        const Float4 rotSin = Float4::load(rotSin_);
+
+        for (int i = 0; i < n; i++) {
+            Float4 active = Float4::greaterEqual(env, threshold);
+            Float4 sineActive = Float4::bitAndNot(noiseMask, active);
+
+            // Sine 路徑
+            Float4 sine;
+            if (Backend == SineBackend::POLYNOMIAL) {
+                sine = SineOscillator::sinPoly(phase);
+            } else if (Backend == SineBackend::QUADRATURE) {
+                sine = quadSin;
+                Float4 nextSin = quadSin * rotCos + quadCos * rotSin;
+                Float4 nextCos = quadCos * rotCos - quadSin * rotSin;
+                quadSin = Float4::select(sineActive, nextSin, quadSin);
+                quadCos = Float4::select(sineActive, nextCos, quadCos);
+            } else {
+                alignas(16) float phases[LANES];
+                alignas(16) float values[LANES];
+                phase.store(phases);
+                for (int l = 0; l < LANES; l++) {
+                    values[l] = (Backend == SineBackend::WAVETABLE)
+                        ? SineOscillator::sinTable(phases[l])
+                        : std::sin(2.0f * static_cast<float>(M_PI) * phases[l]);
+                }
+                sine = Float4::load(values);
+            }
+            Float4 nextPhase = phase + phaseInc;
+            nextPhase = Float4::select(Float4::greaterEqual(nextPhase, one), nextPhase - one, nextPhase);
+
+            // Noise + BPF 路徑
+            Float4 noise = Float4::load(noiseBlock_ + i * LANES);
+            Float4 w = noise - a1 * z1 - a2 * z2;
+            Float4 filtered = b0 * (w - z2);
+
+            // 依 mode 混合，依包絡遮罩
+            Float4 signal = Float4::select(noiseMask, filtered, sine);
+            Float4 nextEnv = env * decayCoef;
+            Float4 out = Float4::select(active, signal * nextEnv, zero);
+            out.store(frames + i * LANES);
+
+            // 狀態更新只發生在作用中的聲道（與 scalar 路徑一致）
+            Float4 noiseActive = Float4::bitAnd(noiseMask, active);
+            phase = Float4::select(sineActive, nextPhase, phase);
+            z2 = Float4::select(noiseActive, z1, z2);
+            z1 = Float4::select(noiseActive, w, z1);
+            env = Float4::select(active, nextEnv, env);
+        }
+
+        // QUADRATURE 振幅校正每 chunk 一次（與 MinimalVoice::renderSine 相同）
+        if (Backend == SineBackend::QUADRATURE) {
+            const Float4 gain = Float4::broadcast(1.5f)
+                - Float4::broadcast(0.5f) * (quadSin * quadSin + quadCos * quadCos);
+            quadSin = quadSin * gain;
+            quadCos = quadCos * gain;
+        }
+        quadSin.store(quadSin_);
+        quadCos.store(quadCos_);
+
+        phase.store(phase_);
+        env.store(env_);
+        z1.store(z1_);
+        z2.store(z2_);
+    }
+#endif
+};
+
+} // namespace TechnoMachine
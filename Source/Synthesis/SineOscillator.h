@@ -0,0 +1,97 @@
+/**
+ * SineOscillator.h
+ * Techno Machine - sin(2π·phase) 近似
+ *
+ * 供 MinimalVoice 與 SimdVoiceBank 的 SineBackend 選擇共用（sinPoly 另有 Float4 版本）：
+ * - sinTable()：1024 點查表 + 線性內插，誤差約 5e-6
+ * - sinPoly()：折到 [-0.25, 0.25] 後用 9 階奇次 minimax 多項式，誤差 < 1e-7（float 捨入為主）
+ * 遞迴正交振盪器需要逐聲道狀態，直接實作在 MinimalVoice 內
+ */
+
+#pragma once
+
+#include <cmath>
+#include "SynthTypes.h"
+#include "Float4.h"
+
+namespace TechnoMachine {
+namespace SineOscillator {
+
+// sin(2π·y) ≈ y·(c0 + c1·y² + c2·y⁴ + c3·y⁶ + c4·y⁸)，y ∈ [-0.25, 0.25]（Remez 擬合）
+static constexpr float POLY_C0 = 6.2831851600894844f;
+static constexpr float POLY_C1 = -41.341655031417581f;
+static constexpr float POLY_C2 = 81.601004073342011f;
+static constexpr float POLY_C3 = -76.54978229540383f;
+static constexpr float POLY_C4 = 39.536706079068999f;
+
+/**
+ * phase ∈ [0, 1)
+ */
+inline float sinPoly(float phase) {
+    float y = phase >= 0.75f ? phase - 1.0f : phase;
+    y = y >= 0.25f ? 0.5f - y : y;
+
+    float y2 = y * y;
+    float p = POLY_C4;
+    p = p * y2 + POLY_C3;
+    p = p * y2 + POLY_C2;
+    p = p * y2 + POLY_C1;
+    p = p * y2 + POLY_C0;
+    return p * y;
+}
+
+/**
+ * 共用正弦表（多一個 guard 點，內插不需 wrap）
+ */
+struct SineTable {
+    static constexpr int SIZE = 1024;
+    float values[SIZE + 1];
+
+    SineTable() {
+        for (int i = 0; i <= SIZE; i++) {
+            values[i] = static_cast<float>(std::sin(2.0 * M_PI * i / SIZE));
+        }
+    }
+
+    static const SineTable& get() {
+        static const SineTable table;
+        return table;
+    }
+};
+
+/**
+ * phase ∈ [0, 1)
+ */
+inline float sinTable(float phase) {
+    const float* values = SineTable::get().values;
+    float pos = phase * static_cast<float>(SineTable::SIZE);
+    int index = static_cast<int>(pos);
+    float frac = pos - static_cast<float>(index);
+    return values[index] + frac * (values[index + 1] - values[index]);
+}
+
+#if TECHNO_SIMD
+/**
+ * sinPoly 的 4 聲道版本
+ */
+inline Float4 sinPoly(Float4 phase) {
+    const Float4 one = Float4::broadcast(1.0f);
+    const Float4 half = Float4::broadcast(0.5f);
+    const Float4 quarter = Float4::broadcast(0.25f);
+    const Float4 threeQuarters = Float4::broadcast(0.75f);
+
+    Float4 y = Float4::select(Float4::greaterEqual(phase, threeQuarters), phase - one, phase);
+    y = Float4::select(Float4::greaterEqual(y, quarter), half - y, y);
+
+    Float4 y2 = y * y;
+    Float4 p = Float4::broadcast(POLY_C4);
+    p = p * y2 + Float4::broadcast(POLY_C3);
+    p = p * y2 + Float4::broadcast(POLY_C2);
+    p = p * y2 + Float4::broadcast(POLY_C1);
+    p = p * y2 + Float4::broadcast(POLY_C0);
+    return p * y;
+}
+#endif
+
+} // namespace SineOscillator
+} // namespace TechnoMachine
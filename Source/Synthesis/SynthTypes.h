@@ -0,0 +1,46 @@
+/**
+ * SynthTypes.h
+ * Techno Machine - 合成器共用定義
+ *
+ * Role / SynthMode / SineBackend / 聲道數，供 MinimalDrumSynth 與 SimdVoiceBank 共用
+ */
+
+#pragma once
+
+// MSVC compatibility
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace TechnoMachine {
+
+// 合成器模式
+enum class SynthMode {
+    SINE,   // 音調類：Kick, Tom
+    NOISE   // 噪音類：Hi-Hat, Clap, Rim
+};
+
+// SINE 模式的振盪器實作（見 SineOscillator.h）
+enum class SineBackend {
+    STD,         // std::sin（參考）
+    WAVETABLE,   // 1024 點查表 + 線性內插
+    POLYNOMIAL,  // 9 階 minimax 多項式
+    QUADRATURE   // 遞迴正交振盪器（每 sample 一次旋轉）
+};
+
+// 四角色定義
+enum Role {
+    TIMELINE = 0,    // Hi-Hat
+    FOUNDATION = 1,  // Kick
+    GROOVE = 2,      // Clap
+    LEAD = 3,        // Perc
+    NUM_ROLES = 4
+};
+
+// Pattern 系統用（保留 8 個 pattern 的 Interlock 邏輯）
+static constexpr int NUM_PATTERN_VOICES = 8;
+
+// 合成器聲道數（每 Role 一個）
+static constexpr int NUM_VOICES = 4;
+
+} // namespace TechnoMachine
@@ -0,0 +1,256 @@
+/**
+ * PatternBankBuilder.cpp
+ * Techno Machine - 離線生成 Pattern Bank
+ *
+ * 對每個 (4 個角色的風格, variation 分桶, density profile) 以 DeckGenerator 生成 K 個 Deck，
+ * 寫成 patterns.tmpb（格式見 Source/Sequencer/PatternBank.h），引擎啟動時 memory map 載入。
+ *
+ * 用法：PatternBankBuilder <輸出檔> [選項]
+ *   --variants K            每個 group 的 variant 數（預設 4）
+ *   --variation-buckets V   variation 分桶數（預設 4）
+ *   --density-buckets D     density profile 比對的分桶數（預設 4）
+ *   --density-profile a,b,c,d
+ *                           4 個角色的生成 density（可重複，最多 16 組；預設為引擎預設值 0.4,0.2,0.5,0.5）
+ *   --length N              pattern 步數（預設 16，需與引擎相同）
+ *   --seed S                生成 seed（預設 0）
+ *   --styles FILE           同時使用 StyleTrainer 產生的風格庫（需與引擎載入的相同）
+ *   --threads N             執行緒數（預設為 CPU 核心數）
+ *
+ * 每個 variant 的 seed 由 (seed, record index) 導出，輸出與執行緒數無關。
+ * Group 依順序分批：每批由所有執行緒平行生成到批次緩衝區，再依序寫入檔案。
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Sequencer/PatternBank.h"
+
+namespace fs = std::filesystem;
+using namespace TechnoMachine;
+
+namespace {
+
+constexpr uint64_t GROUPS_PER_BATCH = 4096;
+
+struct Options {
+    fs::path output;
+    int variants = 4;
+    PatternBankLayout layout;
+    uint64_t seed = 0;
+    fs::path styles;
+    int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    bool customProfiles = false;
+};
+
+void printUsage() {
+    std::fprintf(stderr,
+                 "usage: PatternBankBuilder <output.tmpb> [--variants K] [--variation-buckets V]\n"
+                 "       [--density-buckets D] [--density-profile a,b,c,d]... [--length N] [--seed S]\n"
+                 "       [--styles FILE] [--threads N]\n");
+}
+
+/**
+ * 加入一組 "a,b,c,d" density profile（第一組取代預設值）
+ */
+bool addDensityProfile(const char* value, Options& options) {
+    PatternBankLayout& layout = options.layout;
+    if (!options.customProfiles) {
+        layout.numDensityProfiles = 0;
+        options.customProfiles = true;
+    }
+    if (layout.numDensityProfiles >= PatternBankFormat::MAX_DENSITY_PROFILES) return false;
+
+    float d[NUM_ROLES];
+    int consumed = 0;
+    if (std::sscanf(value, "%f,%f,%f,%f%n", &d[0], &d[1], &d[2], &d[3], &consumed) != NUM_ROLES
+        || value[consumed] != '\0') return false;
+
+    float* profile = layout.densityProfiles[layout.numDensityProfiles++];
+    for (int r = 0; r < NUM_ROLES; r++) {
+        profile[r] = std::clamp(d[r], 0.0f, PatternBankFormat::MAX_DENSITY);
+    }
+    return true;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    if (argc < 2) return false;
+    options.output = argv[1];
+
+    for (int i = 2; i < argc; i++) {
+        if (i + 1 >= argc) return false;
+        const char* name = argv[i];
+        const char* value = argv[++i];
+
+        if (std::strcmp(name, "--variants") == 0) options.variants = std::atoi(value);
+        else if (std::strcmp(name, "--variation-buckets") == 0) options.layout.variationBuckets = std::atoi(value);
+        else if (std::strcmp(name, "--density-buckets") == 0) options.layout.densityBuckets = std::atoi(value);
+        else if (std::strcmp(name, "--density-profile") == 0) { if (!addDensityProfile(value, options)) return false; }
+        else if (std::strcmp(name, "--length") == 0) options.layout.length = std::atoi(value);
+        else if (std::strcmp(name, "--seed") == 0) options.seed = std::strtoull(value, nullptr, 0);
+        else if (std::strcmp(name, "--styles") == 0) options.styles = value;
+        else if (std::strcmp(name, "--threads") == 0) options.threads = std::max(1, std::atoi(value));
+        else return false;
+    }
+
+    return options.variants >= 1
+        && options.layout.variationBuckets >= 1 && options.layout.variationBuckets <= 64
+        && options.layout.densityBuckets >= 1 && options.layout.densityBuckets <= 64
+        && options.layout.length >= 1 && options.layout.length <= Pattern::MAX_STEPS;
+}
+
+/**
+ * 登錄訓練風格（資料需保持到程式結束）
+ */
+bool loadStyles(const fs::path& path, std::vector<char>& storage) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    storage.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+    int numEntries = 0;
+    const StyleBankEntry* entries = StyleBankFormat::entries(storage.data(), storage.size(), numEntries);
+    if (entries == nullptr) return false;
+
+    StyleRegistry::instance().addTrained(entries, numEntries);
+    return true;
+}
+
+/**
+ * 生成一批 group 的所有 record
+ */
+void buildBatch(const Options& options, uint64_t firstGroup, uint64_t numGroups, std::vector<uint8_t>& buffer) {
+    const PatternBankLayout& layout = options.layout;
+    const size_t recordSize = layout.recordSize();
+    const uint64_t variants = static_cast<uint64_t>(options.variants);
+
+    std::atomic<uint64_t> next{0};
+
+    auto worker = [&] {
+        DeckGenerator generator;
+        Deck deck;
+
+        for (uint64_t i = next.fetch_add(1, std::memory_order_relaxed); i < numGroups;
+             i = next.fetch_add(1, std::memory_order_relaxed)) {
+            const uint64_t group = firstGroup + i;
+            const int densityProfile = static_cast<int>(group % static_cast<uint64_t>(layout.numDensityProfiles));
+            const uint64_t rest = group / static_cast<uint64_t>(layout.numDensityProfiles);
+            const int variationBucket = static_cast<int>(rest % static_cast<uint64_t>(layout.variationBuckets));
+            layout.decodeStyleTuple(rest / static_cast<uint64_t>(layout.variationBuckets), deck.styleIndices);
+
+            // Profile 的原始值（與引擎以相同 density 生成的結果一致）
+            const float* densities = layout.densityProfiles[densityProfile];
+            const float variation = layout.variationCenter(variationBucket);
+
+            for (uint64_t k = 0; k < variants; k++) {
+                const uint64_t record = group * variants + k;
+                generator.seed(RandomStream::deriveKey(options.seed, record));
+                generator.generate(deck, layout.length, variation, densities);
+                layout.encode(deck, buffer.data() + (i * variants + k) * recordSize);
+            }
+        }
+    };
+
+    const int numThreads = static_cast<int>(std::min<uint64_t>(static_cast<uint64_t>(options.threads), numGroups));
+    std::vector<std::thread> threads;
+    for (int t = 1; t < numThreads; t++) threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads) thread.join();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+
+    std::vector<char> styleStorage;
+    if (!options.styles.empty() && !loadStyles(options.styles, styleStorage)) {
+        std::fprintf(stderr, "PatternBankBuilder: invalid style bank %s\n", options.styles.string().c_str());
+        return 1;
+    }
+
+    PatternBankLayout& layout = options.layout;
+    layout.numStyles = getNumStyles();
+
+    const uint64_t numGroups = layout.numGroups();
+    const uint64_t numRecords = numGroups * static_cast<uint64_t>(options.variants);
+    const size_t recordSize = layout.recordSize();
+    if (numRecords > UINT32_MAX) {
+        std::fprintf(stderr, "PatternBankBuilder: %llu records exceed the format limit\n",
+                     static_cast<unsigned long long>(numRecords));
+        return 1;
+    }
+
+    std::fprintf(stderr, "PatternBankBuilder: %d styles, %llu groups x %d variants = %llu decks (%.1f MB), %d threads\n",
+                 layout.numStyles, static_cast<unsigned long long>(numGroups), options.variants,
+                 static_cast<unsigned long long>(numRecords),
+                 static_cast<double>(numRecords * recordSize) / (1024.0 * 1024.0), options.threads);
+
+    PatternBankHeader header = {};
+    std::memcpy(header.magic, PatternBankFormat::MAGIC, sizeof(header.magic));
+    header.version = PatternBankFormat::VERSION;
+    header.numStyles = static_cast<uint32_t>(layout.numStyles);
+    header.styleChecksum = PatternBankLayout::styleChecksum(layout.numStyles);
+    header.length = static_cast<uint32_t>(layout.length);
+    header.variationBuckets = static_cast<uint32_t>(layout.variationBuckets);
+    header.densityBuckets = static_cast<uint32_t>(layout.densityBuckets);
+    header.recordSize = static_cast<uint32_t>(recordSize);
+    header.fillLevels = static_cast<uint32_t>(Deck::FILL_LEVELS);
+    header.numDensityProfiles = static_cast<uint32_t>(layout.numDensityProfiles);
+    header.numGroups = numGroups;
+    header.numRecords = numRecords;
+    header.recordsOffset = sizeof(PatternBankHeader) + layout.densityProfilesSize() + numGroups * sizeof(PatternBankGroup);
+
+    // 先寫入暫存檔再改名，執行中的引擎不會映射到寫到一半的檔案
+    fs::path temp = options.output;
+    temp += ".tmp";
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::fprintf(stderr, "PatternBankBuilder: cannot write %s\n", temp.string().c_str());
+        return 1;
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(layout.densityProfiles), static_cast<std::streamsize>(layout.densityProfilesSize()));
+    for (uint64_t g = 0; g < numGroups; g++) {
+        PatternBankGroup group = {static_cast<uint32_t>(g * static_cast<uint64_t>(options.variants)),
+                                  static_cast<uint32_t>(options.variants)};
+        out.write(reinterpret_cast<const char*>(&group), sizeof(group));
+    }
+
+    std::vector<uint8_t> buffer(GROUPS_PER_BATCH * static_cast<size_t>(options.variants) * recordSize);
+    for (uint64_t first = 0; first < numGroups && out; first += GROUPS_PER_BATCH) {
+        const uint64_t count = std::min(GROUPS_PER_BATCH, numGroups - first);
+        buildBatch(options, first, count, buffer);
+        out.write(reinterpret_cast<const char*>(buffer.data()),
+                  static_cast<std::streamsize>(count * static_cast<uint64_t>(options.variants) * recordSize));
+
+        std::fprintf(stderr, "\r  %llu / %llu groups", static_cast<unsigned long long>(first + count),
+                     static_cast<unsigned long long>(numGroups));
+    }
+    std::fprintf(stderr, "\n");
+
+    out.close();
+    std::error_code ec;
+    if (out) {
+        fs::rename(temp, options.output, ec);
+    }
+    if (!out || ec) {
+        std::fprintf(stderr, "PatternBankBuilder: failed to write %s\n", options.output.string().c_str());
+        return 1;
+    }
+
+    std::fprintf(stderr, "PatternBankBuilder: wrote %s\n", options.output.string().c_str());
+    return 0;
+}
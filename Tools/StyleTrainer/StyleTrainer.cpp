@@ -0,0 +1,543 @@
+/**
+ * StyleTrainer.cpp
+ * Techno Machine - 離線風格訓練工具
+ *
+ * 讀取 MIDI 鼓組檔案，為每個風格計算：
+ * - 4 個角色的 16 位置 onset 權重（對應 StyleProfile 的 timeline / foundation / groove / lead）
+ * - 每小節 density 範圍
+ * - 馬可夫轉移次數（位置 × 前 4 步歷史）
+ * 輸出 styles.tmsb（格式見 Source/Sequencer/StyleBankFormat.h），引擎啟動時 memory map 載入。
+ *
+ * 用法：StyleTrainer <輸入目錄> <輸出檔> [--threads N]
+ *
+ * 輸入目錄的每個子目錄是一個風格（名稱 = 目錄名稱），其下所有 .mid / .midi 檔案（含子目錄）
+ * 都屬於該風格；直接放在輸入目錄的檔案歸入以輸入目錄命名的風格。
+ *
+ * MIDI 處理：
+ * - 只接受以 PPQ 為時間單位的 Standard MIDI File（format 0 / 1），假設 4/4
+ * - 檔案含 channel 10 的音符時只使用 channel 10，否則使用所有 channel
+ * - General MIDI 鼓組音符對應到角色，cymbal（crash / china / splash）不使用
+ * - 量化到 16 分音符，從第一個音符所在的小節開始，完全無音符的小節不計入
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Sequencer/StyleBankFormat.h"
+#include "Sequencer/StyleProfiles.hpp"
+
+namespace fs = std::filesystem;
+using namespace TechnoMachine;
+
+namespace {
+
+constexpr int POSITIONS = StyleBankFormat::POSITIONS;
+constexpr int HISTORIES = StyleBankFormat::HISTORIES;
+constexpr int DRUM_CHANNEL = 9;     // channel 10（0-based）
+constexpr int MAX_TRAINED_STYLES = MAX_STYLES - NUM_STYLES;
+
+// ============================================================
+// General MIDI 鼓組 → 角色
+// ============================================================
+
+int roleForNote(int note) {
+    switch (note) {
+        case 35: case 36:                                   // Kick
+            return FOUNDATION;
+        case 37: case 38: case 39: case 40:                 // Rim / Snare / Clap
+            return GROOVE;
+        case 42: case 44: case 46:                          // Hi-Hat
+        case 51: case 53: case 59:                          // Ride
+        case 54: case 70:                                   // Tambourine / Maracas
+            return TIMELINE;
+        case 49: case 52: case 55: case 57:                 // Crash / China / Splash
+            return -1;
+        default:
+            // Toms、Cowbell、Latin percussion
+            return (note >= 41 && note <= 81) ? LEAD : -1;
+    }
+}
+
+// ============================================================
+// Standard MIDI File 解析
+// ============================================================
+
+struct NoteOn {
+    uint64_t tick;
+    int note;
+    int channel;
+};
+
+class MidiReader {
+public:
+    MidiReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    /**
+     * 讀取所有 note-on（velocity > 0），回傳 false 表示格式錯誤或不支援
+     */
+    bool read(int& ticksPerQuarter, std::vector<NoteOn>& notes) {
+        if (!expectChunk("MThd")) return false;
+        uint32_t headerLength = 0;
+        if (!readU32(headerLength) || headerLength < 6 || !has(headerLength)) return false;
+
+        const size_t headerEnd = pos_ + headerLength;
+        uint16_t format = 0, numTracks = 0, division = 0;
+        readU16(format);
+        readU16(numTracks);
+        readU16(division);
+        pos_ = headerEnd;
+
+        if (format > 1 || (division & 0x8000) != 0 || division == 0) return false;
+        ticksPerQuarter = division;
+
+        for (int t = 0; t < numTracks && has(8); t++) {
+            char id[4];
+            std::memcpy(id, data_ + pos_, 4);
+            pos_ += 4;
+            uint32_t length = 0;
+            if (!readU32(length) || !has(length)) return false;
+
+            const size_t end = pos_ + length;
+            if (std::memcmp(id, "MTrk", 4) == 0) {
+                if (!readTrack(end, notes)) return false;
+            } else {
+                t--;  // 未知 chunk 不算 track
+            }
+            pos_ = end;
+        }
+        return true;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+
+    bool has(size_t n) const { return n <= size_ - pos_; }
+
+    bool expectChunk(const char* id) {
+        if (!has(4) || std::memcmp(data_ + pos_, id, 4) != 0) return false;
+        pos_ += 4;
+        return true;
+    }
+
+    bool readU16(uint16_t& value) {
+        if (!has(2)) return false;
+        value = static_cast<uint16_t>((data_[pos_] << 8) | data_[pos_ + 1]);
+        pos_ += 2;
+        return true;
+    }
+
+    bool readU32(uint32_t& value) {
+        if (!has(4)) return false;
+        value = (static_cast<uint32_t>(data_[pos_]) << 24) | (static_cast<uint32_t>(data_[pos_ + 1]) << 16)
+              | (static_cast<uint32_t>(data_[pos_ + 2]) << 8) | data_[pos_ + 3];
+        pos_ += 4;
+        return true;
+    }
+
+    bool readVarLen(size_t end, uint32_t& value) {
+        value = 0;
+        for (int i = 0; i < 4; i++) {
+            if (pos_ >= end) return false;
+            uint8_t b = data_[pos_++];
+            value = (value << 7) | (b & 0x7F);
+            if ((b & 0x80) == 0) return true;
+        }
+        return false;
+    }
+
+    bool readTrack(size_t end, std::vector<NoteOn>& notes) {
+        uint64_t tick = 0;
+        uint8_t status = 0;
+
+        while (pos_ < end) {
+            uint32_t delta = 0;
+            if (!readVarLen(end, delta)) return false;
+            tick += delta;
+
+            if (pos_ >= end) return false;
+            uint8_t b = data_[pos_];
+
+            if (b == 0xFF) {
+                // Meta event
+                if (end - pos_ < 2) return false;
+                const uint8_t type = data_[pos_ + 1];
+                pos_ += 2;
+                uint32_t length = 0;
+                if (!readVarLen(end, length) || length > end - pos_) return false;
+                pos_ += length;
+                if (type == 0x2F) break;  // End of track
+                continue;
+            }
+            if (b == 0xF0 || b == 0xF7) {
+                // SysEx
+                pos_++;
+                uint32_t length = 0;
+                if (!readVarLen(end, length) || length > end - pos_) return false;
+                pos_ += length;
+                continue;
+            }
+
+            if (b & 0x80) {
+                status = b;
+                pos_++;
+            } else if (status == 0) {
+                return false;  // running status 之前沒有 status
+            }
+
+            const uint8_t kind = status & 0xF0;
+            const int dataBytes = (kind == 0xC0 || kind == 0xD0) ? 1 : 2;
+            if (end - pos_ < static_cast<size_t>(dataBytes)) return false;
+
+            if (kind == 0x90 && data_[pos_ + 1] > 0) {
+                notes.push_back({tick, data_[pos_] & 0x7F, status & 0x0F});
+            }
+            pos_ += static_cast<size_t>(dataBytes);
+        }
+        return true;
+    }
+};
+
+// ============================================================
+// 統計
+// ============================================================
+
+struct StyleStats {
+    uint64_t files = 0;
+    uint64_t bars = 0;
+    uint64_t onsets[NUM_ROLES][POSITIONS] = {};
+    uint64_t densityHistogram[NUM_ROLES][POSITIONS + 1] = {};
+    uint64_t transitions[NUM_ROLES][POSITIONS][HISTORIES][2] = {};
+    double swingSum = 0.0;
+    uint64_t swingCount = 0;
+
+    void merge(const StyleStats& other) {
+        files += other.files;
+        bars += other.bars;
+        for (int r = 0; r < NUM_ROLES; r++) {
+            for (int p = 0; p < POSITIONS; p++) {
+                onsets[r][p] += other.onsets[r][p];
+                for (int h = 0; h < HISTORIES; h++) {
+                    transitions[r][p][h][0] += other.transitions[r][p][h][0];
+                    transitions[r][p][h][1] += other.transitions[r][p][h][1];
+                }
+            }
+            for (int d = 0; d <= POSITIONS; d++) {
+                densityHistogram[r][d] += other.densityHistogram[r][d];
+            }
+        }
+        swingSum += other.swingSum;
+        swingCount += other.swingCount;
+    }
+};
+
+bool readFile(const fs::path& path, std::vector<uint8_t>& bytes) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    in.seekg(0, std::ios::end);
+    const std::streamoff size = in.tellg();
+    if (size <= 0) return false;
+    bytes.resize(static_cast<size_t>(size));
+    in.seekg(0, std::ios::beg);
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(bytes.data()), size));
+}
+
+int popcount16(uint16_t mask) {
+    int count = 0;
+    for (; mask != 0; mask &= static_cast<uint16_t>(mask - 1)) count++;
+    return count;
+}
+
+/**
+ * 分析單一檔案並累加到 stats，回傳 false 表示檔案無法使用
+ */
+bool analyseFile(const fs::path& path, std::vector<uint8_t>& bytes, std::vector<NoteOn>& notes, StyleStats& stats) {
+    if (!readFile(path, bytes)) return false;
+
+    int ppq = 0;
+    notes.clear();
+    MidiReader reader(bytes.data(), bytes.size());
+    if (!reader.read(ppq, notes)) return false;
+
+    const bool hasDrumChannel = std::any_of(notes.begin(), notes.end(),
+                                            [](const NoteOn& n) { return n.channel == DRUM_CHANNEL; });
+
+    // 量化到 16 分音符：每小節每角色一個 16-bit mask
+    const double ticksPerStep = ppq / 4.0;
+    const double ticksPerEighth = ppq / 2.0;
+    std::vector<uint16_t> masks[NUM_ROLES];
+    int64_t firstStep = std::numeric_limits<int64_t>::max();
+    double swingSum = 0.0;
+    uint64_t swingCount = 0;
+
+    for (const NoteOn& n : notes) {
+        if (hasDrumChannel && n.channel != DRUM_CHANNEL) continue;
+        const int role = roleForNote(n.note);
+        if (role < 0) continue;
+
+        const int64_t step = std::llround(static_cast<double>(n.tick) / ticksPerStep);
+        firstStep = std::min(firstStep, step);
+        const size_t bar = static_cast<size_t>(step / POSITIONS);
+        for (auto& m : masks) {
+            if (m.size() <= bar) m.resize(bar + 1, 0);
+        }
+        masks[role][bar] |= static_cast<uint16_t>(1u << (step % POSITIONS));
+
+        // Swing：反拍 16 分音符在 8 分音符內的位置（straight = 0.5）
+        if (step % 2 == 1) {
+            const double frac = std::fmod(static_cast<double>(n.tick), ticksPerEighth) / ticksPerEighth;
+            if (frac > 0.25 && frac < 0.85) {
+                swingSum += frac;
+                swingCount++;
+            }
+        }
+    }
+    if (firstStep == std::numeric_limits<int64_t>::max()) return false;
+
+    const size_t firstBar = static_cast<size_t>(firstStep / POSITIONS);
+    const size_t numBars = masks[0].size();
+    uint8_t history[NUM_ROLES] = {};
+    uint64_t usedBars = 0;
+
+    for (size_t bar = firstBar; bar < numBars; bar++) {
+        bool anyOnset = false;
+        for (int r = 0; r < NUM_ROLES; r++) anyOnset |= masks[r][bar] != 0;
+        if (!anyOnset) continue;
+
+        for (int r = 0; r < NUM_ROLES; r++) {
+            const uint16_t mask = masks[r][bar];
+            stats.densityHistogram[r][popcount16(mask)]++;
+            for (int p = 0; p < POSITIONS; p++) {
+                const int hit = (mask >> p) & 1;
+                stats.onsets[r][p] += static_cast<uint64_t>(hit);
+                stats.transitions[r][p][history[r]][hit]++;
+                history[r] = static_cast<uint8_t>(((history[r] << 1) | hit) & (HISTORIES - 1));
+            }
+        }
+        usedBars++;
+    }
+
+    stats.files++;
+    stats.bars += usedBars;
+    stats.swingSum += swingSum;
+    stats.swingCount += swingCount;
+    return true;
+}
+
+float percentile(const uint64_t* histogram, uint64_t total, double fraction) {
+    const uint64_t target = static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(total)));
+    uint64_t seen = 0;
+    for (int d = 0; d <= POSITIONS; d++) {
+        seen += histogram[d];
+        if (seen >= std::max<uint64_t>(target, 1)) return static_cast<float>(d) / POSITIONS;
+    }
+    return 1.0f;
+}
+
+void fillEntry(StyleBankEntry& entry, const std::string& name, const StyleStats& stats) {
+    std::memset(&entry, 0, sizeof(entry));
+    std::strncpy(entry.name, name.c_str(), StyleBankFormat::NAME_LENGTH - 1);
+    entry.numFiles = static_cast<uint32_t>(std::min<uint64_t>(stats.files, UINT32_MAX));
+    entry.numBars = static_cast<uint32_t>(std::min<uint64_t>(stats.bars, UINT32_MAX));
+    entry.swing = stats.swingCount > 0
+        ? static_cast<float>(std::clamp(stats.swingSum / static_cast<double>(stats.swingCount), 0.5, 0.75))
+        : 0.5f;
+
+    for (int r = 0; r < NUM_ROLES; r++) {
+        const uint64_t peak = *std::max_element(stats.onsets[r], stats.onsets[r] + POSITIONS);
+        for (int p = 0; p < POSITIONS; p++) {
+            entry.weights[r][p] = peak > 0 ? static_cast<float>(static_cast<double>(stats.onsets[r][p]) / peak) : 0.0f;
+        }
+
+        uint64_t total = 0;
+        for (int d = 0; d <= POSITIONS; d++) total += stats.densityHistogram[r][d];
+        entry.densityRange[r][0] = total > 0 ? percentile(stats.densityHistogram[r], total, 0.1) : 0.0f;
+        entry.densityRange[r][1] = total > 0 ? percentile(stats.densityHistogram[r], total, 0.9) : 0.0f;
+
+        for (int p = 0; p < POSITIONS; p++) {
+            for (int h = 0; h < HISTORIES; h++) {
+                for (int hit = 0; hit < 2; hit++) {
+                    entry.transitions[r][p][h][hit] =
+                        static_cast<uint32_t>(std::min<uint64_t>(stats.transitions[r][p][h][hit], UINT32_MAX));
+                }
+            }
+        }
+    }
+}
+
+// ============================================================
+// 檔案收集
+// ============================================================
+
+struct Job {
+    int style;
+    fs::path path;
+};
+
+bool isMidiFile(const fs::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == ".mid" || ext == ".midi";
+}
+
+void collectStyles(const fs::path& root, std::vector<std::string>& styleNames, std::vector<Job>& jobs) {
+    std::vector<fs::path> styleDirs;
+    std::vector<fs::path> rootFiles;
+    for (const auto& entry : fs::directory_iterator(root)) {
+        if (entry.is_directory()) styleDirs.push_back(entry.path());
+        else if (entry.is_regular_file() && isMidiFile(entry.path())) rootFiles.push_back(entry.path());
+    }
+    std::sort(styleDirs.begin(), styleDirs.end());
+
+    // 檔案依路徑排序，輸出與執行緒數無關
+    auto addStyle = [&](const std::string& name, std::vector<fs::path> files) {
+        if (files.empty()) return;
+        std::sort(files.begin(), files.end());
+        const int style = static_cast<int>(styleNames.size());
+        styleNames.push_back(name);
+        for (auto& f : files) jobs.push_back({style, std::move(f)});
+    };
+
+    fs::path rootName = fs::absolute(root).lexically_normal();
+    if (!rootName.has_filename()) rootName = rootName.parent_path();
+    addStyle(rootName.filename().empty() ? "Trained" : rootName.filename().string(), rootFiles);
+
+    for (const auto& dir : styleDirs) {
+        std::vector<fs::path> files;
+        for (const auto& entry : fs::recursive_directory_iterator(dir, fs::directory_options::skip_permission_denied)) {
+            if (entry.is_regular_file() && isMidiFile(entry.path())) files.push_back(entry.path());
+        }
+        addStyle(dir.filename().string(), std::move(files));
+    }
+}
+
+bool writeBank(const fs::path& output, const std::vector<StyleBankEntry>& entries) {
+    StyleBankHeader header;
+    std::memcpy(header.magic, StyleBankFormat::MAGIC, sizeof(header.magic));
+    header.version = StyleBankFormat::VERSION;
+    header.numStyles = static_cast<uint32_t>(entries.size());
+    header.entrySize = sizeof(StyleBankEntry);
+
+    // 先寫入暫存檔再改名，執行中的引擎不會映射到寫到一半的檔案
+    fs::path temp = output;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(entries.data()),
+                  static_cast<std::streamsize>(entries.size() * sizeof(StyleBankEntry)));
+        if (!out) return false;
+    }
+
+    std::error_code ec;
+    fs::rename(temp, output, ec);
+    return !ec;
+}
+
+void printUsage() {
+    std::fprintf(stderr, "usage: StyleTrainer <input-dir> <output.tmsb> [--threads N]\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage();
+        return 2;
+    }
+
+    const fs::path input = argv[1];
+    const fs::path output = argv[2];
+    int numThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int i = 3; i < argc; i++) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            numThreads = std::max(1, std::atoi(argv[++i]));
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    std::error_code ec;
+    if (!fs::is_directory(input, ec)) {
+        std::fprintf(stderr, "StyleTrainer: %s is not a directory\n", input.string().c_str());
+        return 1;
+    }
+
+    std::vector<std::string> styleNames;
+    std::vector<Job> jobs;
+    collectStyles(input, styleNames, jobs);
+    if (jobs.empty()) {
+        std::fprintf(stderr, "StyleTrainer: no MIDI files found in %s\n", input.string().c_str());
+        return 1;
+    }
+
+    const int numStyles = static_cast<int>(styleNames.size());
+    numThreads = std::min<int>(numThreads, static_cast<int>(jobs.size()));
+    std::fprintf(stderr, "StyleTrainer: %zu files, %d styles, %d threads\n", jobs.size(), numStyles, numThreads);
+
+    // 每個執行緒各自累加（不共享寫入），結束後合併
+    std::vector<std::vector<StyleStats>> threadStats(static_cast<size_t>(numThreads),
+                                                     std::vector<StyleStats>(static_cast<size_t>(numStyles)));
+    std::atomic<size_t> nextJob{0};
+    std::atomic<size_t> rejected{0};
+
+    auto worker = [&](int t) {
+        std::vector<uint8_t> bytes;
+        std::vector<NoteOn> notes;
+        for (size_t j = nextJob.fetch_add(1, std::memory_order_relaxed); j < jobs.size();
+             j = nextJob.fetch_add(1, std::memory_order_relaxed)) {
+            if (!analyseFile(jobs[j].path, bytes, notes, threadStats[static_cast<size_t>(t)][static_cast<size_t>(jobs[j].style)])) {
+                rejected.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < numThreads; t++) threads.emplace_back(worker, t);
+    worker(0);
+    for (auto& thread : threads) thread.join();
+
+    std::vector<StyleBankEntry> entries;
+    for (int s = 0; s < numStyles; s++) {
+        StyleStats total;
+        for (const auto& stats : threadStats) total.merge(stats[static_cast<size_t>(s)]);
+
+        if (total.bars == 0) {
+            std::fprintf(stderr, "  %-24s skipped (no usable drum notes)\n", styleNames[static_cast<size_t>(s)].c_str());
+            continue;
+        }
+
+        StyleBankEntry entry;
+        fillEntry(entry, styleNames[static_cast<size_t>(s)], total);
+        std::fprintf(stderr, "  %-24s %8u files %10u bars  swing %.3f\n",
+                     entry.name, entry.numFiles, entry.numBars, entry.swing);
+        entries.push_back(entry);
+    }
+
+    if (rejected.load() > 0) {
+        std::fprintf(stderr, "StyleTrainer: %zu files could not be used\n", rejected.load());
+    }
+    if (static_cast<int>(entries.size()) > MAX_TRAINED_STYLES) {
+        std::fprintf(stderr, "StyleTrainer: warning: the engine loads only the first %d styles\n", MAX_TRAINED_STYLES);
+    }
+    if (entries.empty() || !writeBank(output, entries)) {
+        std::fprintf(stderr, "StyleTrainer: failed to write %s\n", output.string().c_str());
+        return 1;
+    }
+
+    std::fprintf(stderr, "StyleTrainer: wrote %zu styles to %s\n", entries.size(), output.string().c_str());
+    return 0;
+}